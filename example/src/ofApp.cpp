@@ -9,6 +9,10 @@ void ofApp::setup(){
 	// init vars
 	isScanning = false;
 	lastSampleValid = false;
+	lastScanData = 0;
+	converter.setScale(0.1);
+	cloudMesh.setMode(OF_PRIMITIVE_POINTS);
+	cloudMesh.setUsage(GL_DYNAMIC_DRAW);
 	
 	string scanner_ip = "10.0.10.9";
 	
@@ -72,9 +76,6 @@ void ofApp::setup(){
 	driver.setScanFrequency(50);
 	driver.setSamplesPerScan(samples);
 	
-	angleStep = 360.0 / (float)samples;
-	if (isCw) angleStep = -angleStep;
-	
 	const std::map< std::string, std::string >& params = driver.getParameters();
 	
 	ofLogNotice() << "Current scanner settings:";
@@ -88,6 +89,9 @@ void ofApp::setup(){
 	ofLogNotice() << "============================================================";
 	
 	
+	// only the newest scan is drawn, hand it over without queueing and copying scans
+	driver.setLatestScanOutput(true);
+	
 	// Start capturing scanner data
 	//-------------------------------------------------------------------------
 	if (driver.startCapturingUDP()) {
@@ -103,14 +107,21 @@ void ofApp::setup(){
 //--------------------------------------------------------------
 void ofApp::update(){
 	if (isScanning) {
-		// get available scans
-		size_t scans_available = driver.getFullScansAvailable();
-		
-		if (scans_available > 0) {
-			for (int i = 0; i < scans_available; i++) {
-				lastScanData = driver.getScan();
-			}
+		// get the newest scan, if there is one since the last frame
+		if (driver.fetchLatestScan()) {
+			lastScanData = &driver.getLatestScan();
+			converter.convert(*lastScanData, lastCloud);
 			lastSampleValid = true;
+			
+			// one point mesh per scan, drawn with a single draw call
+			cloudMesh.clear();
+			for (size_t i=0; i<lastCloud.size(); i++) {
+				// packet type A has no amplitudes
+				uint32_t a = i < lastScanData->amplitude_data.size() ? lastScanData->amplitude_data[i] : 32;
+				
+				cloudMesh.addVertex(ofVec3f(lastCloud.x[i], lastCloud.y[i], 0));
+				cloudMesh.addColor(a < 32 ? ofFloatColor(210/255.0, 0, 0) : ofFloatColor(210/255.0));
+			}
 		}
 	}
 }
@@ -130,34 +141,8 @@ void ofApp::draw(){
 	
 	if (lastSampleValid) {
 		
-		ofPushMatrix();
-		
-		for (int i=0; i<lastScanData.distance_data.size(); i++) {
-			
-			uint32_t d = lastScanData.distance_data[i];
-			uint32_t a = lastScanData.amplitude_data[i];
-			
-			
-			ofPushMatrix();
-			
-			ofTranslate(d / 10.0, 0);
-
-			if (a < 32) {
-				ofSetColor(210, 0, 0);
-			} else {
-				ofSetColor(210);
-			}
-
-			ofDrawCircle(0, 0, 0.5);
-
-			ofPopMatrix();
-			
-			//rotate a bit
-			ofRotateZ(angleStep);
-		}
-		
-		
-		ofPopMatrix();
+		glPointSize(2);
+		cloudMesh.draw();
 	}
 	
 	
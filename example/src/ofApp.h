@@ -27,12 +27,15 @@ class ofApp : public ofBaseApp{
 	
 	
 	pepperl_fuchs::R2000Driver driver;
-	pepperl_fuchs::ScanData lastScanData;
+	const pepperl_fuchs::ScanData* lastScanData;
 	bool isScanning;
 	bool isCw;
 	bool lastSampleValid;
 	
-	double angleStep;
+	// polar to cartesian, in centimeter
+	pepperl_fuchs::CartesianConverter converter;
+	pepperl_fuchs::PointCloud2D lastCloud;
+	ofVboMesh cloudMesh;
 	
 	ofEasyCam cam;
 };
\ No newline at end of file
@@ -3,48 +3,79 @@
 uniform mat4 modelViewProjectionMatrix;
 in vec4 position;
 in vec4 instanceColor;
-uniform samplerBuffer texDist;
-uniform samplerBuffer texAmp;
+uniform usamplerBuffer texDist;
+uniform usamplerBuffer texAmp;
 out vec4 color;
-uniform float size;
 
-const mediump float pi=3.14159265358979323846264;
-const mediump float twopi=6.28318530717958;
+// one word per sample like packet type C: 20 bit distance, 12 bit amplitude
+uniform usamplerBuffer texPacked;
+uniform int usePacked;
+
+// current scan in the buffers
+uniform int offset;
+uniform int size;
 
+// 0 for packet type A, the amplitudes are 0
+uniform int hasAmplitude;
 
-float vec4ToInt(vec4 val) {
-	int r = int((val.x * 255.0));
-	int g = int((val.y * 255.0));
-	int b = int((val.z * 255.0));
-	int a = int((val.w * 255.0));
+// radians
+uniform float first_angle;
+uniform float angular_increment;
 
-	return ((a<<24) + (b<<16) + (g<<8) + r);
-}
+// set by R2000ScanRenderer: points or box instances, every lodStep-th sample, world units per mm
+uniform int usePoints;
+uniform int lodStep;
+uniform float scale;
+uniform float pointSize;
+
+const uint invalidDistance = 0xFFFFFu;
+
+const mediump float pi=3.14159265358979323846264;
+const mediump float twopi=6.28318530717958;
 
 
 void main(){
-    int id = gl_InstanceID;
+	int id = (usePoints == 1 ? gl_VertexID : gl_InstanceID) * lodStep;
 	
-	float t = twopi * (float(id)/float(size-1));
+	float t = first_angle + angular_increment * float(id);
 	
-	vec4 distT = texelFetch(texDist, id);
-	vec4 ampT = texelFetch(texAmp, id);
+	uint distU;
+	float amp;
+	if (usePacked == 1) {
+		uint word = texelFetch(texPacked, offset + id).r;
+		distU = word & 0xFFFFFu;
+		amp = float(word >> 20);
+	} else {
+		distU = texelFetch(texDist, offset + id).r;
+		amp = float(texelFetch(texAmp, offset + id).r);
+	}
+
+	gl_PointSize = pointSize;
+
+	// no echo or lost packet, moved outside the clip volume
+	if (distU == invalidDistance) {
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		color = vec4(0.0);
+		return;
+	}
 
-	float dist = vec4ToInt(distT) / 10.0;
-	float amp = vec4ToInt(ampT);
+	float dist = float(distU) * scale;
 
 	// calc position
-	float x = sin(t) * dist;
-	float y = cos(t) * dist;
+	float x = cos(t) * dist;
+	float y = sin(t) * dist;
 	
 	
-	vec4 vPos = position;
+	// points have no vertex attributes
+	vec4 vPos = usePoints == 1 ? vec4(0.0, 0.0, 0.0, 1.0) : position;
 	vPos.x += x;
 	vPos.y += y;
 	
 	gl_Position = modelViewProjectionMatrix * vPos;
 
-	if (amp < 32) {
+	if (hasAmplitude == 0) {
+		color = vec4(1.0, 1.0, 0.5, 1.0);
+	} else if (amp < 32) {
 		color = vec4(1.0, 0.0, 0.0, 1.0);
 	} else {
 		color = vec4(1.0, 1.0, 0.5, amp/2047.0);
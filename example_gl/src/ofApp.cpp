@@ -9,15 +9,17 @@ void ofApp::setup(){
 	// init vars
 	isScanning = false;
 	lastSampleValid = false;
+	showHistory = true;
 	
 	string scanner_ip = "10.0.10.9";
 	
 	
 	//----------------------------------------
-	// generate a box vboMesh from a primitive.
+	// draws points or boxes of size 1 with the shader of this example, distances in cm
 	
-	mesh = ofMesh::box(1,1,1,1,1,1);
-	mesh.setUsage(GL_STATIC_DRAW);
+	renderer.setup(1);
+	renderer.setScale(0.1);
+	renderer.setPointSize(2);
 	
 	
 	
@@ -96,6 +98,17 @@ void ofApp::setup(){
 	ofLogNotice() << "============================================================";
 	
 	
+	// only drawn: the receiver copies the packed type C samples of every scan into the mapped buffers of gpuStream,
+	// distance and amplitude are unpacked by the vertex shader, no scans are decoded or queued on the CPU
+	gpuStream.setup(samples, true, SCAN_SINK_PACKED);
+	driver.setScanSink(&gpuStream, true);
+	
+	// 50 scans are one second at 50 Hz, each is copied on the GPU from gpuStream once
+	history.setup(samples, 50, SCAN_SINK_PACKED);
+	history.setDuration(1.0);
+	history.setScale(0.1);
+	history.setColor(ofFloatColor(0.4, 0.6, 1.0, 0.8));
+	
 	// Start capturing scanner data
 	//-------------------------------------------------------------------------
 	if (driver.startCapturingUDP()) {
@@ -115,57 +128,10 @@ void ofApp::setup(){
 //--------------------------------------------------------------
 void ofApp::update(){
 	if (isScanning) {
-		// get available scans
-		size_t scans_available = driver.getFullScansAvailable();
-		
-		if (scans_available > 0) {
-			for (int i = 0; i < scans_available; i++) {
-				lastScanData = driver.getScan();
-			}
+		// make the newest scan written to the GPU current
+		if (gpuStream.update()) {
+			history.add(gpuStream);
 			lastSampleValid = true;
-			
-			
-			//----------------------------------------
-			// update distance texture
-			if (!pixelBufferDist.isAllocated() ||
-				pixelBufferDist.size() != (lastScanData.distance_data.size() * sizeof(std::uint32_t)))
-			{
-				ofLogNotice() << "allocate textureBuffer: " << lastScanData.distance_data.size();
-				
-				pixelBufferDist.allocate();
-				pixelBufferDist.bind(GL_TEXTURE_BUFFER);
-				pixelBufferDist.setData(lastScanData.distance_data, GL_STREAM_DRAW);
-				
-				texDist.allocateAsBufferTexture(pixelBufferDist, GL_RGBA8);
-				
-				shader.begin();
-				shader.setUniformTexture("texDist", texDist, shader.getUniformLocation("texDist"));
-				shader.setUniform1f("size", lastScanData.distance_data.size());
-				shader.end();
-			} else {
-				pixelBufferDist.updateData(0, lastScanData.distance_data);
-			}
-			
-			
-			//----------------------------------------
-			// update amplitude texture
-			if (!pixelBufferAmp.isAllocated() ||
-				pixelBufferAmp.size() != (lastScanData.amplitude_data.size() * sizeof(std::uint32_t)))
-			{
-				ofLogNotice() << "resize amp texture: " << lastScanData.amplitude_data.size();
-				
-				pixelBufferAmp.allocate();
-				pixelBufferAmp.bind(GL_TEXTURE_BUFFER);
-				pixelBufferAmp.setData(lastScanData.amplitude_data, GL_STREAM_DRAW);
-				
-				texAmp.allocateAsBufferTexture(pixelBufferAmp, GL_RGBA8);
-				
-				shader.begin();
-				shader.setUniformTexture("texAmp", texAmp, shader.getUniformLocation("texAmp"));
-				shader.end();
-			} else {
-				pixelBufferAmp.updateData(0, lastScanData.amplitude_data);
-			}
 		}
 	}
 }
@@ -185,10 +151,13 @@ void ofApp::draw(){
 	
 	if (lastSampleValid) {
 		
-		// draw boxes
-		shader.begin();
-		mesh.drawInstanced(OF_MESH_FILL, lastScanData.distance_data.size());
-		shader.end();
+		// all trails in one draw call
+		if (showHistory) {
+			history.draw();
+		}
+		
+		// draw points or boxes
+		renderer.draw(gpuStream, shader);
 		
 	}
 	
@@ -197,13 +166,24 @@ void ofApp::draw(){
 	
 	ofSetColor(180);
 	string info = "fps: " + ofToString(ofGetFrameRate());
+	info += "\nh: trails " + string(showHistory ? "on" : "off");
+	info += "\nm: " + string(renderer.getMode() == R2000_RENDER_POINTS ? "points" : "boxes");
+	info += "\n+/-: every " + ofToString(renderer.getLodStep()) + ". sample";
 	ofDrawBitmapString(info, 32, 32);
 	
 }
 
 //--------------------------------------------------------------
 void ofApp::keyPressed(int key){
-	
+	if (key == 'h') {
+		showHistory = !showHistory;
+	} else if (key == 'm') {
+		renderer.setMode(renderer.getMode() == R2000_RENDER_POINTS ? R2000_RENDER_BOXES : R2000_RENDER_POINTS);
+	} else if (key == '+') {
+		renderer.setLodStep(renderer.getLodStep() + 1);
+	} else if (key == '-') {
+		renderer.setLodStep(renderer.getLodStep() - 1);
+	}
 }
 
 //--------------------------------------------------------------
@@ -259,6 +239,10 @@ void ofApp::dragEvent(ofDragInfo dragInfo){
 //--------------------------------------------------------------
 void ofApp::exit()
 {
+	driver.setScanSink(0);
 	driver.setScanFrequency(10);
 	driver.disconnect();
+	gpuStream.clear();
+	history.clear();
+	renderer.clear();
 }
\ No newline at end of file
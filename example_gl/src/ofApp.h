@@ -27,7 +27,6 @@ class ofApp : public ofBaseApp{
 	
 	
 	pepperl_fuchs::R2000Driver driver;
-	pepperl_fuchs::ScanData lastScanData;
 	bool isScanning;
 	bool isCw;
 	bool lastSampleValid;
@@ -37,13 +36,14 @@ class ofApp : public ofBaseApp{
 	ofEasyCam cam;
 
 	// drawing
-	ofVboMesh	mesh;
+	R2000ScanRenderer	renderer;
 	ofShader	shader;
 
-	ofBufferObject pixelBufferDist;
-	ofBufferObject pixelBufferAmp;
+	// scans written by the receiver straight into GPU buffers
+	R2000GpuStream gpuStream;
 	
-	ofTexture texDist;
-	ofTexture texAmp;
+	// trails of the last second
+	R2000ScanHistory history;
+	bool showHistory;
 	
 };
\ No newline at end of file
@@ -0,0 +1,174 @@
+//
+//  main.cpp
+//  example_http_bench
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// times the handling of scanner responses on the reconnect path (list_parameters, then get_parameter
+// with all listed names) without a scanner, from responses stored in bin/data:
+// the current parsing of HttpCommandInterface and the response handling it replaced
+//
+// the stored responses are in the format of an R2000 UHD with firmware 1.20 (63 parameters),
+// to time the responses of another scanner store its replies instead:
+//	curl -o list_parameters.json http://<scanner>/cmd/list_parameters
+//	curl -o get_parameter.json "http://<scanner>/cmd/get_parameter?list=<names separated by ;>"
+//
+
+#include "ofMain.h"
+#include "http_command_interface.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace pepperl_fuchs;
+
+static const int ITERATIONS = 20000;
+
+// response handling before parsing in place: getline loop over the body, CR substitution,
+// a stringstream for Json::Reader and values copied out of the JSON tree
+class LegacyParser
+{
+public:
+	bool parse(const std::string& body)
+	{
+		std::istringstream response_stream(body);
+		std::string content, tmp;
+		
+		while (!response_stream.eof()) {
+			std::getline(response_stream, tmp);
+			content += tmp;
+		}
+		
+		for (std::size_t i=0; i<content.size(); i++) {
+			if (content[i] == '\r')
+				content[i] = ' ';
+		}
+		
+		std::stringstream ss(content);
+		return jsonParser.parse(ss, root);
+	}
+	
+	std::vector<std::string> parameterList(const std::string& body)
+	{
+		std::vector<std::string> parameter_list;
+		if (!parse(body))
+			return parameter_list;
+		
+		Json::Value oparameters = root["parameters"];
+		for (int i=0; i<(int)oparameters.size(); i++) {
+			Json::Value v = oparameters[i];
+			parameter_list.push_back(v.asString());
+		}
+		return parameter_list;
+	}
+	
+	std::map<std::string, std::string> parameters(const std::string& body, const std::vector<std::string>& names)
+	{
+		std::map<std::string, std::string> key_values;
+		if (!parse(body))
+			return key_values;
+		
+		for (std::size_t n=0; n<names.size(); n++) {
+			if (!root.isMember(names[n]))
+				continue;
+			
+			Json::Value v = root[names[n]];
+			if (v.isArray()) {
+				std::string arrayString;
+				for (int i=0; i<(int)v.size()-1; i++) {
+					arrayString += v[i].asString() + ", ";
+				}
+				arrayString += v[v.size()-1].asString();
+				key_values[names[n]] = arrayString;
+			} else if (v.isObject()) {
+				key_values[names[n]] = "OBJECT";
+			} else {
+				key_values[names[n]] = v.asString();
+			}
+		}
+		return key_values;
+	}
+	
+private:
+	Json::Reader jsonParser;
+	Json::Value root;
+};
+
+// current path, what getParameterList() and getParameters() do with the response content
+static std::map<std::string, std::string> parseCurrent(const std::string& listBody, const std::string& getBody)
+{
+	Json::Value listRoot;
+	if (!HttpCommandInterface::parseResponse(listBody, listRoot) || !HttpCommandInterface::checkErrorCode(listRoot))
+		return std::map<std::string, std::string>();
+	
+	const std::vector<std::string> names = HttpCommandInterface::parseParameterList(listRoot);
+	
+	Json::Value getRoot;
+	if (!HttpCommandInterface::parseResponse(getBody, getRoot) || !HttpCommandInterface::checkErrorCode(getRoot))
+		return std::map<std::string, std::string>();
+	
+	return HttpCommandInterface::parseParameters(getRoot, names);
+}
+
+static std::map<std::string, std::string> parseLegacy(const std::string& listBody, const std::string& getBody)
+{
+	LegacyParser parser;
+	const std::vector<std::string> names = parser.parameterList(listBody);
+	return parser.parameters(getBody, names);
+}
+
+static std::string loadResponse(const std::string& name)
+{
+	std::ifstream in(ofToDataPath(name).c_str(), std::ios::binary);
+	std::stringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+// microseconds per iteration
+static double timeParser(std::map<std::string, std::string> (*parse)(const std::string&, const std::string&), const std::string& listBody, const std::string& getBody)
+{
+	std::size_t values = 0;
+	uint64_t start = ofGetElapsedTimeMicros();
+	for (int i=0; i<ITERATIONS; i++) {
+		values += parse(listBody, getBody).size();
+	}
+	uint64_t elapsed = ofGetElapsedTimeMicros() - start;
+	
+	// keep the result alive
+	if (values == 0) {
+		ofLogWarning("example_http_bench") << "no parameter values";
+	}
+	return (double)elapsed / ITERATIONS;
+}
+
+//========================================================================
+int main( ){
+	
+	const std::string listBody = loadResponse("list_parameters.json");
+	const std::string getBody = loadResponse("get_parameter.json");
+	
+	if (listBody.empty() || getBody.empty()) {
+		ofLogError("example_http_bench") << "responses not found in " << ofToDataPath("");
+		return 1;
+	}
+	
+	const std::map<std::string, std::string> current = parseCurrent(listBody, getBody);
+	const std::map<std::string, std::string> legacy = parseLegacy(listBody, getBody);
+	
+	ofLogNotice("example_http_bench") << current.size() << " parameters, " << listBody.size() << " + " << getBody.size() << " bytes, "
+		<< (current == legacy ? "same values" : "DIFFERENT values") << " from both parsers";
+	
+	// best of a few runs
+	double bestLegacy = 0;
+	double bestCurrent = 0;
+	for (int run=0; run<5; run++) {
+		const double l = timeParser(parseLegacy, listBody, getBody);
+		const double c = timeParser(parseCurrent, listBody, getBody);
+		bestLegacy = run == 0 ? l : std::min(bestLegacy, l);
+		bestCurrent = run == 0 ? c : std::min(bestCurrent, c);
+	}
+	
+	ofLogNotice("example_http_bench") << "list_parameters + get_parameter: legacy " << bestLegacy << " us, current " << bestCurrent << " us";
+	return 0;
+}
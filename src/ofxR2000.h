@@ -38,8 +38,21 @@
 #define OFX_R2000_H
 
 #include "r2000_driver.h"
+#include "cartesian_converter.h"
+#include "scan_timing.h"
 #include "ofxR2000DataReader.h"
 #include "ofxR2000DataWriter.h"
+#include "ofxR2000Fusion.h"
+#include "ofxR2000ScanFilter.h"
+#include "ofxR2000BackgroundModel.h"
+#include "ofxR2000Segmenter.h"
+#include "ofxR2000Tracker.h"
+#include "ofxR2000OccupancyGrid.h"
+#include "ofxR2000LineExtractor.h"
+#include "ofxR2000ScanMatcher.h"
+#include "ofxR2000GpuStream.h"
+#include "ofxR2000ScanHistory.h"
+#include "ofxR2000ScanRenderer.h"
 
 //! \class R2000Driver
 //! \brief Driver for the laserscanner R2000 of Pepperl+Fuchs
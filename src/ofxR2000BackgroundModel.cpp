@@ -0,0 +1,223 @@
+//
+//  ofxR2000BackgroundModel.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// per-beam background model of a static scene and foreground segmentation
+//
+
+#include "ofxR2000BackgroundModel.h"
+
+// spread of a beam before it has seen any data [mm]
+static const float INITIAL_SPREAD = 50.0f;
+
+// smallest quantile step [mm], so the model can still move on very stable beams
+static const float MIN_STEP = 1.0f;
+
+
+R2000BackgroundModel::R2000BackgroundModel() :
+	learning(true)
+	,learningRate(0.2f)
+	,adaptationRate(0.01f)
+	,quantile(0.9f)
+	,minDifference(100.0f)
+	,spreadFactor(3.0f)
+	,minBlobSize(3)
+	,maxBlobGap(2)
+	,maxBlobJump(200.0f)
+	,numBeams(0)
+	,startAngle(0)
+	,angularIncrement(0)
+	,numForeground(0)
+{}
+
+void R2000BackgroundModel::reset()
+{
+	numBeams = 0;
+	numForeground = 0;
+	blobs.clear();
+}
+
+bool R2000BackgroundModel::prepare(int numPointsScan, int32_t start, int32_t increment)
+{
+	if (numPointsScan <= 0) {
+		return false;
+	}
+	
+	if ((size_t)numPointsScan != numBeams || start != startAngle || increment != angularIncrement) {
+		
+		if (numBeams > 0) {
+			ofLogWarning("R2000BackgroundModel") << "scan configuration changed, learning a new model";
+		}
+		
+		numBeams = numPointsScan;
+		startAngle = start;
+		angularIncrement = increment;
+		
+		background.assign(numBeams, 0.0f);
+		spread.assign(numBeams, INITIAL_SPREAD);
+		initialized.assign(numBeams, 0);
+		distance.assign(numBeams, 0.0f);
+		foreground.assign(numBeams, 0);
+		
+		blobs.clear();
+		blobs.reserve(numBeams / 2 + 1);
+	}
+	
+	// beams of lost packets are neither foreground nor update the model
+	std::fill(distance.begin(), distance.end(), 0.0f);
+	std::fill(foreground.begin(), foreground.end(), 0);
+	numForeground = 0;
+	
+	return true;
+}
+
+template<class T>
+void R2000BackgroundModel::updateBeams(const uint32_t* distances, const T* amplitudes, size_t firstBeam, size_t count)
+{
+	if (firstBeam >= numBeams) {
+		return;
+	}
+	count = std::min(count, numBeams - firstBeam);
+	
+	const float rate = learning ? learningRate : adaptationRate;
+	const float up = quantile;
+	const float down = 1.0f - quantile;
+	
+	for (size_t i=0; i<count; i++) {
+		const size_t b = firstBeam + i;
+		
+		// no echo or error
+		if (distances[i] >= INVALID_DISTANCE || (amplitudes && amplitudes[i] < 32)) {
+			continue;
+		}
+		
+		const float d = (float)distances[i];
+		distance[b] = d;
+		
+		if (!initialized[b]) {
+			// no echo while learning, the background is out of range and every return is foreground
+			if (!learning) {
+				foreground[b] = 1;
+				numForeground++;
+				continue;
+			}
+			background[b] = d;
+			initialized[b] = 1;
+			continue;
+		}
+		
+		const float threshold = std::max(minDifference, spreadFactor * spread[b]);
+		const bool isForeground = !learning && d < background[b] - threshold;
+		
+		if (isForeground) {
+			foreground[b] = 1;
+			numForeground++;
+			continue;
+		}
+		
+		// running quantile: move up by q, down by 1-q, scaled with the spread of the beam
+		const float step = rate * std::max(spread[b], MIN_STEP);
+		background[b] += d > background[b] ? step * up : -step * down;
+		spread[b] += rate * (std::abs(d - background[b]) - spread[b]);
+	}
+}
+
+void R2000BackgroundModel::update(const ScanData& scan)
+{
+	if (scan.headers.empty()) {
+		return;
+	}
+	
+	const PacketHeader& first = scan.headers[0];
+	const int32_t start = first.first_angle - (int32_t)first.first_index * first.angular_increment;
+	if (!prepare(first.num_points_scan, start, first.angular_increment)) {
+		return;
+	}
+	
+	const bool hasAmplitudes = scan.amplitude_data.size() >= scan.distance_data.size();
+	
+	size_t offset = 0;
+	for (size_t h=0; h<scan.headers.size() && offset < scan.distance_data.size(); h++) {
+		const PacketHeader& header = scan.headers[h];
+		const size_t count = std::min((size_t)header.num_points_packet, scan.distance_data.size() - offset);
+		
+		updateBeams(&scan.distance_data[offset], hasAmplitudes ? &scan.amplitude_data[offset] : (const std::uint32_t*)0, header.first_index, count);
+		offset += count;
+	}
+	
+	findBlobs();
+}
+
+void R2000BackgroundModel::update(const CompactScanData& scan)
+{
+	if (!prepare(scan.info.num_points_scan, scan.info.start_angle, scan.info.angular_increment)) {
+		return;
+	}
+	
+	const size_t count = std::min(scan.distance_data.size(), numBeams);
+	// packet type A scans have no amplitudes
+	const bool hasAmplitudes = !scan.amplitude_data.empty() && scan.amplitude_data.size() >= count;
+	
+	if (count > 0) {
+		updateBeams(scan.distance_data.data(), hasAmplitudes ? scan.amplitude_data.data() : (const uint16_t*)0, 0, count);
+	}
+	
+	findBlobs();
+}
+
+void R2000BackgroundModel::findBlobs()
+{
+	blobs.clear();
+	
+	if (numForeground == 0) {
+		return;
+	}
+	
+	const AngleTable& table = converter.getTable(numBeams, startAngle, angularIncrement);
+	
+	R2000Blob blob;
+	bool open = false;
+	size_t lastBeam = 0;
+	
+	for (size_t b=0; b<numBeams; b++) {
+		if (!foreground[b]) {
+			continue;
+		}
+		
+		const float d = distance[b];
+		
+		// continue the open blob or close it
+		if (open && (b - lastBeam > maxBlobGap + 1 || std::abs(d - distance[lastBeam]) > maxBlobJump)) {
+			if (blob.numPoints >= minBlobSize) {
+				blob.x /= blob.numPoints;
+				blob.y /= blob.numPoints;
+				blobs.push_back(blob);
+			}
+			open = false;
+		}
+		
+		if (!open) {
+			blob.firstBeam = b;
+			blob.numPoints = 0;
+			blob.x = 0.0f;
+			blob.y = 0.0f;
+			blob.minDistance = d;
+			open = true;
+		}
+		
+		blob.lastBeam = b;
+		blob.numPoints++;
+		blob.x += d * table.cos_table[b];
+		blob.y += d * table.sin_table[b];
+		blob.minDistance = std::min(blob.minDistance, d);
+		lastBeam = b;
+	}
+	
+	if (open && blob.numPoints >= minBlobSize) {
+		blob.x /= blob.numPoints;
+		blob.y /= blob.numPoints;
+		blobs.push_back(blob);
+	}
+}
@@ -0,0 +1,122 @@
+//
+//  ofxR2000BackgroundModel.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// per-beam background model of a static scene and foreground segmentation
+//
+
+#ifndef ofxR2000BackgroundModel_h
+#define ofxR2000BackgroundModel_h
+
+#include "ofMain.h"
+#include "compact_scan_data.h"
+#include "cartesian_converter.h"
+
+using namespace pepperl_fuchs;
+
+// consecutive foreground beams
+struct R2000Blob
+{
+	size_t firstBeam;
+	size_t lastBeam;
+	size_t numPoints;
+	
+	// centroid in millimeter, scanner frame
+	float x;
+	float y;
+	
+	// closest distance in millimeter
+	float minDistance;
+};
+
+// learns a distance per beam from scans of the empty scene and marks closer samples as foreground
+// the background of a beam is a running quantile of its distances, the threshold adapts to the spread of the beam
+// beams without an echo while learning look into open space, any later return on them is foreground
+// update() is O(samples) and does not allocate once the scan configuration is known
+class R2000BackgroundModel
+{
+public:
+	R2000BackgroundModel();
+	
+	// learning: every valid sample updates the model with the learning rate
+	// otherwise only background samples update it with the adaptation rate
+	void setLearning(bool learn) { learning = learn; };
+	bool isLearning() const { return learning; };
+	
+	void setLearningRate(float rate) { learningRate = rate; };
+	float getLearningRate() const { return learningRate; };
+	
+	// 0 freezes the model after learning
+	void setAdaptationRate(float rate) { adaptationRate = rate; };
+	float getAdaptationRate() const { return adaptationRate; };
+	
+	// quantile of the distances taken as background, high values ignore passing objects
+	void setQuantile(float q) { quantile = ofClamp(q, 0.5f, 0.99f); };
+	float getQuantile() const { return quantile; };
+	
+	// a sample is foreground if it is closer than background - max(minDifference, spreadFactor * spread)
+	void setMinDifference(float mm) { minDifference = mm; };
+	float getMinDifference() const { return minDifference; };
+	void setSpreadFactor(float factor) { spreadFactor = factor; };
+	float getSpreadFactor() const { return spreadFactor; };
+	
+	// blobs: smaller blobs are dropped, gaps up to maxGap beams and distance jumps up to maxJump mm are bridged
+	void setMinBlobSize(size_t numPoints) { minBlobSize = numPoints; };
+	void setMaxBlobGap(size_t beams) { maxBlobGap = beams; };
+	void setMaxBlobJump(float mm) { maxBlobJump = mm; };
+	
+	// forget the model
+	void reset();
+	
+	void update(const ScanData& scan);
+	void update(const CompactScanData& scan);
+	
+	bool hasModel() const { return numBeams > 0; };
+	size_t getNumBeams() const { return numBeams; };
+	
+	// per beam, valid after update()
+	const std::vector<uint8_t>& getForegroundMask() const { return foreground; };
+	const std::vector<float>& getBackground() const { return background; };
+	const std::vector<float>& getSpread() const { return spread; };
+	size_t getNumForeground() const { return numForeground; };
+	
+	const std::vector<R2000Blob>& getBlobs() const { return blobs; };
+	
+	
+private:
+	bool prepare(int numPointsScan, int32_t startAngle, int32_t angularIncrement);
+	template<class T> void updateBeams(const uint32_t* distances, const T* amplitudes, size_t firstBeam, size_t count);
+	void findBlobs();
+	
+	bool learning;
+	float learningRate;
+	float adaptationRate;
+	float quantile;
+	float minDifference;
+	float spreadFactor;
+	size_t minBlobSize;
+	size_t maxBlobGap;
+	float maxBlobJump;
+	
+	// scan configuration of the model
+	size_t numBeams;
+	int32_t startAngle;
+	int32_t angularIncrement;
+	
+	std::vector<float> background;
+	std::vector<float> spread;
+	std::vector<uint8_t> initialized;
+	
+	// current scan
+	std::vector<float> distance;
+	std::vector<uint8_t> foreground;
+	size_t numForeground;
+	
+	std::vector<R2000Blob> blobs;
+	
+	CartesianConverter converter;
+};
+
+#endif /* ofxR2000BackgroundModel_h */
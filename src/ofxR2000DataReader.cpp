@@ -9,6 +9,7 @@
 #include "ofxR2000DataReader.h"
 
 #include <zlib.h>
+#include <cstring>
 
 static int sps[] = {25200, 16800, 12600, 10080, 8400, 7200, 6300, 5600, 5040, 4200, 3600, 2400, 1800, 1440, 1200, 900, 800, 720, 600, 480, 450, 400, 360, 240, 180, 144, 120, 90, 72};
 static int sps_size = sizeof(sps) / sizeof(int);
@@ -16,8 +17,11 @@ static int sps_size = sizeof(sps) / sizeof(int);
 
 /*
  */
-static void zipuncompress_uint32( const std::vector< unsigned char > & src, std::vector< std::uint32_t > & ret )
+template<class V>
+static void zipuncompress( const std::vector< unsigned char > & src, V & ret )
 {
+	typedef typename V::value_type T;
+	
 	if ( src.size() < 4 ) {
 		ret.clear();
 		return;
@@ -33,14 +37,14 @@ static void zipuncompress_uint32( const std::vector< unsigned char > & src, std:
 	}
 	
 	ret.resize( originalSize, 0 );
-	unsigned long ret_size = originalSize * sizeof(std::uint32_t);
+	unsigned long ret_size = originalSize * sizeof(T);
 	{
 		// try to uncompress with sizeof( uLongf )
 		int error = uncompress( (unsigned char*)ret.data(), &ret_size, src.data() + sizeof( uLongf ), src.size() );
 		
 		if ( error == Z_OK )
 		{
-			ret.resize( ret_size / sizeof(std::uint32_t), 0 );
+			ret.resize( ret_size / sizeof(T), 0 );
 		}
 		else
 		{
@@ -60,9 +64,9 @@ static void zipuncompress_uint32( const std::vector< unsigned char > & src, std:
 			
 			if ( error == Z_OK )
 			{
-				ret.resize( ret_size / sizeof(std::uint32_t), 0 );
+				ret.resize( ret_size / sizeof(T), 0 );
 			} else {
-				ofLogError( "zipuncompress_uint32()" ) << "zlib uncompress() error: " << error;
+				ofLogError( "zipuncompress()" ) << "zlib uncompress() error: " << error;
 				ret.clear();
 			}
 		}
@@ -81,6 +85,8 @@ R2000DataReader::R2000DataReader() :
 	,lastUpdate(0)
 	,isOpen(false)
 	,scan_data_()
+	,compactOutput(false)
+	,overflowReported(false)
 {}
 
 R2000DataReader::R2000DataReader(string& filepath) : R2000DataReader() {
@@ -168,39 +174,167 @@ void R2000DataReader::initRead() {
 
 ScanData R2000DataReader::getScan() {
 	unique_lock<std::mutex> lock(mutex);
+	
+	if (scan_data_.empty()) {
+		return ScanData();
+	}
+	
 	ScanData data(std::move(scan_data_.front()));
 	scan_data_.pop_front();
+	queueChanged.notify_one();
 	return data;
+}
 
+CompactScanData R2000DataReader::getCompactScan() {
+	unique_lock<std::mutex> lock(mutex);
+	
+	if (compact_scan_data_.empty()) {
+		return CompactScanData();
+	}
+	
+	CompactScanData data(std::move(compact_scan_data_.front()));
+	compact_scan_data_.pop_front();
+	queueChanged.notify_one();
+	return data;
 }
 
 std::size_t R2000DataReader::getScansAvailable()
 {
 	unique_lock<std::mutex> lock(mutex);
-	return scan_data_.size();
+	return compactOutput ? compact_scan_data_.size() : scan_data_.size();
 }
 
 std::size_t R2000DataReader::getFullScansAvailable() {
 	return getScansAvailable();
 }
 
+void R2000DataReader::setCompactOutput(bool compact) {
+	unique_lock<std::mutex> lock(mutex);
+	
+	if (compact == compactOutput) {
+		return;
+	}
+	
+	compactOutput = compact;
+	scan_data_.clear();
+	compact_scan_data_.clear();
+	queueChanged.notify_one();
+}
 
+void R2000DataReader::setQueuePolicy(ScanQueuePolicy policy, std::size_t capacity) {
+	unique_lock<std::mutex> lock(mutex);
+	
+	queueControl.setPolicy(policy, capacity);
+	overflowReported = false;
+	queueChanged.notify_one();
+}
 
-void R2000DataReader::getNextScan()
+ScanQueuePolicy R2000DataReader::getQueuePolicy() {
+	unique_lock<std::mutex> lock(mutex);
+	return queueControl.getPolicy();
+}
+
+std::size_t R2000DataReader::getQueueCapacity() {
+	unique_lock<std::mutex> lock(mutex);
+	return queueControl.getCapacity();
+}
+
+ScanQueueCounters R2000DataReader::getQueueCounters() {
+	unique_lock<std::mutex> lock(mutex);
+	return queueControl.getCounters();
+}
+
+
+
+/*
+ */
+template<class V>
+static void readElements( ofFile & infile, V & data, uint8_t flags, std::uint32_t vectorSize )
 {
-	// update internal data
-	bool isCompressed = false;
+	if (flags & R2000_BLOCK_COMPRESSED) {
+		std::vector<unsigned char> compressed;
+		compressed.resize(vectorSize);
+		infile.read((char*)compressed.data(), vectorSize);
+		
+		zipuncompress(compressed, data);
+	} else {
+		data.resize(vectorSize);
+		infile.read((char*)data.data(), (vectorSize * sizeof(typename V::value_type)));
+	}
+}
+
+template<class T>
+static T readValue(const char*& p)
+{
+	T value;
+	std::memcpy(&value, p, sizeof(T));
+	p += sizeof(T);
+	return value;
+}
+
+// fields of a ScanInfo record as written by R2000DataWriter, false for an unknown version
+static bool readScanInfo(const std::vector<char>& record, ScanInfo& info)
+{
+	if (record.size() < R2000_SCAN_INFO_SIZE_V1 || (uint8_t)record[0] < 1) {
+		return false;
+	}
+	
+	// newer versions only append fields
+	const char* p = record.data() + 1;
+	info.scan_number = readValue<uint16_t>(p);
+	info.timestamp_first = readValue<uint64_t>(p);
+	info.timestamp_last = readValue<uint64_t>(p);
+	info.host_time_first = 0;
+	info.host_time_last = 0;
+	info.first_index = readValue<uint16_t>(p);
+	info.scan_frequency = readValue<uint32_t>(p);
+	info.num_points_scan = readValue<uint16_t>(p);
+	info.start_angle = readValue<int32_t>(p);
+	info.angular_increment = readValue<int32_t>(p);
+	info.status_flags = readValue<uint32_t>(p);
+	info.num_points_received = readValue<uint32_t>(p);
+	info.num_packets = readValue<uint16_t>(p);
+	info.follows_gap = readValue<uint8_t>(p);
+	info.packet_type = readValue<uint16_t>(p);
+	return true;
+}
+
+template<class V>
+void R2000DataReader::readBlock(V& data, uint8_t flags)
+{
+	typedef typename V::value_type T;
 	
 	uint8_t readSize;
-	std::uint32_t vectorSize;
+	std::uint32_t vectorSize = 0;
+	
+	infile.read((char*)&readSize, sizeof(uint8_t));
+	infile.read((char*)&vectorSize, readSize);
 	
-	scan_data_.emplace_back();
+	bool is16bit = (flags & R2000_BLOCK_UINT16) != 0;
 	
-//	ScanData newScan = scan_data_.back();
-	ScanData newScan;
-	newScan.distance_data.resize(samplesPerScan);
-	newScan.amplitude_data.resize(samplesPerScan);
+	if (is16bit == (sizeof(T) == sizeof(std::uint16_t))) {
+		// elements in the file match the vector
+		readElements(infile, data, flags, vectorSize);
+	} else if (is16bit) {
+		// 16 bit in file, 32 bit wanted
+		std::vector<std::uint16_t> tmp;
+		readElements(infile, tmp, flags, vectorSize);
+		data.assign(tmp.begin(), tmp.end());
+	} else {
+		// 32 bit in file, 16 bit wanted
+		std::vector<std::uint32_t> tmp;
+		readElements(infile, tmp, flags, vectorSize);
+		data.resize(tmp.size());
+		for (std::size_t i=0; i<tmp.size(); i++) {
+			data[i] = (T)tmp[i];
+		}
+	}
+}
 
+void R2000DataReader::getNextScan()
+{
+	uint8_t readSize;
+	uint8_t flags;
 	
 	//----------------------------------------------------
 	// get count
@@ -216,81 +350,101 @@ void R2000DataReader::getNextScan()
 	infile.read((char*)&count, readSize);
 	
 	
-	//----------------------------------------------------
-	// distance data
-	
-	// compression-flag
-	infile.read((char*)&isCompressed, 1);
+	// flags of first block
+	infile.read((char*)&flags, 1);
 	
-	infile.read((char*)&readSize, sizeof(uint8_t));
-	infile.read((char*)&vectorSize, readSize);
-	if (isCompressed) {
-		std::vector<unsigned char> data;
-		data.resize(vectorSize);
-		infile.read((char*)data.data(), vectorSize);
+	if (flags & R2000_BLOCK_SCAN_INFO) {
 		
-		zipuncompress_uint32(data, newScan.distance_data);
+		//----------------------------------------------------
+		// compact scan: scan info, distance data, amplitude data
+		CompactScanData newScan;
 		
-		// correct
-		vectorSize = newScan.distance_data.size();
-	} else {
-		if (newScan.distance_data.size() != vectorSize) {
-			ofLogNotice() << "resize distance vector";
-			newScan.distance_data.resize(vectorSize);
+		std::uint32_t vectorSize = 0;
+		infile.read((char*)&readSize, sizeof(uint8_t));
+		infile.read((char*)&vectorSize, readSize);
+		
+		// size of the record in bytes
+		std::vector<char> record(vectorSize);
+		if (vectorSize > 0) {
+			infile.read(record.data(), vectorSize);
 		}
-		infile.read((char*)newScan.distance_data.data(), (vectorSize * sizeof(std::uint32_t)));
-	}
-	
-	
-	//----------------------------------------------------
-	// amplitude data
-	
-	// compression-flag
-	infile.read((char*)&isCompressed, 1);
-	
-	infile.read((char*)&readSize, sizeof(uint8_t));
-	infile.read((char*)&vectorSize, readSize);
-	if (isCompressed) {
-		std::vector<unsigned char> data;
-		data.resize(vectorSize);
-		infile.read((char*)data.data(), vectorSize);
 		
-		zipuncompress_uint32(data, newScan.amplitude_data);
-		// correct
-		vectorSize = newScan.amplitude_data.size();
-	} else {
-		if (newScan.amplitude_data.size() != vectorSize) {
-			ofLogNotice() << "resize amplitude vector";
-			newScan.amplitude_data.resize(vectorSize);
+		infile.read((char*)&flags, 1);
+		readBlock(newScan.distance_data, flags);
+		
+		infile.read((char*)&flags, 1);
+		readBlock(newScan.amplitude_data, flags);
+		
+		if (!readScanInfo(record, newScan.info)) {
+			ofLogError("R2000DataReader") << "unsupported scan info record, skipping scan " << count;
+			return;
 		}
-		infile.read((char*)newScan.amplitude_data.data(), (vectorSize * sizeof(std::uint32_t)));
-	}
-	
-	
-	//----------------------------------------------------
-	// header data
-	
-	// compression-flag
-	infile.read((char*)&isCompressed, 1);
-	
-	infile.read((char*)&readSize, sizeof(uint8_t));
-	infile.read((char*)&vectorSize, readSize);
-	if (isCompressed || !isCompressed) {
-		if (newScan.headers.size() != vectorSize) {
-			newScan.headers.resize(vectorSize);
+		
+		if (compactOutput) {
+			queueScan(newScan);
+		} else {
+			ScanData scan;
+			expandScanData(newScan, scan);
+			queueScan(scan);
 		}
+		
+	} else {
+		
+		//----------------------------------------------------
+		// scan with packet headers: distance data, amplitude data, header data
+		ScanData newScan;
+		
+		readBlock(newScan.distance_data, flags);
+		
+		infile.read((char*)&flags, 1);
+		readBlock(newScan.amplitude_data, flags);
+		
+		// headers are never compressed
+		std::uint32_t vectorSize = 0;
+		infile.read((char*)&flags, 1);
+		infile.read((char*)&readSize, sizeof(uint8_t));
+		infile.read((char*)&vectorSize, readSize);
+		newScan.headers.resize(vectorSize);
 		infile.read((char*)newScan.headers.data(), (vectorSize * sizeof(PacketHeader)));
+		
+		if (compactOutput) {
+			CompactScanData scan;
+			compactScanData(newScan, scan);
+			queueScan(scan);
+		} else {
+			queueScan(newScan);
+		}
 	}
-	//		ofLogNotice() << "HEADERS: " << vectorSize;
-	
+}
+
+template<class T>
+void R2000DataReader::queueScan(std::deque<T>& queue, T& scan)
+{
+	std::size_t dropped = 0;
 	
-	// add new scandata to queue
-	if(scan_data_.size() > 100) {
-		scan_data_.pop_front();
-		std::cerr << "Too many scans in receiver queue: Dropping scans!" << std::endl;
+	if (queueControl.rejectNewScan(queue.size())) {
+		dropped = 1;
+	} else {
+		// scans in the queue are complete, SCAN_QUEUE_KEEP_LATEST replaces all of them
+		dropped = queueControl.makeRoom(queue);
+		queue.push_back(std::move(scan));
+		queueControl.addQueued(queue.size());
 	}
 	
-	scan_data_.push_back(newScan);
+	if (dropped > 0 && !overflowReported) {
+		std::cerr << "Too many scans in reader queue: Dropping scans! See getQueueCounters()" << std::endl;
+		overflowReported = true;
+	}
+}
+
+void R2000DataReader::queueScan(ScanData& scan)
+{
+	queueScan(scan_data_, scan);
+}
+
+void R2000DataReader::queueScan(CompactScanData& scan)
+{
+	queueScan(compact_scan_data_, scan);
 }
 
 
@@ -298,15 +452,29 @@ void R2000DataReader::threadedFunction()
 {
 	while(isThreadRunning())
 	{
-		// Attempt to lock the mutex.  If blocking is turned on,
-		if(lock())
 		{
+			unique_lock<std::mutex> lock(mutex);
+			
+			// SCAN_QUEUE_BLOCK_PRODUCER: wait for the consumer instead of dropping scans
+			// wake up regularly to notice stopThread()
+			bool blocked = false;
+			while (isThreadRunning() && queueControl.producerMustWait(compactOutput ? compact_scan_data_.size() : scan_data_.size())) {
+				if (!blocked) {
+					queueControl.addProducerBlock();
+					blocked = true;
+				}
+				queueChanged.wait_for(lock, std::chrono::milliseconds(100));
+			}
+			
+			if (!isThreadRunning()) {
+				break;
+			}
+			
 			// update lastScanData
 			getNextScan();
-			unlock();
-			
-			usleep(1000 * updateTime);
 		}
+		
+		usleep(1000 * updateTime);
 	}
 }
 
@@ -14,6 +14,8 @@
 #include "ofMain.h"
 #include "ofThread.h"
 
+#include <condition_variable>
+
 #include "ofxR2000.h"
 
 using namespace pepperl_fuchs;
@@ -37,14 +39,32 @@ public:
 	uint64_t getCount() { return count; };
 	
 	ScanData getScan();
+	CompactScanData getCompactScan();
 	std::size_t getScansAvailable();
 	std::size_t getFullScansAvailable();
 	
+	// deliver scans as CompactScanData (getCompactScan) instead of ScanData (getScan)
+	// both recording formats are converted as needed
+	void setCompactOutput(bool compact);
+	bool getCompactOutput() { return compactOutput; };
+	
+	// capacity and overflow policy of the scan queue, default SCAN_QUEUE_DROP_OLDEST with 100 scans
+	// SCAN_QUEUE_BLOCK_PRODUCER pauses reading the file until a scan is popped, so no scan is lost
+	// SCAN_QUEUE_KEEP_LATEST only keeps the newest scan
+	void setQueuePolicy(ScanQueuePolicy policy, std::size_t capacity = SCAN_QUEUE_DEFAULT_CAPACITY);
+	ScanQueuePolicy getQueuePolicy();
+	std::size_t getQueueCapacity();
+	ScanQueueCounters getQueueCounters();
+	
 	
 private:
 	void threadedFunction();
 	void initRead();
 	void getNextScan();
+	void queueScan(ScanData& scan);
+	void queueScan(CompactScanData& scan);
+	template<class T> void queueScan(std::deque<T>& queue, T& scan);
+	template<class V> void readBlock(V& data, uint8_t flags);
 	
 	ofFile infile;
 	bool isOpen;
@@ -55,6 +75,14 @@ private:
 	int samplesPerScan, scanFrequency;
 	
 	std::deque<ScanData> scan_data_;
+	std::deque<CompactScanData> compact_scan_data_;
+	bool compactOutput;
+	
+	ScanQueueControl queueControl;
+	bool overflowReported;
+	
+	// signaled when a scan is popped or the policy changes, the reading thread waits on it with SCAN_QUEUE_BLOCK_PRODUCER
+	std::condition_variable queueChanged;
 	
 //	ScanData lastScanData;
 	
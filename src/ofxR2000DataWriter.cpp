@@ -8,20 +8,23 @@
 #include <zlib.h>
 
 #include "ofxR2000DataWriter.h"
+#include "trace.h"
 
 
 static std::vector< unsigned char >
-zipcompress( const std::vector< std::uint32_t > & src, int level )
+zipcompress( const void* src, std::size_t count, std::size_t elementSize, int level )
 {
+	R2000_TRACE_SCOPE("zlib compress");
+	
 	std::vector< unsigned char > ret;
 	
-	uLongf ret_size = ::compressBound( src.size() * sizeof(std::uint32_t) );
+	uLongf ret_size = ::compressBound( count * elementSize );
 	ret.resize( ret_size + sizeof( uLongf ) );
 	
 	
 	if ( level == 0 )
 	{
-		int error = ::compress( ret.data() + sizeof( uLongf ), &ret_size, (unsigned char*)src.data(), src.size()*sizeof(std::uint32_t) );
+		int error = ::compress( ret.data() + sizeof( uLongf ), &ret_size, (const unsigned char*)src, count * elementSize );
 		if ( error == Z_OK )
 		{
 			ret.resize( ret_size + sizeof( uLongf ), 0 );
@@ -34,7 +37,7 @@ zipcompress( const std::vector< std::uint32_t > & src, int level )
 	}
 	else
 	{
-		int error = compress2( ret.data() + sizeof( uLongf ), &ret_size, (unsigned char*)src.data(), src.size()*sizeof(std::uint32_t), level );
+		int error = compress2( ret.data() + sizeof( uLongf ), &ret_size, (const unsigned char*)src, count * elementSize, level );
 		if ( error == Z_OK )
 		{
 			ret.resize( ret_size + sizeof( uLongf ), 0 );
@@ -48,7 +51,7 @@ zipcompress( const std::vector< std::uint32_t > & src, int level )
 	
 	/// push header (size of compressed buffer)
 	{
-		uLongf originalSize = src.size();
+		uLongf originalSize = count;
 		ret[0] = ( originalSize >> 24 ) & 0xFF;
 		ret[1] = ( originalSize >> 16 ) & 0xFF;
 		ret[2] = ( originalSize >>  8 ) & 0xFF;
@@ -127,75 +130,121 @@ void R2000DataWriter::init(uint32_t samplesPerScan, uint32_t scanFrequency) {
 	bisInit = true;
 }
 
-void R2000DataWriter::writeScanData(ScanData& data) {
-	
-	if (!bisInit) {
-		ofLogError() << "ScanDataWriter is not inited. Please call init(...) before writing ScanData.";
-		return;
-	}
-	
-	std::uint32_t* dd = data.distance_data.data();
-	std::uint32_t* da = data.amplitude_data.data();
-	PacketHeader* headers = data.headers.data();
+template<class T>
+static void appendValue(std::vector<char>& record, T value)
+{
+	const char* p = (const char*)&value;
+	record.insert(record.end(), p, p + sizeof(T));
+}
+
+void R2000DataWriter::appendCounter(ofBuffer& dataBuffer) {
 	
 	uint8_t sizeofint64 = sizeof(std::uint64_t);
-	uint8_t sizeouint32 = sizeof(std::uint32_t);
-	
-	ofBuffer dataBuffer;
 	
-	// counter
 	dataBuffer.append((char*)&sizeofint64, sizeof(uint8_t));
 	dataBuffer.append((char*)&counter, sizeofint64);
+}
+
+void R2000DataWriter::appendBlock(ofBuffer& dataBuffer, const void* data, std::size_t count, std::size_t elementSize, uint8_t flags) {
 	
+	uint8_t sizeouint32 = sizeof(std::uint32_t);
 	
-	
-	
-	// distance
-	// compression-flag
-	dataBuffer.append((char*)&doCompress, 1);
-	if (doCompress) {
-		vector< unsigned char > compressed = zipcompress( data.distance_data, 0 );
+	// flags, bit 0 is the compression-flag
+	dataBuffer.append((char*)&flags, 1);
+	if (flags & R2000_BLOCK_COMPRESSED) {
+		vector< unsigned char > compressed = zipcompress( data, count, elementSize, 0 );
 		std::uint32_t vectorSize = compressed.size();
 		dataBuffer.append((char*)&sizeouint32, sizeof(uint8_t));
 		dataBuffer.append((char*)&vectorSize, sizeouint32);
 		dataBuffer.append((const char *)compressed.data(), vectorSize);
 	} else {
 		// uncompressed
-		std::uint32_t vectorSize = data.distance_data.size();
+		std::uint32_t vectorSize = count;
 		dataBuffer.append((char*)&sizeouint32, sizeof(uint8_t));
 		dataBuffer.append((char*)&vectorSize, sizeouint32);
-		dataBuffer.append((const char *)dd, vectorSize*sizeof(std::uint32_t));
+		dataBuffer.append((const char *)data, count * elementSize);
 	}
+}
+
+void R2000DataWriter::writeScanData(ScanData& data) {
 	
-	// amp size of elements
-	// compression-flag
-	dataBuffer.append((char*)&doCompress, 1);
-	if (doCompress) {
-		vector< unsigned char > compressed = zipcompress( data.amplitude_data, 0 );
-		std::uint32_t vectorSize = compressed.size();
-		dataBuffer.append((char*)&sizeouint32, sizeof(uint8_t));
-		dataBuffer.append((char*)&vectorSize, sizeof(std::uint32_t));
-		dataBuffer.append((const char *)compressed.data(), vectorSize);
-	} else {
-		// uncompressed
-		std::uint32_t vectorSize = data.amplitude_data.size();
-		dataBuffer.append((char*)&sizeouint32, sizeof(uint8_t));
-		dataBuffer.append((char*)&vectorSize, sizeouint32);
-		dataBuffer.append((const char *)da, vectorSize*sizeof(std::uint32_t));
+	R2000_TRACE_SCOPE("writeScanData");
+	
+	if (!bisInit) {
+		ofLogError() << "ScanDataWriter is not inited. Please call init(...) before writing ScanData.";
+		return;
 	}
 	
-	// headers
-	// compression-flag - don't compress headers for now
-	bool bFalse = false;
-	dataBuffer.append((char*)&bFalse, 1);
-	if (doCompress || !doCompress) {
-		std::uint32_t  vectorSize = data.headers.size();
-		dataBuffer.append((char*)&sizeouint32, sizeof(uint8_t));
-		dataBuffer.append((char*)&vectorSize, sizeouint32);
-		dataBuffer.append((const char *)headers, vectorSize*sizeof(PacketHeader));
+	uint8_t compressFlag = doCompress ? R2000_BLOCK_COMPRESSED : 0;
+	
+	ofBuffer dataBuffer;
+	
+	// counter
+	appendCounter(dataBuffer);
+	
+	// distance
+	appendBlock(dataBuffer, data.distance_data.data(), data.distance_data.size(), sizeof(std::uint32_t), compressFlag);
+	
+	// amplitude
+	appendBlock(dataBuffer, data.amplitude_data.data(), data.amplitude_data.size(), sizeof(std::uint32_t), compressFlag);
+	
+	// headers - don't compress headers for now
+	appendBlock(dataBuffer, data.headers.data(), data.headers.size(), sizeof(PacketHeader), 0);
+	
+	{
+		R2000_TRACE_SCOPE("file write");
+		file.writeFromBuffer(dataBuffer);
 	}
 	
-	file.writeFromBuffer(dataBuffer);
+	counter++;
+}
+
+void R2000DataWriter::writeScanData(CompactScanData& data) {
+	
+	R2000_TRACE_SCOPE("writeScanData");
+	
+	if (!bisInit) {
+		ofLogError() << "ScanDataWriter is not inited. Please call init(...) before writing ScanData.";
+		return;
+	}
+	
+	uint8_t compressFlag = doCompress ? R2000_BLOCK_COMPRESSED : 0;
+	
+	ofBuffer dataBuffer;
+	
+	// counter
+	appendCounter(dataBuffer);
+	
+	// scan info - a single uncompressed record, marks the scan as compact
+	const ScanInfo& info = data.info;
+	std::vector<char> record;
+	record.reserve(R2000_SCAN_INFO_SIZE_V1);
+	appendValue(record, R2000_SCAN_INFO_VERSION);
+	appendValue(record, info.scan_number);
+	appendValue(record, info.timestamp_first);
+	appendValue(record, info.timestamp_last);
+	appendValue(record, info.first_index);
+	appendValue(record, info.scan_frequency);
+	appendValue(record, info.num_points_scan);
+	appendValue(record, info.start_angle);
+	appendValue(record, info.angular_increment);
+	appendValue(record, info.status_flags);
+	appendValue(record, info.num_points_received);
+	appendValue(record, info.num_packets);
+	appendValue(record, info.follows_gap);
+	appendValue(record, info.packet_type);
+	appendBlock(dataBuffer, record.data(), record.size(), 1, R2000_BLOCK_SCAN_INFO);
+	
+	// distance
+	appendBlock(dataBuffer, data.distance_data.data(), data.distance_data.size(), sizeof(std::uint32_t), compressFlag);
+	
+	// amplitude
+	appendBlock(dataBuffer, data.amplitude_data.data(), data.amplitude_data.size(), sizeof(std::uint16_t), compressFlag | R2000_BLOCK_UINT16);
+	
+	{
+		R2000_TRACE_SCOPE("file write");
+		file.writeFromBuffer(dataBuffer);
+	}
 	
 	counter++;
-}
\ No newline at end of file
+}
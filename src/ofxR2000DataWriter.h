@@ -14,6 +14,20 @@
 
 using namespace pepperl_fuchs;
 
+// flags of a data block in a recording
+enum R2000BlockFlags {
+	R2000_BLOCK_COMPRESSED	= 0x01,	// data is zlib compressed
+	R2000_BLOCK_UINT16		= 0x02,	// elements are 16 bit instead of 32 bit
+	R2000_BLOCK_SCAN_INFO	= 0x04	// scan is stored in compact form, this block holds its ScanInfo record, the count is its size in bytes
+};
+
+// ScanInfo record: this version byte followed by the fields one by one, independent of the layout of the struct
+//	scan_number, timestamp_first, timestamp_last, first_index, scan_frequency, num_points_scan, start_angle,
+//	angular_increment, status_flags, num_points_received, num_packets, follows_gap, packet_type
+// newer versions only append fields, host times are local to the recording process and not stored
+static const uint8_t R2000_SCAN_INFO_VERSION = 1;
+static const std::size_t R2000_SCAN_INFO_SIZE_V1 = 48;
+
 class R2000DataWriter {
 	
 public:
@@ -28,6 +42,8 @@ public:
 	
 	void init(uint32_t samplesPerScan, uint32_t scanFrequency);
 	void writeScanData(ScanData& data);
+	// write a compact scan: ScanInfo record followed by distance and 16 bit amplitude blocks
+	void writeScanData(CompactScanData& data);
 	
 	void setCompress(bool val) { doCompress = val; };
 	bool getCompress() const { return doCompress; };
@@ -37,6 +53,9 @@ public:
 	
 	
 private:
+	void appendCounter(ofBuffer& dataBuffer);
+	void appendBlock(ofBuffer& dataBuffer, const void* data, std::size_t count, std::size_t elementSize, uint8_t flags);
+	
 	ofFile file;
 	uint64_t counter;
 	bool doCompress;
@@ -0,0 +1,218 @@
+//
+//  ofxR2000Fusion.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// merges the scans of several scanners into one point cloud in a common frame
+//
+
+#include "ofxR2000Fusion.h"
+
+#include <limits>
+
+
+R2000Fusion::R2000Fusion(size_t numThreads) :
+	pool(numThreads)
+	,scale(1.0f)
+	,maxTimeDifference(0.1)
+	,dropInvalid(true)
+{
+	cloud.time = 0;
+}
+
+size_t R2000Fusion::addScanner(R2000Driver* driver, const ofMatrix4x4& extrinsics)
+{
+	std::unique_ptr<Scanner> s(new Scanner());
+	s->driver = driver;
+	s->converter.setScale(scale);
+	s->scanTime = 0;
+	s->hasScan = false;
+	s->fresh = false;
+	setMatrix(*s, extrinsics);
+	
+	scanners.push_back(std::move(s));
+	return scanners.size() - 1;
+}
+
+size_t R2000Fusion::addScanner(R2000Driver* driver, float x, float y, float headingDeg)
+{
+	return addScanner(driver, poseMatrix(x, y, headingDeg));
+}
+
+void R2000Fusion::setExtrinsics(size_t index, const ofMatrix4x4& extrinsics)
+{
+	if (index >= scanners.size()) {
+		ofLogError("R2000Fusion") << "no scanner with index " << index;
+		return;
+	}
+	
+	setMatrix(*scanners[index], extrinsics);
+}
+
+void R2000Fusion::setExtrinsics(size_t index, float x, float y, float headingDeg)
+{
+	setExtrinsics(index, poseMatrix(x, y, headingDeg));
+}
+
+ofMatrix4x4 R2000Fusion::getExtrinsics(size_t index) const
+{
+	if (index >= scanners.size()) {
+		return ofMatrix4x4();
+	}
+	
+	return scanners[index]->extrinsics;
+}
+
+void R2000Fusion::setScale(float s)
+{
+	scale = s;
+	
+	for (size_t i=0; i<scanners.size(); i++) {
+		scanners[i]->converter.setScale(scale);
+	}
+}
+
+ofMatrix4x4 R2000Fusion::poseMatrix(float x, float y, float headingDeg)
+{
+	ofMatrix4x4 m;
+	m.makeRotationMatrix(headingDeg, ofVec3f(0, 0, 1));
+	m.setTranslation(x, y, 0);
+	return m;
+}
+
+void R2000Fusion::setMatrix(Scanner& s, const ofMatrix4x4& extrinsics)
+{
+	s.extrinsics = extrinsics;
+	
+	// points are transformed like ofVec3f * ofMatrix4x4
+	ofVec3f t = extrinsics.preMult(ofVec3f(0, 0, 0));
+	ofVec3f ex = extrinsics.preMult(ofVec3f(1, 0, 0)) - t;
+	ofVec3f ey = extrinsics.preMult(ofVec3f(0, 1, 0)) - t;
+	ofVec3f ez = extrinsics.preMult(ofVec3f(0, 0, 1)) - t;
+	
+	s.rotation[0] = ex.x; s.rotation[1] = ey.x; s.rotation[2] = ez.x;
+	s.rotation[3] = ex.y; s.rotation[4] = ey.y; s.rotation[5] = ez.y;
+	s.rotation[6] = ex.z; s.rotation[7] = ey.z; s.rotation[8] = ez.z;
+	
+	s.translation[0] = t.x;
+	s.translation[1] = t.y;
+	s.translation[2] = t.z;
+}
+
+void R2000Fusion::processScanner(Scanner& s)
+{
+	s.fresh = false;
+	
+	size_t full = s.driver->getFullScansAvailable();
+	if (full == 0) {
+		return;
+	}
+	
+	// keep only the newest full scan
+	for (size_t i=0; i<full; i++) {
+		s.scan = s.driver->getScan();
+	}
+	
+	if (s.scan.headers.empty()) {
+		return;
+	}
+	
+	s.scanTime = s.scan.host_times.empty() ? 0 : s.scan.host_times[0];
+	s.hasScan = true;
+	s.fresh = true;
+	
+	s.converter.convert(s.scan, s.local);
+	
+	const size_t n = s.local.size();
+	s.x.resize(n);
+	s.y.resize(n);
+	s.z.resize(n);
+	
+	const float* r = s.rotation;
+	const float* t = s.translation;
+	const float* lx = s.local.x.data();
+	const float* ly = s.local.y.data();
+	float* ox = s.x.data();
+	float* oy = s.y.data();
+	float* oz = s.z.data();
+	
+	if (dropInvalid) {
+		// no echo or lost packet, weak echoes only with amplitudes (not with packet type A)
+		const std::uint32_t* dist = s.scan.distance_data.data();
+		const std::uint32_t* amp = s.scan.amplitude_data.size() >= n ? s.scan.amplitude_data.data() : 0;
+		size_t k = 0;
+		for (size_t i=0; i<n; i++) {
+			if (dist[i] >= INVALID_DISTANCE || (amp && amp[i] < 32)) {
+				continue;
+			}
+			ox[k] = r[0] * lx[i] + r[1] * ly[i] + t[0];
+			oy[k] = r[3] * lx[i] + r[4] * ly[i] + t[1];
+			oz[k] = r[6] * lx[i] + r[7] * ly[i] + t[2];
+			k++;
+		}
+		s.x.resize(k);
+		s.y.resize(k);
+		s.z.resize(k);
+	} else {
+		// plain loop over contiguous arrays, gets vectorized by the compiler
+		for (size_t i=0; i<n; i++) {
+			ox[i] = r[0] * lx[i] + r[1] * ly[i] + t[0];
+			oy[i] = r[3] * lx[i] + r[4] * ly[i] + t[1];
+			oz[i] = r[6] * lx[i] + r[7] * ly[i] + t[2];
+		}
+	}
+}
+
+bool R2000Fusion::update()
+{
+	const size_t numScanners = scanners.size();
+	
+	// fetch and transform the scans of all scanners in parallel
+	pool.parallelFor(numScanners, [this](size_t i) {
+		processScanner(*scanners[i]);
+	});
+	
+	bool anyFresh = false;
+	int64_t newest = std::numeric_limits<int64_t>::min();
+	for (size_t i=0; i<numScanners; i++) {
+		if (scanners[i]->hasScan) {
+			newest = std::max(newest, scanners[i]->scanTime);
+			anyFresh = anyFresh || scanners[i]->fresh;
+		}
+	}
+	
+	if (!anyFresh) {
+		return false;
+	}
+	
+	// only scans close to the newest one take part in this tick
+	const int64_t maxDifference = (int64_t)(maxTimeDifference * 1000000.0);
+	std::vector<size_t> offsets(numScanners + 1, 0);
+	for (size_t i=0; i<numScanners; i++) {
+		const Scanner& s = *scanners[i];
+		bool use = s.hasScan && newest - s.scanTime <= maxDifference;
+		offsets[i + 1] = offsets[i] + (use ? s.x.size() : 0);
+	}
+	
+	const size_t total = offsets[numScanners];
+	cloud.x.resize(total);
+	cloud.y.resize(total);
+	cloud.z.resize(total);
+	cloud.scanner.resize(total);
+	cloud.time = newest;
+	
+	pool.parallelFor(numScanners, [&](size_t i) {
+		const Scanner& s = *scanners[i];
+		const size_t count = offsets[i + 1] - offsets[i];
+		if (count == 0) {
+			return;
+		}
+		std::copy(s.x.begin(), s.x.begin() + count, cloud.x.begin() + offsets[i]);
+		std::copy(s.y.begin(), s.y.begin() + count, cloud.y.begin() + offsets[i]);
+		std::copy(s.z.begin(), s.z.begin() + count, cloud.z.begin() + offsets[i]);
+		std::fill(cloud.scanner.begin() + offsets[i], cloud.scanner.begin() + offsets[i + 1], (uint8_t)i);
+	});
+	
+	return true;
+}
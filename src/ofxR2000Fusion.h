@@ -0,0 +1,111 @@
+//
+//  ofxR2000Fusion.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// merges the scans of several scanners into one point cloud in a common frame
+//
+
+#ifndef ofxR2000Fusion_h
+#define ofxR2000Fusion_h
+
+#include "ofMain.h"
+#include "r2000_driver.h"
+#include "cartesian_converter.h"
+#include "ofxR2000ThreadPool.h"
+
+using namespace pepperl_fuchs;
+
+// merged cloud of one fusion tick, structure of arrays
+struct R2000FusedCloud
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	
+	// index of the scanner each point comes from
+	std::vector<uint8_t> scanner;
+	
+	// host time of the tick in microseconds (Poco::Clock::raw()), newest scan of all scanners
+	int64_t time;
+	
+	size_t size() const { return x.size(); }
+};
+
+class R2000Fusion
+{
+public:
+	// numThreads: threads used for converting the scans, 0 uses all cores
+	R2000Fusion(size_t numThreads = 0);
+	
+	// add a scanner with its pose in the common frame, returns its index
+	// the fusion pops the scans of the driver, don't call getScan() on it elsewhere
+	size_t addScanner(R2000Driver* driver, const ofMatrix4x4& extrinsics);
+	// 2D pose: position in the unit of the cloud and heading in degrees
+	size_t addScanner(R2000Driver* driver, float x, float y, float headingDeg);
+	
+	void setExtrinsics(size_t index, const ofMatrix4x4& extrinsics);
+	void setExtrinsics(size_t index, float x, float y, float headingDeg);
+	ofMatrix4x4 getExtrinsics(size_t index) const;
+	
+	size_t getNumScanners() const { return scanners.size(); }
+	
+	// factor applied to the distances, 1.0 keeps millimeters
+	void setScale(float scale);
+	float getScale() const { return scale; };
+	
+	// scans older than the newest scan by more than this are left out of a tick [s]
+	void setMaxTimeDifference(double seconds) { maxTimeDifference = seconds; };
+	double getMaxTimeDifference() const { return maxTimeDifference; };
+	
+	// leave out samples without a distance (no echo or lost packet) and with an amplitude below 32 (error)
+	void setDropInvalid(bool drop) { dropInvalid = drop; };
+	bool getDropInvalid() const { return dropInvalid; };
+	
+	// fusion tick: fetch the newest full scan of every scanner, convert them in parallel and merge
+	// returns true if the merged cloud contains at least one new scan
+	bool update();
+	
+	const R2000FusedCloud& getCloud() const { return cloud; };
+	
+	
+private:
+	struct Scanner
+	{
+		R2000Driver* driver;
+		
+		// rows of the 3x3 rotation and the translation, from the ofMatrix4x4
+		float rotation[9];
+		float translation[3];
+		
+		CartesianConverter converter;
+		ScanData scan;
+		PointCloud2D local;
+		
+		// scan transformed into the common frame
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		
+		ofMatrix4x4 extrinsics;
+		int64_t scanTime;
+		bool hasScan;
+		bool fresh;
+	};
+	
+	void processScanner(Scanner& s);
+	static void setMatrix(Scanner& s, const ofMatrix4x4& extrinsics);
+	static ofMatrix4x4 poseMatrix(float x, float y, float headingDeg);
+	
+	std::vector< std::unique_ptr<Scanner> > scanners;
+	R2000ThreadPool pool;
+	
+	R2000FusedCloud cloud;
+	
+	float scale;
+	double maxTimeDifference;
+	bool dropInvalid;
+};
+
+#endif /* ofxR2000Fusion_h */
@@ -0,0 +1,388 @@
+//
+//  ofxR2000GpuStream.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// streams scans into GPU buffers, read in shaders as GL_R32UI buffer textures
+//
+
+#include "ofxR2000GpuStream.h"
+
+#ifndef TARGET_OPENGLES
+
+#include <algorithm>
+#include <cstring>
+
+
+static bool supportsBufferStorage()
+{
+#ifdef GL_MAP_PERSISTENT_BIT
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	return major > 4 || (major == 4 && minor >= 4) || ofGLCheckExtension("GL_ARB_buffer_storage");
+#else
+	return false;
+#endif
+}
+
+R2000GpuStream::R2000GpuStream() :
+	allocated(false)
+	,persistent(false)
+	,format(SCAN_SINK_DECODED)
+	,capacity(0)
+	,distanceBuffer(0)
+	,amplitudeBuffer(0)
+	,distanceTexture(0)
+	,amplitudeTexture(0)
+	,distanceMapped(0)
+	,amplitudeMapped(0)
+	,current(-1)
+	,currentSequence(0)
+	,writing(-1)
+	,sequence(0)
+	,scansWritten(0)
+	,scansDropped(0)
+	,scansSkipped(0)
+{
+	for (int i=0; i<NUM_SLOTS; i++) {
+		slots[i].state = SLOT_FREE;
+		slots[i].sequence = 0;
+		slots[i].fence = 0;
+		std::memset(&slots[i].info, 0, sizeof(ScanInfo));
+	}
+}
+
+R2000GpuStream::~R2000GpuStream()
+{
+	clear();
+}
+
+bool R2000GpuStream::setup(size_t maxSamples, bool usePersistent, ScanSinkFormat sinkFormat)
+{
+	clear();
+
+	format = sinkFormat;
+	capacity = std::max<size_t>(1, maxSamples);
+
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if ((size_t)maxTexels < NUM_SLOTS * capacity) {
+		ofLogError("R2000GpuStream") << "buffer textures are limited to " << maxTexels << " texels, " << NUM_SLOTS * capacity << " needed";
+		capacity = 0;
+		return false;
+	}
+
+	persistent = usePersistent && supportsBufferStorage();
+
+	const GLsizeiptr bytes = NUM_SLOTS * capacity * sizeof(uint32_t);
+	GLuint* buffers[2] = { &distanceBuffer, &amplitudeBuffer };
+	GLuint* textures[2] = { &distanceTexture, &amplitudeTexture };
+	uint32_t** mapped[2] = { &distanceMapped, &amplitudeMapped };
+
+	// packed samples only need the first buffer
+	const int numBuffers = isPacked() ? 1 : 2;
+
+	for (int i=0; i<numBuffers; i++) {
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+
+#ifdef GL_MAP_PERSISTENT_BIT
+		if (persistent) {
+			// written by the producer thread while the GPU reads other slots, coherent so no flush is needed
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_TEXTURE_BUFFER, bytes, 0, flags);
+			*mapped[i] = (uint32_t*)glMapBufferRange(GL_TEXTURE_BUFFER, 0, bytes, flags);
+		} else
+#endif
+		{
+			glBufferData(GL_TEXTURE_BUFFER, bytes, 0, GL_STREAM_DRAW);
+		}
+
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, *buffers[i]);
+	}
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	if (persistent && (!distanceMapped || (!amplitudeMapped && !isPacked()))) {
+		ofLogWarning("R2000GpuStream") << "mapping the buffers failed, using glBufferSubData";
+		clear();
+		return setup(maxSamples, false, sinkFormat);
+	}
+
+	if (!persistent) {
+		for (int i=0; i<NUM_SLOTS; i++) {
+			slots[i].distance.assign(capacity, INVALID_DISTANCE);
+			if (!isPacked()) {
+				slots[i].amplitude.assign(capacity, 0);
+			}
+		}
+	}
+
+	allocated = true;
+	return true;
+}
+
+void R2000GpuStream::clear()
+{
+	for (int i=0; i<NUM_SLOTS; i++) {
+		if (slots[i].fence) {
+			glDeleteSync(slots[i].fence);
+			slots[i].fence = 0;
+		}
+		slots[i].state = SLOT_FREE;
+		slots[i].distance.clear();
+		slots[i].amplitude.clear();
+	}
+
+	GLuint* buffers[2] = { &distanceBuffer, &amplitudeBuffer };
+	GLuint* textures[2] = { &distanceTexture, &amplitudeTexture };
+	uint32_t** mapped[2] = { &distanceMapped, &amplitudeMapped };
+
+	for (int i=0; i<2; i++) {
+		if (*mapped[i]) {
+			glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+			glUnmapBuffer(GL_TEXTURE_BUFFER);
+			glBindBuffer(GL_TEXTURE_BUFFER, 0);
+			*mapped[i] = 0;
+		}
+		if (*textures[i]) {
+			glDeleteTextures(1, textures[i]);
+			*textures[i] = 0;
+		}
+		if (*buffers[i]) {
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+
+	allocated = false;
+	persistent = false;
+	capacity = 0;
+	current = -1;
+	writing = -1;
+	currentSequence = 0;
+}
+
+bool R2000GpuStream::update()
+{
+	if (!allocated) {
+		return false;
+	}
+
+	// slots the GPU is done with can be written again
+	for (int i=0; i<NUM_SLOTS; i++) {
+		Slot& slot = slots[i];
+		if (slot.state.load(std::memory_order_relaxed) != SLOT_IN_FLIGHT) {
+			continue;
+		}
+
+		GLenum result = glClientWaitSync(slot.fence, 0, 0);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+			glDeleteSync(slot.fence);
+			slot.fence = 0;
+			slot.state.store(SLOT_FREE, std::memory_order_release);
+		}
+	}
+
+	// newest written scan, ready slots older than the current one are left to the producer
+	int newest = -1;
+	uint64_t newestSequence = currentSequence;
+	for (int i=0; i<NUM_SLOTS; i++) {
+		if (slots[i].state.load(std::memory_order_acquire) != SLOT_READY) {
+			continue;
+		}
+
+		uint64_t slotSequence = slots[i].sequence.load(std::memory_order_relaxed);
+		if (slotSequence > newestSequence) {
+			newest = i;
+			newestSequence = slotSequence;
+		}
+	}
+
+	if (newest < 0) {
+		return false;
+	}
+
+	// the producer may have taken the slot back meanwhile, try again with the next frame
+	int expected = SLOT_READY;
+	if (!slots[newest].state.compare_exchange_strong(expected, SLOT_CURRENT, std::memory_order_acq_rel)) {
+		return false;
+	}
+
+	Slot& slot = slots[newest];
+	newestSequence = slot.sequence.load(std::memory_order_relaxed);
+
+	if (!persistent) {
+		const GLintptr offset = newest * capacity * sizeof(uint32_t);
+		const GLsizeiptr bytes = slot.info.num_points_scan * sizeof(uint32_t);
+
+		glBindBuffer(GL_TEXTURE_BUFFER, distanceBuffer);
+		glBufferSubData(GL_TEXTURE_BUFFER, offset, bytes, &slot.distance[0]);
+		if (!isPacked()) {
+			glBindBuffer(GL_TEXTURE_BUFFER, amplitudeBuffer);
+			glBufferSubData(GL_TEXTURE_BUFFER, offset, bytes, &slot.amplitude[0]);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	// all draws of the previous scan are submitted, it is free once the GPU passed this fence
+	if (current >= 0) {
+		slots[current].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slots[current].state.store(SLOT_IN_FLIGHT, std::memory_order_release);
+	}
+
+	current = newest;
+	currentSequence = newestSequence;
+	return true;
+}
+
+void R2000GpuStream::setUniforms(ofShader& shader, int textureLocation) const
+{
+	if (isPacked()) {
+		shader.setUniformTexture("texPacked", GL_TEXTURE_BUFFER, distanceTexture, textureLocation);
+	} else {
+		shader.setUniformTexture("texDist", GL_TEXTURE_BUFFER, distanceTexture, textureLocation);
+		shader.setUniformTexture("texAmp", GL_TEXTURE_BUFFER, amplitudeTexture, textureLocation + 1);
+	}
+	shader.setUniform1i("usePacked", isPacked() ? 1 : 0);
+	shader.setUniform1i("offset", getOffset());
+	shader.setUniform1i("size", (int)getNumSamples());
+
+	// packet type A scans have no amplitudes, the amplitudes are 0
+	const ScanInfo& info = getScanInfo();
+	shader.setUniform1i("hasAmplitude", info.packet_type == PACKET_TYPE_A ? 0 : 1);
+
+	// angles are in 1/10000 degree
+	shader.setUniform1f("first_angle", (float)(info.start_angle * PI / 1800000.0));
+	shader.setUniform1f("angular_increment", (float)(info.angular_increment * PI / 1800000.0));
+}
+
+const ScanInfo& R2000GpuStream::getScanInfo() const
+{
+	static ScanInfo empty = ScanInfo();
+	return current < 0 ? empty : slots[current].info;
+}
+
+int R2000GpuStream::claimSlot()
+{
+	for (int i=0; i<NUM_SLOTS; i++) {
+		int expected = SLOT_FREE;
+		if (slots[i].state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+			return i;
+		}
+	}
+
+	// all slots drawn or in flight: overwrite a scan which was not drawn yet
+	for (int i=0; i<NUM_SLOTS; i++) {
+		int expected = SLOT_READY;
+		if (slots[i].state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+			scansSkipped++;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+uint32_t* R2000GpuStream::distancePointer(int slot)
+{
+	return persistent ? distanceMapped + slot * capacity : &slots[slot].distance[0];
+}
+
+uint32_t* R2000GpuStream::amplitudePointer(int slot)
+{
+	if (isPacked()) {
+		return 0;
+	}
+	return persistent ? amplitudeMapped + slot * capacity : &slots[slot].amplitude[0];
+}
+
+bool R2000GpuStream::beginScan(const PacketHeader& header, uint32_t*& distance, uint32_t*& amplitude)
+{
+	const size_t size = header.num_points_scan;
+
+	if (!allocated || size == 0 || size > capacity) {
+		scansDropped++;
+		return false;
+	}
+
+	// an unfinished scan gives its slot to the next one
+	if (writing < 0) {
+		writing = claimSlot();
+	}
+	if (writing < 0) {
+		scansDropped++;
+		return false;
+	}
+
+	// lost packets leave invalid samples
+	distance = distancePointer(writing);
+	amplitude = amplitudePointer(writing);
+	// INVALID_DISTANCE is also an invalid packed sample with amplitude 0
+	std::fill(distance, distance + size, INVALID_DISTANCE);
+	if (amplitude) {
+		std::fill(amplitude, amplitude + size, 0u);
+	}
+	return true;
+}
+
+void R2000GpuStream::endScan(const ScanInfo& info)
+{
+	if (writing < 0) {
+		return;
+	}
+
+	Slot& slot = slots[writing];
+	slot.info = info;
+	slot.sequence.store(++sequence, std::memory_order_relaxed);
+	slot.state.store(SLOT_READY, std::memory_order_release);
+
+	writing = -1;
+	scansWritten++;
+}
+
+bool R2000GpuStream::write(const CompactScanData& scan)
+{
+	const size_t size = std::min<size_t>(scan.info.num_points_scan, scan.distance_data.size());
+
+	if (!allocated || size == 0 || size > capacity) {
+		scansDropped++;
+		return false;
+	}
+
+	if (writing < 0) {
+		writing = claimSlot();
+	}
+	if (writing < 0) {
+		scansDropped++;
+		return false;
+	}
+
+	uint32_t* distance = distancePointer(writing);
+	uint32_t* amplitude = amplitudePointer(writing);
+	if (isPacked()) {
+		// like packet type C
+		for (size_t i=0; i<size; i++) {
+			distance[i] = packSample(scan.distance_data[i], i < scan.amplitude_data.size() ? scan.amplitude_data[i] : 0);
+		}
+	} else {
+		std::memcpy(distance, &scan.distance_data[0], size * sizeof(uint32_t));
+		for (size_t i=0; i<size; i++) {
+			amplitude[i] = i < scan.amplitude_data.size() ? scan.amplitude_data[i] : 0;
+		}
+	}
+
+	ScanInfo info = scan.info;
+	info.num_points_scan = (uint16_t)size;
+	endScan(info);
+	return true;
+}
+
+#endif
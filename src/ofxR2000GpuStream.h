@@ -0,0 +1,164 @@
+//
+//  ofxR2000GpuStream.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// streams scans into GPU buffers, read in shaders as GL_R32UI buffer textures
+//
+
+#ifndef ofxR2000GpuStream_h
+#define ofxR2000GpuStream_h
+
+#include "ofMain.h"
+#include "scan_sink.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace pepperl_fuchs;
+
+// needs buffer textures and fences, not available with OpenGL ES
+#ifndef TARGET_OPENGLES
+
+// three slots of distance and amplitude data in one buffer each, one slot drawn, one in flight, one written
+// with GL 4.4 or GL_ARB_buffer_storage the buffers are mapped persistently and scans are written straight into GPU memory,
+// by the receiver IO thread when registered with R2000Driver::setScanSink(), a fence per slot tells when the GPU is done with it
+// otherwise scans are written to memory and uploaded with glBufferSubData in update()
+//
+// shader side, the current scan starts at texel "offset" of both textures:
+//	uniform usamplerBuffer texDist;
+//	uniform usamplerBuffer texAmp;
+//	uniform int offset;
+//	uniform int size;
+//	uniform int hasAmplitude;	// 0 for packet type A, the amplitudes are 0
+//	uint distance = texelFetch(texDist, offset + gl_InstanceID).r;
+//
+// with SCAN_SINK_PACKED only one word per sample is uploaded, like packet type C, unpacked by the shader:
+//	uniform usamplerBuffer texPacked;
+//	uint word = texelFetch(texPacked, offset + gl_VertexID).r;
+//	uint distance = word & 0xFFFFFu;
+//	uint amplitude = word >> 20;
+//	float angle = first_angle + angular_increment * float(gl_VertexID);
+//
+// setup(), update(), setUniforms() and clear() on the GL thread,
+// writing (ScanSink, write()) on one other thread or the GL thread, never blocking either side
+class R2000GpuStream : public ScanSink
+{
+public:
+	R2000GpuStream();
+	~R2000GpuStream();
+
+	// allocate for scans of up to maxSamples samples, usePersistent = false forces the glBufferSubData path
+	// format SCAN_SINK_PACKED halves the memory and upload, type C payloads are copied without decoding
+	bool setup(size_t maxSamples = 25200, bool usePersistent = true, ScanSinkFormat format = SCAN_SINK_DECODED);
+	void clear();
+
+	bool isAllocated() const { return allocated; };
+	bool isPersistent() const { return persistent; };
+	bool isPacked() const { return format == SCAN_SINK_PACKED; };
+	size_t getMaxSamples() const { return capacity; };
+
+	// make the newest written scan current, call once per frame before drawing
+	// returns true if a new scan became current
+	bool update();
+
+	// bind the buffer textures to texDist and texAmp at textureLocation and textureLocation + 1,
+	// or texPacked at textureLocation, set usePacked, offset, size and first_angle, angular_increment in radians
+	void setUniforms(ofShader& shader, int textureLocation = 0) const;
+
+	// the packed words are in the distance texture, there is no amplitude texture
+	GLuint getDistanceTextureId() const { return distanceTexture; };
+	GLuint getAmplitudeTextureId() const { return amplitudeTexture; };
+
+	// buffers of all slots, e.g. to copy the current scan on the GPU
+	GLuint getDistanceBufferId() const { return distanceBuffer; };
+	GLuint getAmplitudeBufferId() const { return amplitudeBuffer; };
+
+	// first texel of the current scan
+	int getOffset() const { return current < 0 ? 0 : current * (int)capacity; };
+
+	// samples of the current scan, 0 before the first scan
+	size_t getNumSamples() const { return current < 0 ? 0 : slots[current].info.num_points_scan; };
+	const ScanInfo& getScanInfo() const;
+
+	// copy a scan, e.g. from R2000DataReader
+	bool write(const CompactScanData& scan);
+
+	// one sample like packet type C, INVALID_DISTANCE for invalid distances
+	static uint32_t packSample(uint32_t distance, uint32_t amplitude) {
+		return distance >= INVALID_DISTANCE ? INVALID_DISTANCE : distance | std::min<uint32_t>(amplitude, 0xFFF) << 20;
+	};
+
+	// ScanSink
+	virtual ScanSinkFormat getFormat() const { return format; };
+	virtual bool beginScan(const PacketHeader& header, uint32_t*& distance, uint32_t*& amplitude);
+	virtual void endScan(const ScanInfo& info);
+
+	// scans written, dropped because they did not fit or no slot was free, written but replaced before they were drawn
+	uint64_t getScansWritten() const { return scansWritten; };
+	uint64_t getScansDropped() const { return scansDropped; };
+	uint64_t getScansSkipped() const { return scansSkipped; };
+
+private:
+	enum SlotState {
+		SLOT_FREE,
+		SLOT_WRITING,
+		SLOT_READY,
+		SLOT_CURRENT,
+		SLOT_IN_FLIGHT
+	};
+
+	struct Slot {
+		std::atomic<int> state;
+
+		// written by the producer before the slot is ready, sequence is also read by update() while the producer may take the slot back
+		std::atomic<uint64_t> sequence;
+		ScanInfo info;
+
+		// GL thread only
+		GLsync fence;
+
+		// glBufferSubData path: written by the producer, uploaded by update(), amplitude unused when packed
+		std::vector<uint32_t> distance;
+		std::vector<uint32_t> amplitude;
+	};
+
+	static const int NUM_SLOTS = 3;
+
+	int claimSlot();
+	uint32_t* distancePointer(int slot);
+	uint32_t* amplitudePointer(int slot);
+
+	bool allocated;
+	bool persistent;
+	ScanSinkFormat format;
+	size_t capacity;
+
+	GLuint distanceBuffer;
+	GLuint amplitudeBuffer;
+	GLuint distanceTexture;
+	GLuint amplitudeTexture;
+
+	// persistently mapped buffers, NUM_SLOTS * capacity entries each
+	uint32_t* distanceMapped;
+	uint32_t* amplitudeMapped;
+
+	Slot slots[NUM_SLOTS];
+
+	// slot drawn and its sequence, GL thread only
+	int current;
+	uint64_t currentSequence;
+
+	// slot between beginScan() and endScan(), producer only
+	int writing;
+	uint64_t sequence;
+
+	std::atomic<uint64_t> scansWritten;
+	std::atomic<uint64_t> scansDropped;
+	std::atomic<uint64_t> scansSkipped;
+};
+
+#endif
+
+#endif /* ofxR2000GpuStream_h */
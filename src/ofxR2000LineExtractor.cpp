@@ -0,0 +1,325 @@
+//
+//  ofxR2000LineExtractor.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// line segment and corner extraction with split-and-merge and optional RANSAC refinement
+//
+
+#include "ofxR2000LineExtractor.h"
+
+
+R2000LineExtractor::R2000LineExtractor() :
+	splitThreshold(30.0f)
+	,minPoints(6)
+	,minLength(200.0f)
+	,ransac(false)
+	,ransacIterations(32)
+	,cornerMinAngle(ofDegToRad(45.0f))
+	,cornerMaxGap(200.0f)
+	,rngState(2463534242u)
+{}
+
+uint32_t R2000LineExtractor::random()
+{
+	// xorshift32
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+const std::vector<R2000Line>& R2000LineExtractor::extract(const ScanData& scan, const PointCloud2D& cloud)
+{
+	extract(scan.distance_data.data(), cloud, std::min(scan.distance_data.size(), cloud.size()));
+	return lines;
+}
+
+const std::vector<R2000Line>& R2000LineExtractor::extract(const CompactScanData& scan, const PointCloud2D& cloud)
+{
+	extract(scan.distance_data.data(), cloud, std::min(scan.distance_data.size(), cloud.size()));
+	return lines;
+}
+
+void R2000LineExtractor::extract(const uint32_t* distances, const PointCloud2D& cloud, size_t count)
+{
+	lines.clear();
+	corners.clear();
+	
+	if (count == 0) {
+		return;
+	}
+	
+	const std::vector<R2000Segment>& segments = segmenter.segment(distances, cloud.x.data(), cloud.y.data(), count);
+	
+	for (size_t s=0; s<segments.size(); s++) {
+		const R2000Segment& segment = segments[s];
+		
+		// valid points of the segment in one contiguous block
+		px.clear();
+		py.clear();
+		sample.clear();
+		for (size_t i=segment.first; i<=segment.last; i++) {
+			if (distances[i] == 0 || distances[i] >= INVALID_DISTANCE) {
+				continue;
+			}
+			px.push_back(cloud.x[i]);
+			py.push_back(cloud.y[i]);
+			sample.push_back(i);
+		}
+		
+		splitAndMerge(0, px.size());
+	}
+	
+	findCorners();
+}
+
+bool R2000LineExtractor::fit(size_t begin, size_t end, R2000Line& line) const
+{
+	if (end <= begin) {
+		return false;
+	}
+	return fit(&px[begin], &py[begin], &sample[begin], end - begin, line);
+}
+
+bool R2000LineExtractor::fit(const float* px, const float* py, const size_t* sample, size_t n, R2000Line& line)
+{
+	if (n < 2) {
+		return false;
+	}
+	
+	double mx = 0.0;
+	double my = 0.0;
+	for (size_t i=0; i<n; i++) {
+		mx += px[i];
+		my += py[i];
+	}
+	mx /= n;
+	my /= n;
+	
+	double sxx = 0.0;
+	double syy = 0.0;
+	double sxy = 0.0;
+	for (size_t i=0; i<n; i++) {
+		const double dx = px[i] - mx;
+		const double dy = py[i] - my;
+		sxx += dx * dx;
+		syy += dy * dy;
+		sxy += dx * dy;
+	}
+	
+	// total least squares: direction is the main axis of the points
+	const double phi = 0.5 * std::atan2(2.0 * sxy, sxx - syy);
+	const float dirX = (float)std::cos(phi);
+	const float dirY = (float)std::sin(phi);
+	
+	line.nx = -dirY;
+	line.ny = dirX;
+	line.d = (float)(line.nx * mx + line.ny * my);
+	
+	// smallest eigenvalue is the sum of squared distances
+	const double half = 0.5 * (sxx - syy);
+	const double lambda = 0.5 * (sxx + syy) - std::sqrt(half * half + sxy * sxy);
+	line.error = (float)std::sqrt(std::max(0.0, lambda) / n);
+	
+	// end points projected onto the line
+	const float t0 = dirX * (px[0] - (float)mx) + dirY * (py[0] - (float)my);
+	const float t1 = dirX * (px[n - 1] - (float)mx) + dirY * (py[n - 1] - (float)my);
+	line.x0 = (float)mx + t0 * dirX;
+	line.y0 = (float)my + t0 * dirY;
+	line.x1 = (float)mx + t1 * dirX;
+	line.y1 = (float)my + t1 * dirY;
+	
+	line.first = sample[0];
+	line.last = sample[n - 1];
+	line.numPoints = n;
+	
+	return true;
+}
+
+float R2000LineExtractor::maxDistance(size_t begin, size_t end, const R2000Line& line) const
+{
+	float result = 0.0f;
+	for (size_t i=begin; i<end; i++) {
+		result = std::max(result, std::abs(line.nx * px[i] + line.ny * py[i] - line.d));
+	}
+	return result;
+}
+
+void R2000LineExtractor::splitAndMerge(size_t begin, size_t end)
+{
+	if (end - begin < minPoints) {
+		return;
+	}
+	
+	//----------------------------------------
+	// split at the point furthest from the chord until all pieces are straight
+	pieces.clear();
+	stack.clear();
+	Range all = { begin, end };
+	stack.push_back(all);
+	
+	while (!stack.empty()) {
+		Range r = stack.back();
+		stack.pop_back();
+		
+		const size_t a = r.begin;
+		const size_t b = r.end - 1;
+		
+		float chordX = px[b] - px[a];
+		float chordY = py[b] - py[a];
+		const float length = std::sqrt(chordX * chordX + chordY * chordY);
+		
+		size_t split = a;
+		float maxDist = 0.0f;
+		if (length > 0.0f) {
+			chordX /= length;
+			chordY /= length;
+			for (size_t i=a+1; i<b; i++) {
+				const float dist = std::abs((px[i] - px[a]) * chordY - (py[i] - py[a]) * chordX);
+				if (dist > maxDist) {
+					maxDist = dist;
+					split = i;
+				}
+			}
+		}
+		
+		if (maxDist > splitThreshold && split > a && split < b) {
+			// push the right half first, so pieces come out in scan order
+			Range right = { split, r.end };
+			Range left = { r.begin, split + 1 };
+			stack.push_back(right);
+			stack.push_back(left);
+		} else {
+			pieces.push_back(r);
+		}
+	}
+	
+	//----------------------------------------
+	// merge neighbouring pieces whose union is still straight
+	R2000Line line;
+	R2000Line merged;
+	size_t p = 0;
+	while (p < pieces.size()) {
+		Range current = pieces[p++];
+		
+		while (p < pieces.size()) {
+			// split points are shared by both halves
+			const size_t mergedEnd = pieces[p].end;
+			if (!fit(current.begin, mergedEnd, merged) || maxDistance(current.begin, mergedEnd, merged) > splitThreshold) {
+				break;
+			}
+			current.end = mergedEnd;
+			p++;
+		}
+		
+		if (current.end - current.begin < minPoints || !fit(current.begin, current.end, line)) {
+			continue;
+		}
+		
+		if (ransac) {
+			fitInliers(current.begin, current.end, line);
+		}
+		
+		const float dx = line.x1 - line.x0;
+		const float dy = line.y1 - line.y0;
+		if (std::sqrt(dx * dx + dy * dy) < minLength) {
+			continue;
+		}
+		
+		lines.push_back(line);
+	}
+}
+
+bool R2000LineExtractor::fitInliers(size_t begin, size_t end, R2000Line& line)
+{
+	const size_t n = end - begin;
+	
+	// best line through two random points
+	size_t bestCount = 0;
+	float bestNx = line.nx;
+	float bestNy = line.ny;
+	float bestD = line.d;
+	
+	for (int it=0; it<ransacIterations; it++) {
+		const size_t i = begin + random() % n;
+		const size_t j = begin + random() % n;
+		
+		float dx = px[j] - px[i];
+		float dy = py[j] - py[i];
+		const float length = std::sqrt(dx * dx + dy * dy);
+		if (length <= 0.0f) {
+			continue;
+		}
+		
+		const float nx = -dy / length;
+		const float ny = dx / length;
+		const float d = nx * px[i] + ny * py[i];
+		
+		size_t count = 0;
+		for (size_t k=begin; k<end; k++) {
+			count += std::abs(nx * px[k] + ny * py[k] - d) <= splitThreshold;
+		}
+		
+		if (count > bestCount) {
+			bestCount = count;
+			bestNx = nx;
+			bestNy = ny;
+			bestD = d;
+		}
+	}
+	
+	if (bestCount < minPoints || bestCount == n) {
+		return false;
+	}
+	
+	// copy the inliers in scan order, the range shares its end point with the next piece
+	inlierX.clear();
+	inlierY.clear();
+	inlierSample.clear();
+	for (size_t i=begin; i<end; i++) {
+		if (std::abs(bestNx * px[i] + bestNy * py[i] - bestD) <= splitThreshold) {
+			inlierX.push_back(px[i]);
+			inlierY.push_back(py[i]);
+			inlierSample.push_back(sample[i]);
+		}
+	}
+	
+	return fit(inlierX.data(), inlierY.data(), inlierSample.data(), inlierX.size(), line);
+}
+
+void R2000LineExtractor::findCorners()
+{
+	for (size_t i=0; i+1<lines.size(); i++) {
+		const R2000Line& a = lines[i];
+		const R2000Line& b = lines[i + 1];
+		
+		const float gx = b.x0 - a.x1;
+		const float gy = b.y0 - a.y1;
+		if (gx * gx + gy * gy > cornerMaxGap * cornerMaxGap) {
+			continue;
+		}
+		
+		// angle between the lines from their normals
+		const float cosAngle = std::min(1.0f, std::abs(a.nx * b.nx + a.ny * b.ny));
+		const float angle = std::acos(cosAngle);
+		if (angle < cornerMinAngle) {
+			continue;
+		}
+		
+		// intersection of both lines
+		const float det = a.nx * b.ny - a.ny * b.nx;
+		if (std::abs(det) < 1e-6f) {
+			continue;
+		}
+		
+		R2000Corner corner;
+		corner.x = (a.d * b.ny - a.ny * b.d) / det;
+		corner.y = (a.nx * b.d - a.d * b.nx) / det;
+		corner.angle = angle;
+		corner.line0 = i;
+		corner.line1 = i + 1;
+		corners.push_back(corner);
+	}
+}
@@ -0,0 +1,133 @@
+//
+//  ofxR2000LineExtractor.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// line segment and corner extraction with split-and-merge and optional RANSAC refinement
+//
+
+#ifndef ofxR2000LineExtractor_h
+#define ofxR2000LineExtractor_h
+
+#include "ofMain.h"
+#include "compact_scan_data.h"
+#include "cartesian_converter.h"
+#include "ofxR2000Segmenter.h"
+
+using namespace pepperl_fuchs;
+
+struct R2000Line
+{
+	// end points, unit of the point cloud
+	float x0;
+	float y0;
+	float x1;
+	float y1;
+	
+	// normal form: nx * x + ny * y = d
+	float nx;
+	float ny;
+	float d;
+	
+	// sample range in the scan
+	size_t first;
+	size_t last;
+	size_t numPoints;
+	
+	// rms distance of the points to the line
+	float error;
+};
+
+struct R2000Corner
+{
+	float x;
+	float y;
+	
+	// angle between the lines in radians, 0 to pi/2
+	float angle;
+	
+	// indices into getLines()
+	size_t line0;
+	size_t line1;
+};
+
+// splits each segment of the ordered scan recursively at the point furthest from the chord,
+// merges neighbouring collinear pieces and fits every line with total least squares
+// all per scan data lives in reused arrays, so extract() does not allocate once they have grown
+class R2000LineExtractor
+{
+public:
+	R2000LineExtractor();
+	
+	// breakpoints between segments (distance jumps, gaps)
+	R2000Segmenter& getSegmenter() { return segmenter; };
+	
+	// maximum distance of a point to its line, unit of the point cloud
+	void setSplitThreshold(float distance) { splitThreshold = distance; };
+	float getSplitThreshold() const { return splitThreshold; };
+	
+	void setMinPoints(size_t numPoints) { minPoints = std::max<size_t>(2, numPoints); };
+	void setMinLength(float length) { minLength = length; };
+	
+	// refit every line on the RANSAC inliers of its points
+	void setRansac(bool enable, int iterations = 32) { ransac = enable; ransacIterations = iterations; };
+	bool getRansac() const { return ransac; };
+	
+	// corners between neighbouring lines with an angle above minAngle [deg] and end points closer than maxGap
+	void setCornerMinAngle(float degrees) { cornerMinAngle = ofDegToRad(degrees); };
+	void setCornerMaxGap(float distance) { cornerMaxGap = distance; };
+	
+	// cloud from CartesianConverter::convert() of the same scan
+	const std::vector<R2000Line>& extract(const ScanData& scan, const PointCloud2D& cloud);
+	const std::vector<R2000Line>& extract(const CompactScanData& scan, const PointCloud2D& cloud);
+	
+	const std::vector<R2000Line>& getLines() const { return lines; };
+	const std::vector<R2000Corner>& getCorners() const { return corners; };
+	
+	
+private:
+	struct Range
+	{
+		size_t begin;
+		size_t end;
+	};
+	
+	void extract(const uint32_t* distances, const PointCloud2D& cloud, size_t count);
+	void splitAndMerge(size_t begin, size_t end);
+	bool fit(size_t begin, size_t end, R2000Line& line) const;
+	static bool fit(const float* x, const float* y, const size_t* index, size_t n, R2000Line& line);
+	bool fitInliers(size_t begin, size_t end, R2000Line& line);
+	float maxDistance(size_t begin, size_t end, const R2000Line& line) const;
+	void findCorners();
+	uint32_t random();
+	
+	R2000Segmenter segmenter;
+	
+	float splitThreshold;
+	size_t minPoints;
+	float minLength;
+	bool ransac;
+	int ransacIterations;
+	float cornerMinAngle;
+	float cornerMaxGap;
+	
+	// scratch: valid points of the current scan and their sample index
+	std::vector<float> px;
+	std::vector<float> py;
+	std::vector<size_t> sample;
+	std::vector<Range> stack;
+	std::vector<Range> pieces;
+	
+	// scratch: RANSAC inliers of one line
+	std::vector<float> inlierX;
+	std::vector<float> inlierY;
+	std::vector<size_t> inlierSample;
+	
+	std::vector<R2000Line> lines;
+	std::vector<R2000Corner> corners;
+	
+	uint32_t rngState;
+};
+
+#endif /* ofxR2000LineExtractor_h */
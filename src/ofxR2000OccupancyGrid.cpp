@@ -0,0 +1,288 @@
+//
+//  ofxR2000OccupancyGrid.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// tiled 2D occupancy / heat map grid accumulating scans
+//
+
+#include "ofxR2000OccupancyGrid.h"
+
+#include <climits>
+#include <limits>
+
+
+R2000OccupancyGrid::R2000OccupancyGrid(size_t numThreads) :
+	originX(0)
+	,originY(0)
+	,width(0)
+	,height(0)
+	,resolution(50.0f)
+	,tilesX(0)
+	,tilesY(0)
+	,rayCasting(true)
+	,hitUpdate(0.85f)
+	,missUpdate(-0.4f)
+	,minLimit(-2.0f)
+	,maxLimit(3.5f)
+	,decay(1.0f)
+	,maxRange(30000.0f)
+	,sensorX(0)
+	,sensorY(0)
+	,pool(numThreads)
+{}
+
+void R2000OccupancyGrid::setup(float x, float y, size_t w, size_t h, float res)
+{
+	originX = x;
+	originY = y;
+	width = w;
+	height = h;
+	resolution = res > 0.0f ? res : 50.0f;
+	
+	tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	
+	cells.assign(tilesX * tilesY * TILE_CELLS, 0.0f);
+}
+
+void R2000OccupancyGrid::clear()
+{
+	std::fill(cells.begin(), cells.end(), 0.0f);
+}
+
+bool R2000OccupancyGrid::worldToCell(float x, float y, int& cx, int& cy) const
+{
+	cx = (int)std::floor((x - originX) / resolution);
+	cy = (int)std::floor((y - originY) / resolution);
+	
+	return cx >= 0 && cy >= 0 && (size_t)cx < width && (size_t)cy < height;
+}
+
+float R2000OccupancyGrid::getLogOdds(size_t cx, size_t cy) const
+{
+	if (cx >= width || cy >= height) {
+		return 0.0f;
+	}
+	
+	return cells[cellIndex(cx, cy)];
+}
+
+float R2000OccupancyGrid::getProbability(size_t cx, size_t cy) const
+{
+	return 1.0f - 1.0f / (1.0f + std::exp(getLogOdds(cx, cy)));
+}
+
+void R2000OccupancyGrid::toPixels(ofPixels& pixels) const
+{
+	pixels.allocate(width, height, OF_PIXELS_GRAY);
+	unsigned char* p = pixels.getData();
+	
+	for (size_t cy=0; cy<height; cy++) {
+		for (size_t cx=0; cx<width; cx++) {
+			const float probability = 1.0f - 1.0f / (1.0f + std::exp(cells[cellIndex(cx, cy)]));
+			p[cy * width + cx] = (unsigned char)(probability * 255.0f + 0.5f);
+		}
+	}
+}
+
+template<class T>
+void R2000OccupancyGrid::addPoints(const uint32_t* distances, const T* amplitudes, const float* x, const float* y, size_t count)
+{
+	for (size_t i=0; i<count; i++) {
+		// no echo or error
+		if (distances[i] == 0 || distances[i] >= INVALID_DISTANCE || (float)distances[i] > maxRange) {
+			continue;
+		}
+		if (amplitudes && amplitudes[i] < 32) {
+			continue;
+		}
+		
+		endX.push_back(x[i]);
+		endY.push_back(y[i]);
+	}
+}
+
+void R2000OccupancyGrid::integrate(const ScanData& scan, float x, float y, float theta)
+{
+	if (cells.empty()) {
+		ofLogError("R2000OccupancyGrid") << "call setup() first";
+		return;
+	}
+	
+	converter.convert(scan, cloud);
+	
+	const size_t count = std::min(cloud.size(), scan.distance_data.size());
+	const bool hasAmplitudes = scan.amplitude_data.size() >= count;
+	
+	endX.clear();
+	endY.clear();
+	if (count > 0) {
+		addPoints(scan.distance_data.data(), hasAmplitudes ? scan.amplitude_data.data() : (const std::uint32_t*)0, cloud.x.data(), cloud.y.data(), count);
+	}
+	
+	update(x, y, theta);
+}
+
+void R2000OccupancyGrid::integrate(const CompactScanData& scan, float x, float y, float theta)
+{
+	if (cells.empty()) {
+		ofLogError("R2000OccupancyGrid") << "call setup() first";
+		return;
+	}
+	
+	converter.convert(scan, cloud);
+	
+	const size_t count = std::min(cloud.size(), scan.distance_data.size());
+	// packet type A scans have no amplitudes
+	const bool hasAmplitudes = !scan.amplitude_data.empty() && scan.amplitude_data.size() >= count;
+	
+	endX.clear();
+	endY.clear();
+	if (count > 0) {
+		addPoints(scan.distance_data.data(), hasAmplitudes ? scan.amplitude_data.data() : (const uint16_t*)0, cloud.x.data(), cloud.y.data(), count);
+	}
+	
+	update(x, y, theta);
+}
+
+void R2000OccupancyGrid::update(float x, float y, float theta)
+{
+	// scanner frame to cell coordinates
+	const float c = std::cos(theta) / resolution;
+	const float s = std::sin(theta) / resolution;
+	sensorX = (x - originX) / resolution;
+	sensorY = (y - originY) / resolution;
+	
+	// neighbouring samples mostly end in the same cell, keep one ray per cell and run
+	const size_t count = endX.size();
+	float* px = endX.data();
+	float* py = endY.data();
+	size_t kept = 0;
+	int lastX = INT_MIN;
+	int lastY = INT_MIN;
+	for (size_t i=0; i<count; i++) {
+		const float lx = px[i];
+		const float ly = py[i];
+		const float gx = c * lx - s * ly + sensorX;
+		const float gy = s * lx + c * ly + sensorY;
+		
+		const int cx = (int)std::floor(gx);
+		const int cy = (int)std::floor(gy);
+		if (cx == lastX && cy == lastY) {
+			continue;
+		}
+		lastX = cx;
+		lastY = cy;
+		
+		px[kept] = gx;
+		py[kept] = gy;
+		kept++;
+	}
+	endX.resize(kept);
+	endY.resize(kept);
+	
+	pool.parallelFor(tilesY, [this](size_t tileRow) {
+		updateTileRow(tileRow);
+	});
+}
+
+void R2000OccupancyGrid::updateTileRow(size_t tileRow)
+{
+	const int r0 = (int)(tileRow * TILE_SIZE);
+	const int r1 = (int)std::min(height, (tileRow + 1) * TILE_SIZE);
+	const int w = (int)width;
+	
+	float* tiles = cells.data() + tileRow * tilesX * TILE_CELLS;
+	
+	//----------------------------------------
+	// decay
+	if (decay != 1.0f) {
+		const size_t n = tilesX * TILE_CELLS;
+		for (size_t i=0; i<n; i++) {
+			tiles[i] *= decay;
+		}
+	}
+	
+	const size_t count = endX.size();
+	const float* px = endX.data();
+	const float* py = endY.data();
+	
+	//----------------------------------------
+	// free space between scanner and hit, every cell the ray passes through except the hit cell
+	// Amanatides-Woo traversal of the part of the ray inside this row of tiles
+	if (rayCasting && missUpdate != 0.0f) {
+		const float noBorder = std::numeric_limits<float>::max();
+		for (size_t p=0; p<count; p++) {
+			const float dx = px[p] - sensorX;
+			const float dy = py[p] - sensorY;
+			const int hitX = (int)std::floor(px[p]);
+			const int hitY = (int)std::floor(py[p]);
+			
+			// ray parameter t from 0 at the scanner to 1 at the hit, clipped to the rows r0 to r1
+			float tStart = 0.0f;
+			float tEnd = 1.0f;
+			if (dy != 0.0f) {
+				const float a = (r0 - sensorY) / dy;
+				const float b = (r1 - sensorY) / dy;
+				tStart = std::max(tStart, std::min(a, b));
+				tEnd = std::min(tEnd, std::max(a, b));
+			} else if (sensorY < r0 || sensorY >= r1) {
+				continue;
+			}
+			if (tStart > tEnd) {
+				continue;
+			}
+			
+			int cx = (int)std::floor(sensorX + tStart * dx);
+			int cy = std::min(r1 - 1, std::max(r0, (int)std::floor(sensorY + tStart * dy)));
+			
+			const int stepX = dx > 0.0f ? 1 : -1;
+			const int stepY = dy > 0.0f ? 1 : -1;
+			
+			// t of the next vertical / horizontal cell border and t between two borders
+			float tMaxX = dx != 0.0f ? ((dx > 0.0f ? cx + 1 : cx) - sensorX) / dx : noBorder;
+			float tMaxY = dy != 0.0f ? ((dy > 0.0f ? cy + 1 : cy) - sensorY) / dy : noBorder;
+			const float tDeltaX = dx != 0.0f ? std::abs(1.0f / dx) : noBorder;
+			const float tDeltaY = dy != 0.0f ? std::abs(1.0f / dy) : noBorder;
+			
+			while (cy >= r0 && cy < r1 && (cx != hitX || cy != hitY)) {
+				if (cx >= 0 && cx < w) {
+					float& cell = cells[cellIndex(cx, cy)];
+					cell = std::max(minLimit, cell + missUpdate);
+				}
+				
+				if (tMaxX < tMaxY) {
+					if (tMaxX > tEnd) {
+						break;
+					}
+					cx += stepX;
+					tMaxX += tDeltaX;
+				} else {
+					if (tMaxY > tEnd) {
+						break;
+					}
+					cy += stepY;
+					tMaxY += tDeltaY;
+				}
+			}
+		}
+	}
+	
+	//----------------------------------------
+	// hits
+	for (size_t p=0; p<count; p++) {
+		const int cy = (int)std::floor(py[p]);
+		if (cy < r0 || cy >= r1) {
+			continue;
+		}
+		const int cx = (int)std::floor(px[p]);
+		if (cx < 0 || cx >= w) {
+			continue;
+		}
+		
+		float& cell = cells[cellIndex(cx, cy)];
+		cell = std::min(maxLimit, cell + hitUpdate);
+	}
+}
@@ -0,0 +1,112 @@
+//
+//  ofxR2000OccupancyGrid.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// tiled 2D occupancy / heat map grid accumulating scans
+//
+
+#ifndef ofxR2000OccupancyGrid_h
+#define ofxR2000OccupancyGrid_h
+
+#include "ofMain.h"
+#include "compact_scan_data.h"
+#include "cartesian_converter.h"
+#include "ofxR2000ThreadPool.h"
+
+using namespace pepperl_fuchs;
+
+// log-odds grid in tiles of 64x64 cells, every tile is contiguous in memory
+// integrate() splits the grid into rows of tiles, each row is updated by one thread,
+// so no two threads ever write the same cell
+// consecutive samples ending in the same cell update the grid once
+// for a heat map set the miss update to 0, disable ray casting and raise the upper limit
+class R2000OccupancyGrid
+{
+public:
+	// numThreads: threads used for updating, 0 uses all cores
+	R2000OccupancyGrid(size_t numThreads = 0);
+	
+	// origin: world position of the corner of cell (0, 0), resolution: cell size [mm]
+	void setup(float originX, float originY, size_t width, size_t height, float resolution);
+	
+	size_t getWidth() const { return width; };
+	size_t getHeight() const { return height; };
+	float getResolution() const { return resolution; };
+	
+	// mark the cells between scanner and hit as free
+	void setRayCasting(bool enable) { rayCasting = enable; };
+	bool getRayCasting() const { return rayCasting; };
+	
+	// log-odds added for a hit / a ray passing through a cell
+	void setHitUpdate(float logOdds) { hitUpdate = logOdds; };
+	void setMissUpdate(float logOdds) { missUpdate = logOdds; };
+	void setLimits(float minLogOdds, float maxLogOdds) { minLimit = minLogOdds; maxLimit = maxLogOdds; };
+	
+	// factor applied to all cells before each integrate(), 1 disables decay
+	void setDecay(float factor) { decay = factor; };
+	float getDecay() const { return decay; };
+	
+	// points further away are ignored [mm]
+	void setMaxRange(float mm) { maxRange = mm; };
+	
+	// pose of the scanner in the grid frame: position [mm] and heading [rad]
+	void integrate(const ScanData& scan, float x, float y, float theta);
+	void integrate(const CompactScanData& scan, float x, float y, float theta);
+	
+	void clear();
+	
+	bool worldToCell(float x, float y, int& cx, int& cy) const;
+	float getLogOdds(size_t cx, size_t cy) const;
+	float getProbability(size_t cx, size_t cy) const;
+	
+	// 8 bit gray image, probability 0 black, 1 white
+	void toPixels(ofPixels& pixels) const;
+	
+	
+private:
+	template<class T> void addPoints(const uint32_t* distances, const T* amplitudes, const float* x, const float* y, size_t count);
+	void update(float x, float y, float theta);
+	void updateTileRow(size_t tileRow);
+	
+	size_t cellIndex(size_t cx, size_t cy) const {
+		return ((cy >> TILE_SHIFT) * tilesX + (cx >> TILE_SHIFT)) * TILE_CELLS + (cy & TILE_MASK) * TILE_SIZE + (cx & TILE_MASK);
+	}
+	
+	static const size_t TILE_SHIFT = 6;
+	static const size_t TILE_SIZE = 1 << TILE_SHIFT;
+	static const size_t TILE_MASK = TILE_SIZE - 1;
+	static const size_t TILE_CELLS = TILE_SIZE * TILE_SIZE;
+	
+	float originX;
+	float originY;
+	size_t width;
+	size_t height;
+	float resolution;
+	size_t tilesX;
+	size_t tilesY;
+	
+	bool rayCasting;
+	float hitUpdate;
+	float missUpdate;
+	float minLimit;
+	float maxLimit;
+	float decay;
+	float maxRange;
+	
+	// log-odds, tile-major
+	std::vector<float> cells;
+	
+	// current scan: scanner and end points in cell coordinates
+	float sensorX;
+	float sensorY;
+	std::vector<float> endX;
+	std::vector<float> endY;
+	
+	CartesianConverter converter;
+	PointCloud2D cloud;
+	R2000ThreadPool pool;
+};
+
+#endif /* ofxR2000OccupancyGrid_h */
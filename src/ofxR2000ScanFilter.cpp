@@ -0,0 +1,222 @@
+//
+//  ofxR2000ScanFilter.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// noise reduction for scans: amplitude threshold, temporal median per beam, spatial median
+//
+
+#include "ofxR2000ScanFilter.h"
+
+// beams sorted at once, keeps the sorting rows in the L1 cache
+static const size_t BLOCK_SIZE = 256;
+
+static const size_t MAX_WINDOW = 15;
+
+
+template<class T>
+static void rejectAmplitudes(uint32_t* distances, const T* amplitudes, size_t count, uint32_t threshold)
+{
+	for (size_t i=0; i<count; i++) {
+		distances[i] = amplitudes[i] < threshold ? INVALID_DISTANCE : distances[i];
+	}
+}
+
+static size_t clampWindow(size_t k)
+{
+	return std::max<size_t>(1, std::min(k, MAX_WINDOW));
+}
+
+
+R2000ScanFilter::R2000ScanFilter() :
+	temporalWindow(5)
+	,spatialWindow(1)
+	,amplitudeThreshold(32)
+	,historyBeams(0)
+	,historySlot(0)
+	,historyFilled(0)
+{}
+
+void R2000ScanFilter::setTemporalWindow(size_t k)
+{
+	k = clampWindow(k);
+	if (k != temporalWindow) {
+		temporalWindow = k;
+		reset();
+	}
+}
+
+void R2000ScanFilter::setSpatialWindow(size_t k)
+{
+	k = clampWindow(k);
+	// odd, so the window is centered
+	spatialWindow = k | 1;
+}
+
+void R2000ScanFilter::reset()
+{
+	historyBeams = 0;
+	historySlot = 0;
+	historyFilled = 0;
+}
+
+void R2000ScanFilter::process(ScanData& scan)
+{
+	if (scan.headers.empty() || scan.distance_data.empty()) {
+		return;
+	}
+	
+	if (amplitudeThreshold > 0 && scan.amplitude_data.size() >= scan.distance_data.size()) {
+		rejectAmplitudes(scan.distance_data.data(), scan.amplitude_data.data(), scan.distance_data.size(), amplitudeThreshold);
+	}
+	
+	if (temporalWindow <= 1 && spatialWindow <= 1) {
+		return;
+	}
+	
+	// scatter into beam order, beams of lost packets stay invalid
+	const size_t numBeams = scan.headers[0].num_points_scan;
+	beams.assign(numBeams, INVALID_DISTANCE);
+	
+	size_t offset = 0;
+	for (size_t h=0; h<scan.headers.size() && offset < scan.distance_data.size(); h++) {
+		const PacketHeader& header = scan.headers[h];
+		const size_t count = std::min((size_t)header.num_points_packet, scan.distance_data.size() - offset);
+		if (header.first_index < numBeams) {
+			const size_t n = std::min(count, numBeams - header.first_index);
+			std::copy(scan.distance_data.begin() + offset, scan.distance_data.begin() + offset + n, beams.begin() + header.first_index);
+		}
+		offset += count;
+	}
+	
+	filterBeams(beams.data(), numBeams);
+	
+	// gather back into sample order
+	offset = 0;
+	for (size_t h=0; h<scan.headers.size() && offset < scan.distance_data.size(); h++) {
+		const PacketHeader& header = scan.headers[h];
+		const size_t count = std::min((size_t)header.num_points_packet, scan.distance_data.size() - offset);
+		if (header.first_index < numBeams) {
+			const size_t n = std::min(count, numBeams - header.first_index);
+			std::copy(beams.begin() + header.first_index, beams.begin() + header.first_index + n, scan.distance_data.begin() + offset);
+		}
+		offset += count;
+	}
+}
+
+void R2000ScanFilter::process(CompactScanData& scan)
+{
+	const size_t numBeams = std::min(scan.distance_data.size(), (size_t)scan.info.num_points_scan);
+	if (numBeams == 0) {
+		return;
+	}
+	
+	// packet type A scans have no amplitudes
+	if (amplitudeThreshold > 0 && !scan.amplitude_data.empty() && scan.amplitude_data.size() >= numBeams) {
+		rejectAmplitudes(scan.distance_data.data(), scan.amplitude_data.data(), numBeams, amplitudeThreshold);
+	}
+	
+	if (temporalWindow <= 1 && spatialWindow <= 1) {
+		return;
+	}
+	
+	filterBeams(scan.distance_data.data(), numBeams);
+}
+
+void R2000ScanFilter::filterBeams(uint32_t* data, size_t numBeams)
+{
+	const uint32_t* current = data;
+	
+	//----------------------------------------
+	// temporal median over the history ring
+	if (temporalWindow > 1) {
+		
+		// new scan configuration
+		if (historyBeams != numBeams) {
+			history.resize(temporalWindow * numBeams);
+			historyBeams = numBeams;
+			historySlot = 0;
+			historyFilled = 0;
+		}
+		
+		std::copy(data, data + numBeams, history.begin() + historySlot * numBeams);
+		historySlot = (historySlot + 1) % temporalWindow;
+		historyFilled = std::min(historyFilled + 1, temporalWindow);
+		
+		// row order does not matter for the median
+		rows.resize(historyFilled);
+		for (size_t r=0; r<historyFilled; r++) {
+			rows[r] = history.data() + r * numBeams;
+		}
+		
+		temporal.resize(numBeams);
+		medianRows(rows.data(), historyFilled, numBeams, temporal.data());
+		current = temporal.data();
+	}
+	
+	//----------------------------------------
+	// spatial median over neighbouring beams
+	if (spatialWindow > 1 && numBeams > spatialWindow) {
+		const size_t radius = spatialWindow / 2;
+		
+		// data is the output, so the rows have to read from a copy
+		if (current == data) {
+			temporal.assign(data, data + numBeams);
+			current = temporal.data();
+		}
+		
+		// rows are the same array shifted by -radius..radius
+		rows.resize(spatialWindow);
+		for (size_t r=0; r<spatialWindow; r++) {
+			rows[r] = current + r;
+		}
+		
+		// borders keep their value
+		std::copy(current, current + radius, data);
+		std::copy(current + numBeams - radius, current + numBeams, data + numBeams - radius);
+		
+		medianRows(rows.data(), spatialWindow, numBeams - 2 * radius, data + radius);
+		
+	} else if (current != data) {
+		std::copy(current, current + numBeams, data);
+	}
+}
+
+void R2000ScanFilter::medianRows(const uint32_t* const* rowPtrs, size_t numRows, size_t count, uint32_t* out)
+{
+	if (numRows == 1) {
+		std::copy(rowPtrs[0], rowPtrs[0] + count, out);
+		return;
+	}
+	
+	scratch.resize(numRows * BLOCK_SIZE);
+	uint32_t* s = scratch.data();
+	
+	for (size_t start=0; start<count; start+=BLOCK_SIZE) {
+		const size_t n = std::min(BLOCK_SIZE, count - start);
+		
+		for (size_t r=0; r<numRows; r++) {
+			std::copy(rowPtrs[r] + start, rowPtrs[r] + start + n, s + r * BLOCK_SIZE);
+		}
+		
+		// odd-even transposition sort of the rows, every compare-exchange
+		// is a min/max over a whole block which the compiler vectorizes
+		for (size_t round=0; round<numRows; round++) {
+			for (size_t r=round & 1; r+1<numRows; r+=2) {
+				uint32_t* a = s + r * BLOCK_SIZE;
+				uint32_t* b = a + BLOCK_SIZE;
+				for (size_t i=0; i<n; i++) {
+					const uint32_t lo = std::min(a[i], b[i]);
+					const uint32_t hi = std::max(a[i], b[i]);
+					a[i] = lo;
+					b[i] = hi;
+				}
+			}
+		}
+		
+		// lower median for an even number of rows
+		const uint32_t* median = s + ((numRows - 1) / 2) * BLOCK_SIZE;
+		std::copy(median, median + n, out + start);
+	}
+}
@@ -0,0 +1,72 @@
+//
+//  ofxR2000ScanFilter.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// noise reduction for scans: amplitude threshold, temporal median per beam, spatial median
+//
+
+#ifndef ofxR2000ScanFilter_h
+#define ofxR2000ScanFilter_h
+
+#include "ofMain.h"
+#include "compact_scan_data.h"
+
+using namespace pepperl_fuchs;
+
+// filters the distances of consecutive scans of one scanner in place
+// rejected samples get the distance INVALID_DISTANCE
+// medians treat INVALID_DISTANCE as the largest value, so a beam stays invalid if most of its window is invalid
+class R2000ScanFilter
+{
+public:
+	R2000ScanFilter();
+	
+	// median over the last k scans per beam, 1 disables the temporal filter
+	void setTemporalWindow(size_t k);
+	size_t getTemporalWindow() const { return temporalWindow; };
+	
+	// median over k neighbouring beams (odd), 1 disables the spatial filter
+	void setSpatialWindow(size_t k);
+	size_t getSpatialWindow() const { return spatialWindow; };
+	
+	// samples with a lower amplitude are rejected, 32 is the documented limit for valid echos, 0 disables
+	void setAmplitudeThreshold(uint32_t threshold) { amplitudeThreshold = threshold; };
+	uint32_t getAmplitudeThreshold() const { return amplitudeThreshold; };
+	
+	// forget the scan history
+	void reset();
+	
+	void process(ScanData& scan);
+	void process(CompactScanData& scan);
+	
+	
+private:
+	// run the temporal and spatial stage on beam-indexed distances
+	void filterBeams(uint32_t* beams, size_t numBeams);
+	
+	// median of numRows rows per column, rows[r][i] for i in [0, count)
+	void medianRows(const uint32_t* const* rows, size_t numRows, size_t count, uint32_t* out);
+	
+	size_t temporalWindow;
+	size_t spatialWindow;
+	uint32_t amplitudeThreshold;
+	
+	// ring of the last temporalWindow scans, row-major [scan][beam]
+	AlignedUInt32Vector history;
+	size_t historyBeams;
+	size_t historySlot;
+	size_t historyFilled;
+	
+	// beam-indexed working arrays
+	AlignedUInt32Vector beams;
+	AlignedUInt32Vector temporal;
+	
+	// sorting block, [row][block]
+	AlignedUInt32Vector scratch;
+	
+	std::vector<const uint32_t*> rows;
+};
+
+#endif /* ofxR2000ScanFilter_h */
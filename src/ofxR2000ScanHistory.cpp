@@ -0,0 +1,339 @@
+//
+//  ofxR2000ScanHistory.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// trails of the last scans, kept in a ring in one GPU buffer and drawn with one instanced call
+//
+
+#include "ofxR2000ScanHistory.h"
+
+#ifndef TARGET_OPENGLES
+
+#include <cstring>
+
+
+static const char* historyVertexShader =
+	"#version 150\n"
+	"uniform mat4 modelViewProjectionMatrix;\n"
+	"uniform usamplerBuffer texDist;\n"
+	"uniform usamplerBuffer texPacked;\n"
+	"uniform samplerBuffer texScans;\n"
+	"uniform int usePacked;\n"
+	"uniform int maxSamples;\n"
+	"uniform float now;\n"
+	"uniform float duration;\n"
+	"uniform float scale;\n"
+	"uniform float pointSize;\n"
+	"uniform vec4 color;\n"
+	"out vec4 vertexColor;\n"
+	"void main() {\n"
+	"	// first angle, angular increment, samples, time added\n"
+	"	vec4 scan = texelFetch(texScans, gl_InstanceID);\n"
+	"	float age = now - scan.w;\n"
+	"	int texel = gl_InstanceID * maxSamples + gl_VertexID;\n"
+	"	uint dist = usePacked == 1 ? texelFetch(texPacked, texel).r & 0xFFFFFu : texelFetch(texDist, texel).r;\n"
+	"	gl_PointSize = pointSize;\n"
+	"	// samples beyond the scan, invalid or faded out are moved outside the clip volume\n"
+	"	if (float(gl_VertexID) >= scan.z || dist == 0xFFFFFu || age < 0.0 || age > duration) {\n"
+	"		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+	"		vertexColor = vec4(0.0);\n"
+	"		return;\n"
+	"	}\n"
+	"	float angle = scan.x + scan.y * float(gl_VertexID);\n"
+	"	float d = float(dist) * scale;\n"
+	"	gl_Position = modelViewProjectionMatrix * vec4(cos(angle) * d, sin(angle) * d, 0.0, 1.0);\n"
+	"	vertexColor = vec4(color.rgb, color.a * (1.0 - age / max(duration, 0.001)));\n"
+	"}\n";
+
+static const char* historyFragmentShader =
+	"#version 150\n"
+	"in vec4 vertexColor;\n"
+	"out vec4 outputColor;\n"
+	"void main() {\n"
+	"	outputColor = vertexColor;\n"
+	"}\n";
+
+
+R2000ScanHistory::R2000ScanHistory() :
+	allocated(false)
+	,format(SCAN_SINK_PACKED)
+	,capacity(0)
+	,numScans(0)
+	,distanceBuffer(0)
+	,amplitudeBuffer(0)
+	,slotBuffer(0)
+	,distanceTexture(0)
+	,amplitudeTexture(0)
+	,slotTexture(0)
+	,vao(0)
+	,head(0)
+	,duration(2.0)
+	,color(1.0, 1.0, 1.0, 1.0)
+	,pointSize(2.0)
+	,scale(1.0)
+	,scansAdded(0)
+	,scansDropped(0)
+{
+}
+
+R2000ScanHistory::~R2000ScanHistory()
+{
+	clear();
+}
+
+bool R2000ScanHistory::setup(size_t maxSamples, size_t scans, ScanSinkFormat sinkFormat)
+{
+	clear();
+
+	format = sinkFormat;
+	capacity = std::max<size_t>(1, maxSamples);
+	numScans = std::max<size_t>(1, scans);
+
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if ((size_t)maxTexels < numScans * capacity) {
+		ofLogError("R2000ScanHistory") << "buffer textures are limited to " << maxTexels << " texels, " << numScans * capacity << " needed";
+		capacity = 0;
+		numScans = 0;
+		return false;
+	}
+
+	if (!shader.setupShaderFromSource(GL_VERTEX_SHADER, historyVertexShader) ||
+		!shader.setupShaderFromSource(GL_FRAGMENT_SHADER, historyFragmentShader))
+	{
+		ofLogError("R2000ScanHistory") << "compiling the shader failed";
+		clear();
+		return false;
+	}
+	shader.bindDefaults();
+	if (!shader.linkProgram()) {
+		ofLogError("R2000ScanHistory") << "linking the shader failed";
+		clear();
+		return false;
+	}
+
+	// samples are written by add() only, slots start empty with 0 samples
+	const GLsizeiptr bytes = numScans * capacity * sizeof(uint32_t);
+	std::vector<ScanSlot> emptySlots(numScans);
+	std::memset(&emptySlots[0], 0, numScans * sizeof(ScanSlot));
+
+	struct {
+		GLuint* buffer;
+		GLuint* texture;
+		GLsizeiptr bytes;
+		const void* data;
+		GLenum textureFormat;
+	} buffers[3] = {
+		{ &distanceBuffer, &distanceTexture, bytes, 0, GL_R32UI },
+		{ &slotBuffer, &slotTexture, (GLsizeiptr)(numScans * sizeof(ScanSlot)), &emptySlots[0], GL_RGBA32F },
+		{ &amplitudeBuffer, &amplitudeTexture, bytes, 0, GL_R32UI }
+	};
+
+	// packed samples need no amplitude buffer
+	const int numBuffers = isPacked() ? 2 : 3;
+
+	for (int i=0; i<numBuffers; i++) {
+		glGenBuffers(1, buffers[i].buffer);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i].buffer);
+		glBufferData(GL_TEXTURE_BUFFER, buffers[i].bytes, buffers[i].data, GL_DYNAMIC_DRAW);
+
+		glGenTextures(1, buffers[i].texture);
+		glBindTexture(GL_TEXTURE_BUFFER, *buffers[i].texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, buffers[i].textureFormat, *buffers[i].buffer);
+	}
+
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenVertexArrays(1, &vao);
+
+	slots = emptySlots;
+	allocated = true;
+	return true;
+}
+
+void R2000ScanHistory::clear()
+{
+	GLuint* buffers[3] = { &distanceBuffer, &amplitudeBuffer, &slotBuffer };
+	GLuint* textures[3] = { &distanceTexture, &amplitudeTexture, &slotTexture };
+
+	for (int i=0; i<3; i++) {
+		if (*textures[i]) {
+			glDeleteTextures(1, textures[i]);
+			*textures[i] = 0;
+		}
+		if (*buffers[i]) {
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+
+	if (vao) {
+		glDeleteVertexArrays(1, &vao);
+		vao = 0;
+	}
+
+	if (shader.isLoaded()) {
+		shader.unload();
+	}
+
+	slots.clear();
+	allocated = false;
+	capacity = 0;
+	numScans = 0;
+	head = 0;
+}
+
+bool R2000ScanHistory::add(const R2000GpuStream& stream)
+{
+	if (allocated && stream.isPacked() != isPacked()) {
+		ofLogError("R2000ScanHistory") << "the stream has to be " << (isPacked() ? "packed" : "not packed");
+		scansDropped++;
+		return false;
+	}
+
+	const size_t size = stream.getNumSamples();
+	if (!fits(size)) {
+		return false;
+	}
+
+	// copied by the GPU before the stream fences the slot with its next update()
+	const GLintptr readOffset = stream.getOffset() * sizeof(uint32_t);
+	const GLintptr writeOffset = head * capacity * sizeof(uint32_t);
+	const GLsizeiptr bytes = size * sizeof(uint32_t);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, stream.getDistanceBufferId());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, distanceBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, readOffset, writeOffset, bytes);
+
+	if (!isPacked()) {
+		glBindBuffer(GL_COPY_READ_BUFFER, stream.getAmplitudeBufferId());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, amplitudeBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, readOffset, writeOffset, bytes);
+	}
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	finishSlot(stream.getScanInfo(), size);
+	return true;
+}
+
+bool R2000ScanHistory::add(const CompactScanData& scan)
+{
+	const size_t size = std::min<size_t>(scan.info.num_points_scan, scan.distance_data.size());
+	if (!fits(size)) {
+		return false;
+	}
+
+	const GLintptr offset = head * capacity * sizeof(uint32_t);
+	const GLsizeiptr bytes = size * sizeof(uint32_t);
+
+	staging.resize(size);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, distanceBuffer);
+	if (isPacked()) {
+		for (size_t i=0; i<size; i++) {
+			staging[i] = R2000GpuStream::packSample(scan.distance_data[i], i < scan.amplitude_data.size() ? scan.amplitude_data[i] : 0);
+		}
+		glBufferSubData(GL_TEXTURE_BUFFER, offset, bytes, &staging[0]);
+	} else {
+		glBufferSubData(GL_TEXTURE_BUFFER, offset, bytes, &scan.distance_data[0]);
+
+		for (size_t i=0; i<size; i++) {
+			staging[i] = i < scan.amplitude_data.size() ? scan.amplitude_data[i] : 0;
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, amplitudeBuffer);
+		glBufferSubData(GL_TEXTURE_BUFFER, offset, bytes, &staging[0]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	finishSlot(scan.info, size);
+	return true;
+}
+
+bool R2000ScanHistory::fits(size_t size)
+{
+	if (!allocated || size == 0 || size > capacity) {
+		scansDropped++;
+		return false;
+	}
+	return true;
+}
+
+void R2000ScanHistory::finishSlot(const ScanInfo& info, size_t size)
+{
+	// angles are in 1/10000 degree
+	ScanSlot& slot = slots[head];
+	slot.firstAngle = (float)(info.start_angle * PI / 1800000.0);
+	slot.angularIncrement = (float)(info.angular_increment * PI / 1800000.0);
+	slot.size = (float)size;
+	slot.time = ofGetElapsedTimef();
+
+	glBindBuffer(GL_TEXTURE_BUFFER, slotBuffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, head * sizeof(ScanSlot), sizeof(ScanSlot), &slot);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	head = (head + 1) % numScans;
+	scansAdded++;
+}
+
+void R2000ScanHistory::setUniforms(ofShader& s, int textureLocation) const
+{
+	if (isPacked()) {
+		s.setUniformTexture("texPacked", GL_TEXTURE_BUFFER, distanceTexture, textureLocation);
+		s.setUniformTexture("texScans", GL_TEXTURE_BUFFER, slotTexture, textureLocation + 1);
+	} else {
+		s.setUniformTexture("texDist", GL_TEXTURE_BUFFER, distanceTexture, textureLocation);
+		s.setUniformTexture("texAmp", GL_TEXTURE_BUFFER, amplitudeTexture, textureLocation + 1);
+		s.setUniformTexture("texScans", GL_TEXTURE_BUFFER, slotTexture, textureLocation + 2);
+	}
+	s.setUniform1i("usePacked", isPacked() ? 1 : 0);
+	s.setUniform1i("maxSamples", (int)capacity);
+	s.setUniform1f("now", ofGetElapsedTimef());
+	s.setUniform1f("duration", duration);
+	s.setUniform1f("scale", scale);
+	s.setUniform1f("pointSize", pointSize);
+	s.setUniform4f("color", color.r, color.g, color.b, color.a);
+}
+
+void R2000ScanHistory::draw()
+{
+	draw(shader);
+}
+
+void R2000ScanHistory::draw(ofShader& s)
+{
+	if (!allocated) {
+		return;
+	}
+
+	// only as many points and instances as the scans in the ring need
+	const float now = ofGetElapsedTimef();
+	size_t numPoints = 0;
+	size_t numInstances = 0;
+	for (size_t i=0; i<numScans; i++) {
+		if (slots[i].size > 0 && now - slots[i].time <= duration) {
+			numPoints = std::max(numPoints, (size_t)slots[i].size);
+			numInstances = i + 1;
+		}
+	}
+	if (numInstances == 0) {
+		return;
+	}
+
+	s.begin();
+	setUniforms(s);
+
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	glBindVertexArray(vao);
+	glDrawArraysInstanced(GL_POINTS, 0, (GLsizei)numPoints, (GLsizei)numInstances);
+	glBindVertexArray(0);
+	glDisable(GL_PROGRAM_POINT_SIZE);
+
+	s.end();
+}
+
+#endif
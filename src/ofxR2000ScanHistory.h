@@ -0,0 +1,132 @@
+//
+//  ofxR2000ScanHistory.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// trails of the last scans, kept in a ring in one GPU buffer and drawn with one instanced call
+//
+
+#ifndef ofxR2000ScanHistory_h
+#define ofxR2000ScanHistory_h
+
+#include "ofMain.h"
+#include "ofxR2000GpuStream.h"
+
+using namespace pepperl_fuchs;
+
+// needs buffer textures and instancing, not available with OpenGL ES
+#ifndef TARGET_OPENGLES
+
+// numScans slots of maxSamples samples in one buffer, stored like R2000GpuStream (packed or distance and amplitude)
+// add() writes the newest scan into the oldest slot, nothing else is uploaded:
+// from an R2000GpuStream the scan is copied on the GPU, a CompactScanData is uploaded with glBufferSubData
+// angles, size and time of every slot are kept in a small RGBA32F buffer texture
+//
+// draw() renders GL_POINTS without vertex attributes, gl_VertexID is the sample and gl_InstanceID the slot,
+// scans fade out over the duration and are culled in the vertex shader afterwards, like invalid samples
+// the GL thread only
+class R2000ScanHistory
+{
+public:
+	R2000ScanHistory();
+	~R2000ScanHistory();
+
+	// ring of numScans scans of up to maxSamples samples each
+	bool setup(size_t maxSamples = 25200, size_t numScans = 50, ScanSinkFormat format = SCAN_SINK_PACKED);
+	void clear();
+
+	bool isAllocated() const { return allocated; };
+	bool isPacked() const { return format == SCAN_SINK_PACKED; };
+	size_t getMaxSamples() const { return capacity; };
+	size_t getNumScans() const { return numScans; };
+
+	// scans added during the last seconds are drawn, fading out linearly [s]
+	void setDuration(float seconds) { duration = seconds; };
+	float getDuration() const { return duration; };
+
+	// color of the newest scan
+	void setColor(const ofFloatColor& c) { color = c; };
+	const ofFloatColor& getColor() const { return color; };
+
+	// point size in pixels
+	void setPointSize(float size) { pointSize = size; };
+	float getPointSize() const { return pointSize; };
+
+	// world units per mm
+	void setScale(float s) { scale = s; };
+	float getScale() const { return scale; };
+
+	// copy the current scan of a stream with the same format on the GPU,
+	// call after stream.update() returned true and before its next update()
+	bool add(const R2000GpuStream& stream);
+
+	// upload a scan
+	bool add(const CompactScanData& scan);
+
+	// draw all scans younger than the duration with one instanced draw call
+	void draw();
+
+	// draw with an own shader, it gets the uniforms of setUniforms()
+	void draw(ofShader& shader);
+
+	// bind texDist and texAmp or texPacked at textureLocation, texScans after them,
+	// set usePacked, maxSamples, now, duration, scale, pointSize and color
+	void setUniforms(ofShader& shader, int textureLocation = 0) const;
+
+	// scans added and not fitting into a slot
+	uint64_t getScansAdded() const { return scansAdded; };
+	uint64_t getScansDropped() const { return scansDropped; };
+
+private:
+	// first angle [rad], angular increment [rad], samples, time added [s]
+	struct ScanSlot {
+		float firstAngle;
+		float angularIncrement;
+		float size;
+		float time;
+	};
+
+	// false and counted as dropped if a scan of size samples does not fit into a slot
+	bool fits(size_t size);
+
+	// store the info of the scan written to the head slot and advance the head
+	void finishSlot(const ScanInfo& info, size_t size);
+
+	bool allocated;
+	ScanSinkFormat format;
+	size_t capacity;
+	size_t numScans;
+
+	// distance or packed samples, amplitudes, slot info
+	GLuint distanceBuffer;
+	GLuint amplitudeBuffer;
+	GLuint slotBuffer;
+	GLuint distanceTexture;
+	GLuint amplitudeTexture;
+	GLuint slotTexture;
+
+	// attributeless drawing still needs a vertex array object with a core profile
+	GLuint vao;
+
+	ofShader shader;
+
+	// copy of the slot buffer, slot written by the next add()
+	std::vector<ScanSlot> slots;
+	size_t head;
+
+	// packed samples or amplitudes of add(CompactScanData)
+	std::vector<uint32_t> staging;
+
+	float duration;
+	ofFloatColor color;
+	float pointSize;
+	float scale;
+
+	uint64_t scansAdded;
+	uint64_t scansDropped;
+};
+
+#endif
+
+#endif /* ofxR2000ScanHistory_h */
@@ -0,0 +1,743 @@
+//
+//  ofxR2000ScanMatcher.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// scan-to-scan matching (point-to-line ICP with correlative fallback) and laser odometry
+//
+
+#include "ofxR2000ScanMatcher.h"
+
+#include <limits>
+
+
+// neighbours in scan order used for the normal of a reference point
+static const int NORMAL_SPAN = 24;
+
+// points per parallel chunk of the correspondence search
+static const size_t CHUNK_SIZE = 1024;
+
+// residuals above HUBER_FACTOR * rms of the previous iteration are down-weighted
+static const float HUBER_FACTOR = 1.5f;
+
+// points scored by the correlative search
+static const size_t CORRELATIVE_POINTS = 1500;
+
+static float wrapAngle(float angle)
+{
+	while (angle > PI) angle -= TWO_PI;
+	while (angle < -PI) angle += TWO_PI;
+	return angle;
+}
+
+
+R2000ScanMatcher::R2000ScanMatcher(size_t numThreads) :
+	maxCorrespondence(100.0f)
+	,maxIterations(30)
+	,convergenceTranslation(0.1f)
+	,convergenceRotation(1e-5f)
+	,pointStep(1)
+	,minRange(50.0f)
+	,maxRange(30000.0f)
+	,minInlierRatio(0.5f)
+	,correlativeFallback(true)
+	,searchTranslation(500.0f)
+	,searchAngle(ofDegToRad(20.0f))
+	,searchAngleStep(ofDegToRad(0.5f))
+	,likelihoodResolution(25.0f)
+	,gridX(0)
+	,gridY(0)
+	,gridScale(1)
+	,gridWidth(0)
+	,gridHeight(0)
+	,likelihoodValid(false)
+	,likelihoodX(0)
+	,likelihoodY(0)
+	,likelihoodCellSize(1)
+	,likelihoodWidth(0)
+	,likelihoodHeight(0)
+	,pool(numThreads)
+{
+	resetOdometry();
+}
+
+void R2000ScanMatcher::setMaxCorrespondenceDistance(float distance)
+{
+	maxCorrespondence = distance;
+	
+	// the grid depends on the distance, the reference has to be set again
+	refX.clear();
+	refY.clear();
+	refNx.clear();
+	refNy.clear();
+	likelihoodValid = false;
+}
+
+void R2000ScanMatcher::setSearchWindow(float translation, float angleDegrees, float angleStepDegrees)
+{
+	searchTranslation = translation;
+	searchAngle = ofDegToRad(angleDegrees);
+	searchAngleStep = ofDegToRad(std::max(0.01f, angleStepDegrees));
+}
+
+void R2000ScanMatcher::setCorrelativeResolution(float cellSize)
+{
+	likelihoodResolution = cellSize;
+	likelihoodValid = false;
+}
+
+//--------------------------------------------------------------
+// reference
+//--------------------------------------------------------------
+void R2000ScanMatcher::setReference(const ScanData& scan, const PointCloud2D& cloud)
+{
+	setReference(scan.distance_data.data(), cloud, std::min(scan.distance_data.size(), cloud.size()));
+}
+
+void R2000ScanMatcher::setReference(const CompactScanData& scan, const PointCloud2D& cloud)
+{
+	setReference(scan.distance_data.data(), cloud, std::min(scan.distance_data.size(), cloud.size()));
+}
+
+void R2000ScanMatcher::setReference(const uint32_t* distances, const PointCloud2D& cloud, size_t count)
+{
+	likelihoodValid = false;
+	
+	// valid points in scan order
+	srcX.clear();
+	srcY.clear();
+	for (size_t i=0; i<count; i++) {
+		if (isValid(distances[i])) {
+			srcX.push_back(cloud.x[i]);
+			srcY.push_back(cloud.y[i]);
+		}
+	}
+	
+	tmpX.clear();
+	tmpY.clear();
+	tmpNx.clear();
+	tmpNy.clear();
+	
+	const int n = (int)srcX.size();
+	const float radius = 0.5f * maxCorrespondence;
+	const float radius2 = radius * radius;
+	
+	// the reference needs far fewer points than the scan, keep one every spacing
+	const float spacing = maxCorrespondence / 8.0f;
+	const float spacing2 = spacing * spacing;
+	float lastX = std::numeric_limits<float>::max();
+	float lastY = std::numeric_limits<float>::max();
+	
+	for (int i=0; i<n; i++) {
+		const float dx = srcX[i] - lastX;
+		const float dy = srcY[i] - lastY;
+		if (dx * dx + dy * dy < spacing2) {
+			continue;
+		}
+		
+		// neighbours closer than radius, contiguous in scan order
+		int a = i;
+		while (a > 0 && i - a < NORMAL_SPAN) {
+			const float ex = srcX[a - 1] - srcX[i];
+			const float ey = srcY[a - 1] - srcY[i];
+			if (ex * ex + ey * ey > radius2) break;
+			a--;
+		}
+		int b = i;
+		while (b + 1 < n && b - i < NORMAL_SPAN) {
+			const float ex = srcX[b + 1] - srcX[i];
+			const float ey = srcY[b + 1] - srcY[i];
+			if (ex * ex + ey * ey > radius2) break;
+			b++;
+		}
+		
+		const int m = b - a + 1;
+		if (m < 3) {
+			continue;
+		}
+		
+		// principal axes of the neighbourhood
+		double mx = 0.0;
+		double my = 0.0;
+		for (int k=a; k<=b; k++) {
+			mx += srcX[k];
+			my += srcY[k];
+		}
+		mx /= m;
+		my /= m;
+		
+		double sxx = 0.0;
+		double syy = 0.0;
+		double sxy = 0.0;
+		for (int k=a; k<=b; k++) {
+			const double ex = srcX[k] - mx;
+			const double ey = srcY[k] - my;
+			sxx += ex * ex;
+			syy += ey * ey;
+			sxy += ex * ey;
+		}
+		
+		const double half = 0.5 * (sxx - syy);
+		const double root = std::sqrt(half * half + sxy * sxy);
+		const double lambdaMin = 0.5 * (sxx + syy) - root;
+		const double lambdaMax = 0.5 * (sxx + syy) + root;
+		
+		// corners and clutter have no reliable normal
+		if (lambdaMax <= 0.0 || lambdaMin > 0.1 * lambdaMax) {
+			continue;
+		}
+		
+		const double phi = 0.5 * std::atan2(2.0 * sxy, sxx - syy);
+		
+		tmpX.push_back((float)mx);
+		tmpY.push_back((float)my);
+		tmpNx.push_back((float)-std::sin(phi));
+		tmpNy.push_back((float)std::cos(phi));
+		
+		lastX = srcX[i];
+		lastY = srcY[i];
+	}
+	
+	buildGrid();
+}
+
+void R2000ScanMatcher::buildGrid()
+{
+	const size_t n = tmpX.size();
+	
+	refX.resize(n);
+	refY.resize(n);
+	refNx.resize(n);
+	refNy.resize(n);
+	
+	if (n == 0) {
+		gridWidth = 0;
+		gridHeight = 0;
+		return;
+	}
+	
+	float minX = tmpX[0];
+	float maxX = tmpX[0];
+	float minY = tmpY[0];
+	float maxY = tmpY[0];
+	for (size_t i=1; i<n; i++) {
+		minX = std::min(minX, tmpX[i]);
+		maxX = std::max(maxX, tmpX[i]);
+		minY = std::min(minY, tmpY[i]);
+		maxY = std::max(maxY, tmpY[i]);
+	}
+	
+	// cells at least as large as the max correspondence distance, so 3x3 cells cover the search radius
+	float cellSize = std::max(maxCorrespondence, 1e-6f);
+	while ((size_t)((maxX - minX) / cellSize + 1) * (size_t)((maxY - minY) / cellSize + 1) > (1 << 22)) {
+		cellSize *= 2.0f;
+	}
+	
+	gridX = minX;
+	gridY = minY;
+	gridScale = 1.0f / cellSize;
+	gridWidth = (int)((maxX - minX) * gridScale) + 1;
+	gridHeight = (int)((maxY - minY) * gridScale) + 1;
+	
+	// counting sort of the points by cell
+	cellStart.assign((size_t)gridWidth * gridHeight + 1, 0);
+	cellOf.resize(n);
+	for (size_t i=0; i<n; i++) {
+		const int cx = std::min(gridWidth - 1, (int)((tmpX[i] - gridX) * gridScale));
+		const int cy = std::min(gridHeight - 1, (int)((tmpY[i] - gridY) * gridScale));
+		cellOf[i] = (uint32_t)(cy * gridWidth + cx);
+		cellStart[cellOf[i] + 1]++;
+	}
+	for (size_t c=1; c<cellStart.size(); c++) {
+		cellStart[c] += cellStart[c - 1];
+	}
+	for (size_t i=0; i<n; i++) {
+		const uint32_t k = cellStart[cellOf[i]]++;
+		refX[k] = tmpX[i];
+		refY[k] = tmpY[i];
+		refNx[k] = tmpNx[i];
+		refNy[k] = tmpNy[i];
+	}
+	
+	// cellStart[c] now points to the end of cell c
+	for (size_t c=cellStart.size()-1; c>0; c--) {
+		cellStart[c] = cellStart[c - 1];
+	}
+	cellStart[0] = 0;
+}
+
+//--------------------------------------------------------------
+// matching
+//--------------------------------------------------------------
+R2000MatchResult R2000ScanMatcher::match(const ScanData& scan, const PointCloud2D& cloud, float x, float y, float theta)
+{
+	return match(scan.distance_data.data(), cloud, std::min(scan.distance_data.size(), cloud.size()), x, y, theta);
+}
+
+R2000MatchResult R2000ScanMatcher::match(const CompactScanData& scan, const PointCloud2D& cloud, float x, float y, float theta)
+{
+	return match(scan.distance_data.data(), cloud, std::min(scan.distance_data.size(), cloud.size()), x, y, theta);
+}
+
+R2000MatchResult R2000ScanMatcher::match(const uint32_t* distances, const PointCloud2D& cloud, size_t count, float x, float y, float theta)
+{
+	R2000MatchResult result;
+	result.x = x;
+	result.y = y;
+	result.theta = theta;
+	result.error = 0;
+	result.numInliers = 0;
+	result.numPoints = 0;
+	result.iterations = 0;
+	result.converged = false;
+	result.correlative = false;
+	
+	srcX.clear();
+	srcY.clear();
+	size_t valid = 0;
+	for (size_t i=0; i<count; i++) {
+		if (isValid(distances[i]) && (valid++ % pointStep) == 0) {
+			srcX.push_back(cloud.x[i]);
+			srcY.push_back(cloud.y[i]);
+		}
+	}
+	result.numPoints = srcX.size();
+	
+	if (refX.empty() || srcX.empty()) {
+		return result;
+	}
+	
+	if (icp(result) || !correlativeFallback) {
+		return result;
+	}
+	
+	// start again from the best pose of the correlative search
+	R2000MatchResult fallback = result;
+	fallback.x = x;
+	fallback.y = y;
+	fallback.theta = theta;
+	if (!correlate(fallback)) {
+		return result;
+	}
+	
+	fallback.correlative = true;
+	fallback.iterations = 0;
+	icp(fallback);
+	return fallback;
+}
+
+void R2000ScanMatcher::accumulate(size_t begin, size_t end, float x, float y, float theta, float huber, Accumulator& acc) const
+{
+	for (int k=0; k<6; k++) acc.h[k] = 0.0;
+	for (int k=0; k<3; k++) acc.g[k] = 0.0;
+	acc.error = 0.0;
+	acc.inliers = 0;
+	
+	const float c = std::cos(theta);
+	const float s = std::sin(theta);
+	const float maxDist2 = maxCorrespondence * maxCorrespondence;
+	
+	for (size_t i=begin; i<end; i++) {
+		const float qx = c * srcX[i] - s * srcY[i] + x;
+		const float qy = s * srcX[i] + c * srcY[i] + y;
+		
+		const int cx = (int)std::floor((qx - gridX) * gridScale);
+		const int cy = (int)std::floor((qy - gridY) * gridScale);
+		if (cx < -1 || cy < -1 || cx > gridWidth || cy > gridHeight) {
+			continue;
+		}
+		
+		// nearest reference point in the 3x3 cells around the point
+		float best = maxDist2;
+		int match = -1;
+		for (int gy=std::max(0, cy-1); gy<=std::min(gridHeight-1, cy+1); gy++) {
+			const uint32_t* row = &cellStart[(size_t)gy * gridWidth];
+			const int gx0 = std::max(0, cx - 1);
+			const int gx1 = std::min(gridWidth - 1, cx + 1);
+			if (gx0 > gx1) {
+				continue;
+			}
+			
+			// cells of one row are contiguous
+			for (uint32_t j=row[gx0]; j<row[gx1 + 1]; j++) {
+				const float dx = refX[j] - qx;
+				const float dy = refY[j] - qy;
+				const float d2 = dx * dx + dy * dy;
+				if (d2 < best) {
+					best = d2;
+					match = (int)j;
+				}
+			}
+		}
+		
+		if (match < 0) {
+			continue;
+		}
+		
+		// residual along the normal and its derivative by (x, y, theta)
+		const float nx = refNx[match];
+		const float ny = refNy[match];
+		const double r = nx * (qx - refX[match]) + ny * (qy - refY[match]);
+		const double j0 = nx;
+		const double j1 = ny;
+		const double j2 = nx * -(qy - y) + ny * (qx - x);
+		
+		// huber weight, limits the pull of wrong correspondences at occlusion edges
+		const double w = (huber > 0.0f && std::abs(r) > huber) ? huber / std::abs(r) : 1.0;
+		
+		acc.h[0] += w * j0 * j0;
+		acc.h[1] += w * j0 * j1;
+		acc.h[2] += w * j0 * j2;
+		acc.h[3] += w * j1 * j1;
+		acc.h[4] += w * j1 * j2;
+		acc.h[5] += w * j2 * j2;
+		acc.g[0] += w * j0 * r;
+		acc.g[1] += w * j1 * r;
+		acc.g[2] += w * j2 * r;
+		acc.error += r * r;
+		acc.inliers++;
+	}
+}
+
+bool R2000ScanMatcher::icp(R2000MatchResult& result)
+{
+	const size_t n = srcX.size();
+	const size_t numChunks = (n + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	chunks.resize(numChunks);
+	
+	result.converged = false;
+	
+	// no robust weighting until the residuals of the first iteration are known
+	float huber = 0.0f;
+	
+	for (int it=0; it<maxIterations; it++) {
+		const float x = result.x;
+		const float y = result.y;
+		const float theta = result.theta;
+		
+		pool.parallelFor(numChunks, [&](size_t c) {
+			accumulate(c * CHUNK_SIZE, std::min(n, (c + 1) * CHUNK_SIZE), x, y, theta, huber, chunks[c]);
+		});
+		
+		// sum in chunk order, results do not depend on the thread count
+		Accumulator sum = chunks[0];
+		for (size_t c=1; c<numChunks; c++) {
+			for (int k=0; k<6; k++) sum.h[k] += chunks[c].h[k];
+			for (int k=0; k<3; k++) sum.g[k] += chunks[c].g[k];
+			sum.error += chunks[c].error;
+			sum.inliers += chunks[c].inliers;
+		}
+		
+		result.iterations = it + 1;
+		result.numInliers = sum.inliers;
+		result.error = sum.inliers > 0 ? (float)std::sqrt(sum.error / sum.inliers) : 0.0f;
+		huber = HUBER_FACTOR * result.error;
+		
+		if (sum.inliers < 3) {
+			return false;
+		}
+		
+		// solve H * delta = -g
+		const double* h = sum.h;
+		const double a00 = h[3] * h[5] - h[4] * h[4];
+		const double a01 = h[2] * h[4] - h[1] * h[5];
+		const double a02 = h[1] * h[4] - h[2] * h[3];
+		const double det = h[0] * a00 + h[1] * a01 + h[2] * a02;
+		if (!(std::abs(det) > 1e-12)) {
+			// degenerate, e.g. a single wall
+			return false;
+		}
+		const double a11 = h[0] * h[5] - h[2] * h[2];
+		const double a12 = h[1] * h[2] - h[0] * h[4];
+		const double a22 = h[0] * h[3] - h[1] * h[1];
+		
+		const double dx = -(a00 * sum.g[0] + a01 * sum.g[1] + a02 * sum.g[2]) / det;
+		const double dy = -(a01 * sum.g[0] + a11 * sum.g[1] + a12 * sum.g[2]) / det;
+		const double dt = -(a02 * sum.g[0] + a12 * sum.g[1] + a22 * sum.g[2]) / det;
+		
+		result.x += (float)dx;
+		result.y += (float)dy;
+		result.theta = wrapAngle(result.theta + (float)dt);
+		
+		if (std::sqrt(dx * dx + dy * dy) < convergenceTranslation && std::abs(dt) < convergenceRotation) {
+			result.converged = true;
+			break;
+		}
+	}
+	
+	// slow convergence is fine, too few inliers means a wrong local minimum
+	const bool inliers = result.numInliers >= minInlierRatio * n;
+	result.converged = result.converged && inliers;
+	return inliers;
+}
+
+//--------------------------------------------------------------
+// correlative search
+//--------------------------------------------------------------
+void R2000ScanMatcher::buildLikelihood()
+{
+	likelihoodValid = true;
+	
+	if (refX.empty()) {
+		likelihoodWidth = 0;
+		likelihoodHeight = 0;
+		return;
+	}
+	
+	float minX = refX[0];
+	float maxX = refX[0];
+	float minY = refY[0];
+	float maxY = refY[0];
+	for (size_t i=1; i<refX.size(); i++) {
+		minX = std::min(minX, refX[i]);
+		maxX = std::max(maxX, refX[i]);
+		minY = std::min(minY, refY[i]);
+		maxY = std::max(maxY, refY[i]);
+	}
+	
+	// coarser cells for very large scans
+	float resolution = std::max(likelihoodResolution, 1e-6f);
+	while ((size_t)((maxX - minX) / resolution + 7) * (size_t)((maxY - minY) / resolution + 7) > (1 << 24)) {
+		resolution *= 2.0f;
+	}
+	likelihoodCellSize = resolution;
+	
+	const int margin = 3;
+	likelihoodX = minX - margin * resolution;
+	likelihoodY = minY - margin * resolution;
+	likelihoodWidth = (int)((maxX - minX) / resolution) + 2 * margin + 1;
+	likelihoodHeight = (int)((maxY - minY) / resolution) + 2 * margin + 1;
+	
+	likelihood.assign((size_t)likelihoodWidth * likelihoodHeight, 0);
+	
+	// gaussian around each reference point, sigma of one cell
+	static const int RADIUS = 2;
+	uint8_t kernel[2 * RADIUS + 1][2 * RADIUS + 1];
+	for (int ky=-RADIUS; ky<=RADIUS; ky++) {
+		for (int kx=-RADIUS; kx<=RADIUS; kx++) {
+			kernel[ky + RADIUS][kx + RADIUS] = (uint8_t)(255.0f * std::exp(-0.5f * (kx * kx + ky * ky)) + 0.5f);
+		}
+	}
+	
+	for (size_t i=0; i<refX.size(); i++) {
+		const int cx = (int)((refX[i] - likelihoodX) / resolution);
+		const int cy = (int)((refY[i] - likelihoodY) / resolution);
+		for (int ky=-RADIUS; ky<=RADIUS; ky++) {
+			uint8_t* row = &likelihood[(size_t)(cy + ky) * likelihoodWidth];
+			for (int kx=-RADIUS; kx<=RADIUS; kx++) {
+				row[cx + kx] = std::max(row[cx + kx], kernel[ky + RADIUS][kx + RADIUS]);
+			}
+		}
+	}
+	
+	// max over [x, x + BLOCK) x [y, y + BLOCK), an upper bound for all offsets inside a coarse step
+	std::vector<uint8_t> rows(likelihood.size());
+	for (int y=0; y<likelihoodHeight; y++) {
+		const uint8_t* src = &likelihood[(size_t)y * likelihoodWidth];
+		uint8_t* dst = &rows[(size_t)y * likelihoodWidth];
+		for (int x=0; x<likelihoodWidth; x++) {
+			uint8_t value = 0;
+			for (int k=x; k<std::min(likelihoodWidth, x + LIKELIHOOD_BLOCK); k++) {
+				value = std::max(value, src[k]);
+			}
+			dst[x] = value;
+		}
+	}
+	likelihoodCoarse.resize(likelihood.size());
+	for (int y=0; y<likelihoodHeight; y++) {
+		uint8_t* dst = &likelihoodCoarse[(size_t)y * likelihoodWidth];
+		for (int x=0; x<likelihoodWidth; x++) {
+			uint8_t value = 0;
+			for (int k=y; k<std::min(likelihoodHeight, y + LIKELIHOOD_BLOCK); k++) {
+				value = std::max(value, rows[(size_t)k * likelihoodWidth + x]);
+			}
+			dst[x] = value;
+		}
+	}
+}
+
+uint32_t R2000ScanMatcher::score(const std::vector<int>& cells, int dx, int dy, const std::vector<uint8_t>& grid) const
+{
+	uint32_t sum = 0;
+	for (size_t i=0; i<cells.size(); i+=2) {
+		const int x = cells[i] + dx;
+		const int y = cells[i + 1] + dy;
+		if (x >= 0 && y >= 0 && x < likelihoodWidth && y < likelihoodHeight) {
+			sum += grid[(size_t)y * likelihoodWidth + x];
+		}
+	}
+	return sum;
+}
+
+uint32_t R2000ScanMatcher::scoreCoarse(const std::vector<int>& cells, int dx, int dy) const
+{
+	// the block of a cell up to BLOCK - 1 left of / below the grid still reaches into it,
+	// its max is bounded by the coarse value of the first column / row
+	uint32_t sum = 0;
+	for (size_t i=0; i<cells.size(); i+=2) {
+		const int x = cells[i] + dx;
+		const int y = cells[i + 1] + dy;
+		if (x > -LIKELIHOOD_BLOCK && y > -LIKELIHOOD_BLOCK && x < likelihoodWidth && y < likelihoodHeight) {
+			sum += likelihoodCoarse[(size_t)std::max(y, 0) * likelihoodWidth + std::max(x, 0)];
+		}
+	}
+	return sum;
+}
+
+bool R2000ScanMatcher::correlate(R2000MatchResult& result)
+{
+	if (!likelihoodValid) {
+		buildLikelihood();
+	}
+	if (likelihoodWidth == 0) {
+		return false;
+	}
+	
+	const float resolution = likelihoodCellSize;
+	const int window = (int)std::ceil(searchTranslation / resolution);
+	const int steps = (int)std::floor(searchAngle / searchAngleStep + 0.5f);
+	const int numAngles = 2 * steps + 1;
+	const size_t step = srcX.size() / CORRELATIVE_POINTS + 1;
+	
+	rotatedCells.resize(numAngles);
+	candidates.resize(numAngles);
+	
+	// coarse scores of every angle in parallel
+	pool.parallelFor(numAngles, [&](size_t a) {
+		const float theta = result.theta + ((int)a - steps) * searchAngleStep;
+		const float c = std::cos(theta);
+		const float s = std::sin(theta);
+		
+		std::vector<int>& cells = rotatedCells[a];
+		cells.clear();
+		for (size_t i=0; i<srcX.size(); i+=step) {
+			const float qx = c * srcX[i] - s * srcY[i] + result.x;
+			const float qy = s * srcX[i] + c * srcY[i] + result.y;
+			cells.push_back((int)std::floor((qx - likelihoodX) / resolution));
+			cells.push_back((int)std::floor((qy - likelihoodY) / resolution));
+		}
+		
+		std::vector<Candidate>& list = candidates[a];
+		list.clear();
+		for (int dy=-window; dy<=window; dy+=LIKELIHOOD_BLOCK) {
+			for (int dx=-window; dx<=window; dx+=LIKELIHOOD_BLOCK) {
+				Candidate candidate;
+				candidate.score = scoreCoarse(cells, dx, dy);
+				candidate.angle = (int)a;
+				candidate.dx = dx;
+				candidate.dy = dy;
+				list.push_back(candidate);
+			}
+		}
+	});
+	
+	sortedCandidates.clear();
+	for (int a=0; a<numAngles; a++) {
+		sortedCandidates.insert(sortedCandidates.end(), candidates[a].begin(), candidates[a].end());
+	}
+	std::sort(sortedCandidates.begin(), sortedCandidates.end());
+	
+	// refine the best coarse candidates until their bound is below the best full resolution score
+	uint32_t bestScore = 0;
+	int bestAngle = steps;
+	int bestX = 0;
+	int bestY = 0;
+	for (size_t i=0; i<sortedCandidates.size(); i++) {
+		const Candidate& candidate = sortedCandidates[i];
+		if (candidate.score <= bestScore) {
+			break;
+		}
+		
+		for (int dy=candidate.dy; dy<std::min(window + 1, candidate.dy + LIKELIHOOD_BLOCK); dy++) {
+			for (int dx=candidate.dx; dx<std::min(window + 1, candidate.dx + LIKELIHOOD_BLOCK); dx++) {
+				const uint32_t value = score(rotatedCells[candidate.angle], dx, dy, likelihood);
+				if (value > bestScore) {
+					bestScore = value;
+					bestAngle = candidate.angle;
+					bestX = dx;
+					bestY = dy;
+				}
+			}
+		}
+	}
+	
+	if (bestScore == 0) {
+		return false;
+	}
+	
+	result.x += bestX * resolution;
+	result.y += bestY * resolution;
+	result.theta = wrapAngle(result.theta + (bestAngle - steps) * searchAngleStep);
+	return true;
+}
+
+//--------------------------------------------------------------
+// odometry
+//--------------------------------------------------------------
+const Pose2D& R2000ScanMatcher::update(const ScanData& scan)
+{
+	converter.convert(scan, cloud);
+	return update(scan.distance_data.data(), std::min(scan.distance_data.size(), cloud.size()), scan.host_times.empty() ? 0 : scan.host_times.front());
+}
+
+const Pose2D& R2000ScanMatcher::update(const CompactScanData& scan)
+{
+	converter.convert(scan, cloud);
+	return update(scan.distance_data.data(), std::min(scan.distance_data.size(), cloud.size()), scan.info.host_time_first);
+}
+
+const Pose2D& R2000ScanMatcher::update(const uint32_t* distances, size_t count, int64_t time)
+{
+	pose.time = time;
+	
+	if (!hasReference()) {
+		setReference(distances, cloud, count);
+		return pose;
+	}
+	
+	lastResult = match(distances, cloud, count, motionX, motionY, motionTheta);
+	
+	// keep moving with the last motion if the match failed
+	if (lastResult.numPoints > 0 && lastResult.numInliers >= minInlierRatio * lastResult.numPoints) {
+		motionX = lastResult.x;
+		motionY = lastResult.y;
+		motionTheta = lastResult.theta;
+	}
+	
+	const float c = std::cos(pose.theta);
+	const float s = std::sin(pose.theta);
+	pose.x += c * motionX - s * motionY;
+	pose.y += s * motionX + c * motionY;
+	pose.theta = wrapAngle(pose.theta + motionTheta);
+	
+	setReference(distances, cloud, count);
+	return pose;
+}
+
+void R2000ScanMatcher::resetOdometry()
+{
+	pose.time = 0;
+	pose.x = 0;
+	pose.y = 0;
+	pose.theta = 0;
+	motionX = 0;
+	motionY = 0;
+	motionTheta = 0;
+	
+	lastResult.x = 0;
+	lastResult.y = 0;
+	lastResult.theta = 0;
+	lastResult.error = 0;
+	lastResult.numInliers = 0;
+	lastResult.numPoints = 0;
+	lastResult.iterations = 0;
+	lastResult.converged = false;
+	lastResult.correlative = false;
+	
+	refX.clear();
+	refY.clear();
+	refNx.clear();
+	refNy.clear();
+	likelihoodValid = false;
+}
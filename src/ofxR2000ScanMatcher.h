@@ -0,0 +1,202 @@
+//
+//  ofxR2000ScanMatcher.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// scan-to-scan matching (point-to-line ICP with correlative fallback) and laser odometry
+//
+
+#ifndef ofxR2000ScanMatcher_h
+#define ofxR2000ScanMatcher_h
+
+#include "ofMain.h"
+#include "compact_scan_data.h"
+#include "cartesian_converter.h"
+#include "scan_timing.h"
+#include "ofxR2000ThreadPool.h"
+
+using namespace pepperl_fuchs;
+
+// transform of the current scan into the frame of the reference scan: p_ref = R(theta) * p + (x, y)
+struct R2000MatchResult
+{
+	float x;
+	float y;
+	float theta;
+	
+	// rms point-to-line distance of the inliers, unit of the point cloud
+	float error;
+	
+	// points with a correspondence closer than the max correspondence distance
+	size_t numInliers;
+	size_t numPoints;
+	
+	int iterations;
+	
+	// ICP converged with at least the min inlier ratio
+	bool converged;
+	
+	// the correlative search was used to find the start pose
+	bool correlative;
+};
+
+// the reference scan is kept in a uniform grid with a cell size of the max correspondence distance,
+// built once per reference and used by all ICP iterations; the nearest neighbour is in the 3x3 cells around a point
+// line normals of the reference come from its neighbours in scan order
+// correspondences are searched in parallel chunks, each chunk sums its own normal equations
+// if ICP does not converge to enough inliers, a two-level branch-and-bound correlative search over
+// a likelihood grid of the reference finds a new start pose (the likelihood grid is built lazily, once per reference)
+class R2000ScanMatcher
+{
+public:
+	// numThreads: threads used for correspondence search, 0 uses all cores
+	R2000ScanMatcher(size_t numThreads = 0);
+	
+	// correspondences further away are ignored, unit of the point cloud
+	void setMaxCorrespondenceDistance(float distance);
+	float getMaxCorrespondenceDistance() const { return maxCorrespondence; };
+	
+	void setMaxIterations(int iterations) { maxIterations = iterations; };
+	
+	// stop once an update moves less than translation / rotation [rad]
+	void setConvergence(float translation, float rotation) { convergenceTranslation = translation; convergenceRotation = rotation; };
+	
+	// use every step-th valid point of the matched scan
+	void setPointStep(size_t step) { pointStep = std::max<size_t>(1, step); };
+	
+	// samples outside [minRange, maxRange] are ignored [mm]
+	void setRange(float minMm, float maxMm) { minRange = minMm; maxRange = maxMm; };
+	
+	// a match needs this share of inliers
+	void setMinInlierRatio(float ratio) { minInlierRatio = ratio; };
+	
+	// correlative search around the initial guess: +-translation (unit of the cloud), +-angle [deg]
+	void setCorrelativeFallback(bool enable) { correlativeFallback = enable; };
+	void setSearchWindow(float translation, float angleDegrees, float angleStepDegrees = 0.5f);
+	void setCorrelativeResolution(float cellSize);
+	
+	// cloud from CartesianConverter::convert() of the same scan
+	void setReference(const ScanData& scan, const PointCloud2D& cloud);
+	void setReference(const CompactScanData& scan, const PointCloud2D& cloud);
+	bool hasReference() const { return !refX.empty(); };
+	
+	// match against the reference, starting at the initial guess
+	R2000MatchResult match(const ScanData& scan, const PointCloud2D& cloud, float x = 0, float y = 0, float theta = 0);
+	R2000MatchResult match(const CompactScanData& scan, const PointCloud2D& cloud, float x = 0, float y = 0, float theta = 0);
+	
+	// odometry: match each scan against the previous one, starting with the last motion,
+	// and accumulate the pose of the scanner in the frame of the first scan
+	// scans are converted with getConverter(), its scale defines the unit
+	const Pose2D& update(const ScanData& scan);
+	const Pose2D& update(const CompactScanData& scan);
+	const Pose2D& getPose() const { return pose; };
+	const R2000MatchResult& getLastResult() const { return lastResult; };
+	void resetOdometry();
+	
+	CartesianConverter& getConverter() { return converter; };
+
+
+private:
+	// normal equations of the point-to-line error
+	struct Accumulator
+	{
+		double h[6];
+		double g[3];
+		double error;
+		size_t inliers;
+	};
+	
+	struct Candidate
+	{
+		uint32_t score;
+		int angle;
+		int dx;
+		int dy;
+		
+		bool operator<(const Candidate& other) const { return score > other.score; };
+	};
+	
+	void setReference(const uint32_t* distances, const PointCloud2D& cloud, size_t count);
+	R2000MatchResult match(const uint32_t* distances, const PointCloud2D& cloud, size_t count, float x, float y, float theta);
+	const Pose2D& update(const uint32_t* distances, size_t count, int64_t time);
+	
+	bool isValid(uint32_t distance) const { return distance != 0 && distance < INVALID_DISTANCE && distance >= minRange && distance <= maxRange; };
+	
+	void buildGrid();
+	bool icp(R2000MatchResult& result);
+	void accumulate(size_t begin, size_t end, float x, float y, float theta, float huber, Accumulator& acc) const;
+	
+	void buildLikelihood();
+	bool correlate(R2000MatchResult& result);
+	uint32_t score(const std::vector<int>& cells, int dx, int dy, const std::vector<uint8_t>& grid) const;
+	uint32_t scoreCoarse(const std::vector<int>& cells, int dx, int dy) const;
+	
+	float maxCorrespondence;
+	int maxIterations;
+	float convergenceTranslation;
+	float convergenceRotation;
+	size_t pointStep;
+	float minRange;
+	float maxRange;
+	float minInlierRatio;
+	
+	bool correlativeFallback;
+	float searchTranslation;
+	float searchAngle;
+	float searchAngleStep;
+	float likelihoodResolution;
+	
+	// reference points with a valid normal, sorted by grid cell
+	std::vector<float> refX;
+	std::vector<float> refY;
+	std::vector<float> refNx;
+	std::vector<float> refNy;
+	
+	// reference grid: points of cell i are [cellStart[i], cellStart[i + 1])
+	float gridX;
+	float gridY;
+	float gridScale;
+	int gridWidth;
+	int gridHeight;
+	std::vector<uint32_t> cellStart;
+	std::vector<uint32_t> cellOf;
+	
+	// unsorted reference points while building
+	std::vector<float> tmpX;
+	std::vector<float> tmpY;
+	std::vector<float> tmpNx;
+	std::vector<float> tmpNy;
+	
+	// likelihood grid of the reference and its max over blocks of LIKELIHOOD_BLOCK cells
+	static const int LIKELIHOOD_BLOCK = 8;
+	bool likelihoodValid;
+	float likelihoodX;
+	float likelihoodY;
+	float likelihoodCellSize;
+	int likelihoodWidth;
+	int likelihoodHeight;
+	std::vector<uint8_t> likelihood;
+	std::vector<uint8_t> likelihoodCoarse;
+	std::vector<std::vector<int> > rotatedCells;
+	std::vector<std::vector<Candidate> > candidates;
+	std::vector<Candidate> sortedCandidates;
+	
+	// points of the matched scan
+	std::vector<float> srcX;
+	std::vector<float> srcY;
+	std::vector<Accumulator> chunks;
+	
+	// odometry
+	CartesianConverter converter;
+	PointCloud2D cloud;
+	Pose2D pose;
+	float motionX;
+	float motionY;
+	float motionTheta;
+	R2000MatchResult lastResult;
+	
+	R2000ThreadPool pool;
+};
+
+#endif /* ofxR2000ScanMatcher_h */
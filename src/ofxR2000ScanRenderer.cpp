@@ -0,0 +1,178 @@
+//
+//  ofxR2000ScanRenderer.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// draws the current scan of R2000GpuStreams as points or instanced boxes, with level of detail
+//
+
+#include "ofxR2000ScanRenderer.h"
+
+#ifndef TARGET_OPENGLES
+
+
+static const char* rendererVertexShader =
+	"#version 150\n"
+	"uniform mat4 modelViewProjectionMatrix;\n"
+	"in vec4 position;\n"
+	"uniform usamplerBuffer texDist;\n"
+	"uniform usamplerBuffer texAmp;\n"
+	"uniform usamplerBuffer texPacked;\n"
+	"uniform int usePacked;\n"
+	"uniform int offset;\n"
+	"uniform int hasAmplitude;\n"
+	"uniform float first_angle;\n"
+	"uniform float angular_increment;\n"
+	"uniform int usePoints;\n"
+	"uniform int lodStep;\n"
+	"uniform float scale;\n"
+	"uniform float pointSize;\n"
+	"out vec4 vertexColor;\n"
+	"void main() {\n"
+	"	int id = (usePoints == 1 ? gl_VertexID : gl_InstanceID) * lodStep;\n"
+	"	uint dist;\n"
+	"	float amp;\n"
+	"	if (usePacked == 1) {\n"
+	"		uint word = texelFetch(texPacked, offset + id).r;\n"
+	"		dist = word & 0xFFFFFu;\n"
+	"		amp = float(word >> 20);\n"
+	"	} else {\n"
+	"		dist = texelFetch(texDist, offset + id).r;\n"
+	"		amp = float(texelFetch(texAmp, offset + id).r);\n"
+	"	}\n"
+	"	gl_PointSize = pointSize;\n"
+	"	// invalid samples are moved outside the clip volume\n"
+	"	if (dist == 0xFFFFFu) {\n"
+	"		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\n"
+	"		vertexColor = vec4(0.0);\n"
+	"		return;\n"
+	"	}\n"
+	"	float angle = first_angle + angular_increment * float(id);\n"
+	"	vec4 p = usePoints == 1 ? vec4(0.0, 0.0, 0.0, 1.0) : position;\n"
+	"	p.xy += vec2(cos(angle), sin(angle)) * float(dist) * scale;\n"
+	"	gl_Position = modelViewProjectionMatrix * p;\n"
+	"	// weak echoes red, opaque without amplitudes\n"
+	"	if (hasAmplitude == 0) {\n"
+	"		vertexColor = vec4(1.0, 1.0, 0.5, 1.0);\n"
+	"	} else {\n"
+	"		vertexColor = amp < 32.0 ? vec4(1.0, 0.0, 0.0, 1.0) : vec4(1.0, 1.0, 0.5, amp / 2047.0);\n"
+	"	}\n"
+	"}\n";
+
+static const char* rendererFragmentShader =
+	"#version 150\n"
+	"in vec4 vertexColor;\n"
+	"out vec4 outputColor;\n"
+	"void main() {\n"
+	"	outputColor = vertexColor;\n"
+	"}\n";
+
+
+R2000ScanRenderer::R2000ScanRenderer() :
+	allocated(false)
+	,mode(R2000_RENDER_POINTS)
+	,lodStep(1)
+	,pointBudget(0)
+	,scale(1.0)
+	,pointSize(2.0)
+	,vao(0)
+{
+}
+
+R2000ScanRenderer::~R2000ScanRenderer()
+{
+	clear();
+}
+
+bool R2000ScanRenderer::setup(float boxSize)
+{
+	clear();
+
+	if (!shader.setupShaderFromSource(GL_VERTEX_SHADER, rendererVertexShader) ||
+		!shader.setupShaderFromSource(GL_FRAGMENT_SHADER, rendererFragmentShader))
+	{
+		ofLogError("R2000ScanRenderer") << "compiling the shader failed";
+		clear();
+		return false;
+	}
+	shader.bindDefaults();
+	if (!shader.linkProgram()) {
+		ofLogError("R2000ScanRenderer") << "linking the shader failed";
+		clear();
+		return false;
+	}
+
+	box = ofMesh::box(boxSize, boxSize, boxSize, 1, 1, 1);
+	box.setUsage(GL_STATIC_DRAW);
+
+	glGenVertexArrays(1, &vao);
+
+	allocated = true;
+	return true;
+}
+
+void R2000ScanRenderer::clear()
+{
+	if (vao) {
+		glDeleteVertexArrays(1, &vao);
+		vao = 0;
+	}
+
+	if (shader.isLoaded()) {
+		shader.unload();
+	}
+
+	box.clear();
+	allocated = false;
+}
+
+int R2000ScanRenderer::getStep(size_t numSamples) const
+{
+	if (pointBudget == 0 || numSamples <= pointBudget) {
+		return lodStep;
+	}
+	return std::max(lodStep, (int)((numSamples + pointBudget - 1) / pointBudget));
+}
+
+size_t R2000ScanRenderer::getNumDrawn(size_t numSamples) const
+{
+	const size_t step = getStep(numSamples);
+	return (numSamples + step - 1) / step;
+}
+
+void R2000ScanRenderer::draw(const R2000GpuStream& stream)
+{
+	draw(stream, shader);
+}
+
+void R2000ScanRenderer::draw(const R2000GpuStream& stream, ofShader& s)
+{
+	const size_t numSamples = stream.getNumSamples();
+	if (!allocated || numSamples == 0) {
+		return;
+	}
+
+	const size_t count = getNumDrawn(numSamples);
+
+	s.begin();
+	stream.setUniforms(s);
+	s.setUniform1i("usePoints", mode == R2000_RENDER_POINTS ? 1 : 0);
+	s.setUniform1i("lodStep", getStep(numSamples));
+	s.setUniform1f("scale", scale);
+	s.setUniform1f("pointSize", pointSize);
+
+	if (mode == R2000_RENDER_POINTS) {
+		glEnable(GL_PROGRAM_POINT_SIZE);
+		glBindVertexArray(vao);
+		glDrawArrays(GL_POINTS, 0, (GLsizei)count);
+		glBindVertexArray(0);
+		glDisable(GL_PROGRAM_POINT_SIZE);
+	} else {
+		box.drawInstanced(OF_MESH_FILL, count);
+	}
+
+	s.end();
+}
+
+#endif
@@ -0,0 +1,98 @@
+//
+//  ofxR2000ScanRenderer.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// draws the current scan of R2000GpuStreams as points or instanced boxes, with level of detail
+//
+
+#ifndef ofxR2000ScanRenderer_h
+#define ofxR2000ScanRenderer_h
+
+#include "ofMain.h"
+#include "ofxR2000GpuStream.h"
+
+using namespace pepperl_fuchs;
+
+// needs buffer textures and instancing, not available with OpenGL ES
+#ifndef TARGET_OPENGLES
+
+enum R2000RenderMode {
+	R2000_RENDER_POINTS,	// one GL_POINTS vertex per sample without vertex attributes, gl_VertexID is the sample
+	R2000_RENDER_BOXES		// one instance of the box mesh per sample, gl_InstanceID is the sample
+};
+
+// one renderer draws any number of streams, e.g. one per scanner, with the current matrices:
+//	ofPushMatrix();
+//	ofTranslate(scannerPosition);
+//	renderer.draw(stream);
+//	ofPopMatrix();
+//
+// level of detail draws every lodStep-th sample, lodStep is the larger of setLodStep() and the step keeping
+// a scan within the point budget, so the cost per scanner stays bounded for any number of samples per scan
+//
+// the built-in shader colors samples like example_gl, own shaders get the uniforms of R2000GpuStream::setUniforms() and
+//	uniform int usePoints;	// 1 with R2000_RENDER_POINTS
+//	uniform int lodStep;
+//	uniform float scale;
+//	uniform float pointSize;
+//	int id = (usePoints == 1 ? gl_VertexID : gl_InstanceID) * lodStep;
+// with R2000_RENDER_POINTS no vertex attributes are set, position has to be replaced by vec4(0.0, 0.0, 0.0, 1.0)
+class R2000ScanRenderer
+{
+public:
+	R2000ScanRenderer();
+	~R2000ScanRenderer();
+
+	// compile the built-in shader and create the box mesh, size of a box in world units
+	bool setup(float boxSize = 1.0);
+	void clear();
+
+	void setMode(R2000RenderMode m) { mode = m; };
+	R2000RenderMode getMode() const { return mode; };
+
+	// draw every step-th sample at least
+	void setLodStep(int step) { lodStep = std::max(1, step); };
+	int getLodStep() const { return lodStep; };
+
+	// samples drawn per scan at most, 0 for no limit
+	void setPointBudget(size_t points) { pointBudget = points; };
+	size_t getPointBudget() const { return pointBudget; };
+
+	// world units per mm
+	void setScale(float s) { scale = s; };
+	float getScale() const { return scale; };
+
+	// point size in pixels with R2000_RENDER_POINTS
+	void setPointSize(float size) { pointSize = size; };
+	float getPointSize() const { return pointSize; };
+
+	// step and number of samples drawn for a scan of numSamples samples
+	int getStep(size_t numSamples) const;
+	size_t getNumDrawn(size_t numSamples) const;
+
+	// draw the current scan of the stream with the built-in shader
+	void draw(const R2000GpuStream& stream);
+
+	// draw with an own shader, e.g. the one of example_gl
+	void draw(const R2000GpuStream& stream, ofShader& shader);
+
+private:
+	bool allocated;
+	R2000RenderMode mode;
+	int lodStep;
+	size_t pointBudget;
+	float scale;
+	float pointSize;
+
+	ofShader shader;
+	ofVboMesh box;
+
+	// attributeless drawing still needs a vertex array object with a core profile
+	GLuint vao;
+};
+
+#endif
+
+#endif /* ofxR2000ScanRenderer_h */
@@ -0,0 +1,117 @@
+//
+//  ofxR2000Segmenter.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// linear-time segmentation of angularly ordered scan points
+//
+
+#include "ofxR2000Segmenter.h"
+
+
+R2000Segmenter::R2000Segmenter() :
+	jumpThreshold(100.0f)
+	,relativeJump(0.05f)
+	,maxGap(2)
+	,minPoints(3)
+{}
+
+void R2000Segmenter::closeSegment(R2000Segment& s, const float* x, const float* y)
+{
+	if (s.numPoints < minPoints) {
+		return;
+	}
+	
+	s.x /= s.numPoints;
+	s.y /= s.numPoints;
+	
+	const float dx = x[s.last] - x[s.first];
+	const float dy = y[s.last] - y[s.first];
+	s.width = std::sqrt(dx * dx + dy * dy);
+	
+	segments.push_back(s);
+}
+
+const std::vector<R2000Segment>& R2000Segmenter::segment(const uint32_t* distances, const float* x, const float* y, size_t count, const uint8_t* mask)
+{
+	segments.clear();
+	
+	R2000Segment s;
+	bool open = false;
+	size_t gap = 0;
+	float lastDistance = 0.0f;
+	
+	for (size_t i=0; i<count; i++) {
+		
+		const uint32_t raw = distances[i];
+		const bool valid = raw > 0 && raw < INVALID_DISTANCE && (!mask || mask[i]);
+		
+		if (!valid) {
+			// too many missing samples end the segment
+			if (open && ++gap > maxGap) {
+				closeSegment(s, x, y);
+				open = false;
+			}
+			continue;
+		}
+		
+		const float d = (float)raw;
+		
+		if (open && std::abs(d - lastDistance) > std::max(jumpThreshold, relativeJump * d)) {
+			closeSegment(s, x, y);
+			open = false;
+		}
+		
+		if (!open) {
+			s.first = i;
+			s.numPoints = 0;
+			s.x = 0.0f;
+			s.y = 0.0f;
+			s.minDistance = d;
+			open = true;
+		}
+		
+		s.last = i;
+		s.numPoints++;
+		s.x += x[i];
+		s.y += y[i];
+		s.minDistance = std::min(s.minDistance, d);
+		
+		lastDistance = d;
+		gap = 0;
+	}
+	
+	if (open) {
+		closeSegment(s, x, y);
+	}
+	
+	return segments;
+}
+
+const std::vector<R2000Segment>& R2000Segmenter::segment(const ScanData& scan, const PointCloud2D& cloud)
+{
+	const size_t count = std::min(scan.distance_data.size(), cloud.size());
+	if (count == 0) {
+		segments.clear();
+		return segments;
+	}
+	
+	return segment(scan.distance_data.data(), cloud.x.data(), cloud.y.data(), count);
+}
+
+const std::vector<R2000Segment>& R2000Segmenter::segment(const CompactScanData& scan, const PointCloud2D& cloud, const std::vector<uint8_t>* foregroundMask)
+{
+	const size_t count = std::min(scan.distance_data.size(), cloud.size());
+	if (count == 0) {
+		segments.clear();
+		return segments;
+	}
+	
+	const uint8_t* mask = nullptr;
+	if (foregroundMask && foregroundMask->size() >= count) {
+		mask = foregroundMask->data();
+	}
+	
+	return segment(scan.distance_data.data(), cloud.x.data(), cloud.y.data(), count, mask);
+}
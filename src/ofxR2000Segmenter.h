@@ -0,0 +1,83 @@
+//
+//  ofxR2000Segmenter.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// linear-time segmentation of angularly ordered scan points
+//
+
+#ifndef ofxR2000Segmenter_h
+#define ofxR2000Segmenter_h
+
+#include "ofMain.h"
+#include "compact_scan_data.h"
+#include "cartesian_converter.h"
+
+using namespace pepperl_fuchs;
+
+// consecutive points of one object
+struct R2000Segment
+{
+	// sample range in the input arrays
+	size_t first;
+	size_t last;
+	size_t numPoints;
+	
+	// centroid, unit of the point cloud
+	float x;
+	float y;
+	
+	// distance between the end points, unit of the point cloud
+	float width;
+	
+	// closest distance in millimeter
+	float minDistance;
+};
+
+// splits ordered scan points where the distance jumps or where too many samples are missing
+// one pass over the samples, no allocations once the segment vector has grown
+class R2000Segmenter
+{
+public:
+	R2000Segmenter();
+	
+	// neighbours belong to the same segment if their distances differ by less than
+	// max(jumpThreshold, relativeJump * distance) [mm]
+	void setJumpThreshold(float mm) { jumpThreshold = mm; };
+	float getJumpThreshold() const { return jumpThreshold; };
+	void setRelativeJump(float factor) { relativeJump = factor; };
+	float getRelativeJump() const { return relativeJump; };
+	
+	// invalid or masked samples bridged inside a segment
+	void setMaxGap(size_t samples) { maxGap = samples; };
+	size_t getMaxGap() const { return maxGap; };
+	
+	// smaller segments are dropped
+	void setMinPoints(size_t numPoints) { minPoints = numPoints; };
+	size_t getMinPoints() const { return minPoints; };
+	
+	// distances [mm] and cartesian points in the same sample order
+	// mask: optional, only samples with a non-zero mask value are used (e.g. R2000BackgroundModel::getForegroundMask())
+	const std::vector<R2000Segment>& segment(const uint32_t* distances, const float* x, const float* y, size_t count, const uint8_t* mask = nullptr);
+	
+	// cloud from CartesianConverter::convert() of the same scan
+	const std::vector<R2000Segment>& segment(const ScanData& scan, const PointCloud2D& cloud);
+	// foregroundMask: optional per beam mask
+	const std::vector<R2000Segment>& segment(const CompactScanData& scan, const PointCloud2D& cloud, const std::vector<uint8_t>* foregroundMask = nullptr);
+	
+	const std::vector<R2000Segment>& getSegments() const { return segments; };
+	
+	
+private:
+	void closeSegment(R2000Segment& s, const float* x, const float* y);
+	
+	float jumpThreshold;
+	float relativeJump;
+	size_t maxGap;
+	size_t minPoints;
+	
+	std::vector<R2000Segment> segments;
+};
+
+#endif /* ofxR2000Segmenter_h */
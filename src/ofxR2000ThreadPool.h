@@ -0,0 +1,140 @@
+//
+//  ofxR2000ThreadPool.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// small fixed-size thread pool for the processing stages of the addon
+//
+
+#ifndef ofxR2000ThreadPool_h
+#define ofxR2000ThreadPool_h
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+class R2000ThreadPool
+{
+public:
+	// numThreads: total number of threads including the calling thread, 0 uses all cores
+	R2000ThreadPool(size_t numThreads = 0) :
+		job(nullptr)
+		,jobCount(0)
+		,nextIndex(0)
+		,activeWorkers(0)
+		,generation(0)
+		,stopping(false)
+	{
+		if (numThreads == 0) {
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		
+		// the calling thread works as well
+		for (size_t i=1; i<numThreads; i++) {
+			workers.emplace_back(&R2000ThreadPool::workerLoop, this);
+		}
+	}
+	
+	~R2000ThreadPool()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		startCondition.notify_all();
+		
+		for (size_t i=0; i<workers.size(); i++) {
+			workers[i].join();
+		}
+	}
+	
+	size_t getNumThreads() const { return workers.size() + 1; }
+	
+	// run job(i) for every i in [0, count) on the pool and the calling thread
+	// returns when all jobs are done, calls from several threads are serialized
+	void parallelFor(size_t count, const std::function<void(size_t)>& fn)
+	{
+		if (count == 0) {
+			return;
+		}
+		
+		std::unique_lock<std::mutex> callLock(callMutex);
+		
+		if (workers.empty() || count == 1) {
+			for (size_t i=0; i<count; i++) {
+				fn(i);
+			}
+			return;
+		}
+		
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			job = &fn;
+			jobCount = count;
+			nextIndex = 0;
+			activeWorkers = workers.size();
+			generation++;
+		}
+		startCondition.notify_all();
+		
+		runJobs();
+		
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [this]{ return activeWorkers == 0; });
+		job = nullptr;
+	}
+	
+private:
+	void runJobs()
+	{
+		size_t i;
+		while ((i = nextIndex.fetch_add(1)) < jobCount) {
+			(*job)(i);
+		}
+	}
+	
+	void workerLoop()
+	{
+		uint64_t seen = 0;
+		
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				startCondition.wait(lock, [&]{ return stopping || generation != seen; });
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+			}
+			
+			runJobs();
+			
+			std::unique_lock<std::mutex> lock(mutex);
+			if (--activeWorkers == 0) {
+				doneCondition.notify_one();
+			}
+		}
+	}
+	
+	std::vector<std::thread> workers;
+	
+	std::mutex callMutex;
+	std::mutex mutex;
+	std::condition_variable startCondition;
+	std::condition_variable doneCondition;
+	
+	const std::function<void(size_t)>* job;
+	size_t jobCount;
+	std::atomic<size_t> nextIndex;
+	size_t activeWorkers;
+	uint64_t generation;
+	bool stopping;
+};
+
+#endif /* ofxR2000ThreadPool_h */
@@ -0,0 +1,275 @@
+//
+//  ofxR2000Tracker.cpp
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// multi-object tracking of scan segments with constant-velocity kalman filters
+//
+
+#include "ofxR2000Tracker.h"
+
+#include <limits>
+
+// cost of an assignment outside the gate
+static const double NO_MATCH = 1e9;
+
+
+R2000Tracker::R2000Tracker() :
+	gate(500.0f)
+	,processNoise(2000.0f)
+	,measurementNoise(30.0f)
+	,minHits(3)
+	,maxMissed(5)
+	,nextId(0)
+	,lastTime(0)
+	,hasTime(false)
+{}
+
+void R2000Tracker::reset()
+{
+	tracks.clear();
+	hasTime = false;
+}
+
+void R2000Tracker::predict(R2000Track& t, float dt)
+{
+	t.x += t.vx * dt;
+	t.y += t.vy * dt;
+	
+	// P = F P F^T + Q with F = [I dt*I; 0 I]
+	float* P = t.covariance;
+	float FP[16];
+	for (int c=0; c<4; c++) {
+		FP[0 * 4 + c] = P[0 * 4 + c] + dt * P[2 * 4 + c];
+		FP[1 * 4 + c] = P[1 * 4 + c] + dt * P[3 * 4 + c];
+		FP[2 * 4 + c] = P[2 * 4 + c];
+		FP[3 * 4 + c] = P[3 * 4 + c];
+	}
+	for (int r=0; r<4; r++) {
+		P[r * 4 + 0] = FP[r * 4 + 0] + dt * FP[r * 4 + 2];
+		P[r * 4 + 1] = FP[r * 4 + 1] + dt * FP[r * 4 + 3];
+		P[r * 4 + 2] = FP[r * 4 + 2];
+		P[r * 4 + 3] = FP[r * 4 + 3];
+	}
+	
+	// white noise acceleration
+	const float q = processNoise * processNoise;
+	const float dt2 = dt * dt;
+	const float pp = q * dt2 * dt2 / 4.0f;
+	const float pv = q * dt2 * dt / 2.0f;
+	const float vv = q * dt2;
+	P[0 * 4 + 0] += pp; P[0 * 4 + 2] += pv; P[2 * 4 + 0] += pv; P[2 * 4 + 2] += vv;
+	P[1 * 4 + 1] += pp; P[1 * 4 + 3] += pv; P[3 * 4 + 1] += pv; P[3 * 4 + 3] += vv;
+}
+
+void R2000Tracker::correct(R2000Track& t, const ofVec2f& z)
+{
+	float* P = t.covariance;
+	
+	// S = H P H^T + R, H selects the position
+	const float r = measurementNoise * measurementNoise;
+	const float s00 = P[0] + r;
+	const float s01 = P[1];
+	const float s10 = P[4];
+	const float s11 = P[5] + r;
+	const float det = s00 * s11 - s01 * s10;
+	if (std::abs(det) < 1e-12f) {
+		return;
+	}
+	const float i00 = s11 / det;
+	const float i01 = -s01 / det;
+	const float i10 = -s10 / det;
+	const float i11 = s00 / det;
+	
+	// K = P H^T S^-1
+	float K[8];
+	for (int row=0; row<4; row++) {
+		const float p0 = P[row * 4 + 0];
+		const float p1 = P[row * 4 + 1];
+		K[row * 2 + 0] = p0 * i00 + p1 * i10;
+		K[row * 2 + 1] = p0 * i01 + p1 * i11;
+	}
+	
+	const float yx = z.x - t.x;
+	const float yy = z.y - t.y;
+	t.x += K[0] * yx + K[1] * yy;
+	t.y += K[2] * yx + K[3] * yy;
+	t.vx += K[4] * yx + K[5] * yy;
+	t.vy += K[6] * yx + K[7] * yy;
+	
+	// P = (I - K H) P
+	float HP[8];
+	for (int c=0; c<4; c++) {
+		HP[0 * 4 + c] = P[0 * 4 + c];
+		HP[1 * 4 + c] = P[1 * 4 + c];
+	}
+	for (int row=0; row<4; row++) {
+		for (int c=0; c<4; c++) {
+			P[row * 4 + c] -= K[row * 2 + 0] * HP[0 * 4 + c] + K[row * 2 + 1] * HP[1 * 4 + c];
+		}
+	}
+}
+
+void R2000Tracker::assign(size_t numTracks, size_t numDetections)
+{
+	// hungarian method (shortest augmenting path, O(n^3)) on the square matrix padded with NO_MATCH
+	const size_t n = std::max(numTracks, numDetections);
+	const double inf = std::numeric_limits<double>::max();
+	
+	u.assign(n + 1, 0.0);
+	v.assign(n + 1, 0.0);
+	p.assign(n + 1, 0);
+	way.assign(n + 1, 0);
+	
+	for (size_t i=1; i<=n; i++) {
+		p[0] = (int)i;
+		size_t j0 = 0;
+		minv.assign(n + 1, inf);
+		used.assign(n + 1, 0);
+		
+		do {
+			used[j0] = 1;
+			const size_t i0 = p[j0];
+			double delta = inf;
+			size_t j1 = 0;
+			
+			for (size_t j=1; j<=n; j++) {
+				if (used[j]) {
+					continue;
+				}
+				const double c = (i0 <= numTracks && j <= numDetections) ? cost[(i0 - 1) * numDetections + (j - 1)] : NO_MATCH;
+				const double cur = c - u[i0] - v[j];
+				if (cur < minv[j]) {
+					minv[j] = cur;
+					way[j] = (int)j0;
+				}
+				if (minv[j] < delta) {
+					delta = minv[j];
+					j1 = j;
+				}
+			}
+			
+			for (size_t j=0; j<=n; j++) {
+				if (used[j]) {
+					u[p[j]] += delta;
+					v[j] -= delta;
+				} else {
+					minv[j] -= delta;
+				}
+			}
+			j0 = j1;
+		} while (p[j0] != 0);
+		
+		do {
+			const size_t j1 = way[j0];
+			p[j0] = p[j1];
+			j0 = j1;
+		} while (j0);
+	}
+	
+	// detection per track, gated
+	assignment.assign(numTracks, -1);
+	for (size_t j=1; j<=n; j++) {
+		const size_t i = p[j];
+		if (i >= 1 && i <= numTracks && j <= numDetections && cost[(i - 1) * numDetections + (j - 1)] < NO_MATCH) {
+			assignment[i - 1] = (int)(j - 1);
+		}
+	}
+}
+
+void R2000Tracker::update(const std::vector<R2000Segment>& segments, double time)
+{
+	points.resize(segments.size());
+	for (size_t i=0; i<segments.size(); i++) {
+		points[i].x = segments[i].x;
+		points[i].y = segments[i].y;
+	}
+	
+	update(points, time);
+}
+
+void R2000Tracker::update(const std::vector<ofVec2f>& detections, double time)
+{
+	const float dt = hasTime ? (float)std::max(0.0, time - lastTime) : 0.0f;
+	lastTime = time;
+	hasTime = true;
+	
+	for (size_t i=0; i<tracks.size(); i++) {
+		predict(tracks[i], dt);
+		tracks[i].detection = -1;
+	}
+	
+	const size_t numTracks = tracks.size();
+	const size_t numDetections = detections.size();
+	
+	if (numTracks > 0 && numDetections > 0) {
+		cost.resize(numTracks * numDetections);
+		for (size_t i=0; i<numTracks; i++) {
+			for (size_t j=0; j<numDetections; j++) {
+				const float dx = detections[j].x - tracks[i].x;
+				const float dy = detections[j].y - tracks[i].y;
+				const float d = std::sqrt(dx * dx + dy * dy);
+				cost[i * numDetections + j] = d <= gate ? d : NO_MATCH;
+			}
+		}
+		assign(numTracks, numDetections);
+	} else {
+		assignment.assign(numTracks, -1);
+	}
+	
+	used.assign(numDetections, 0);
+	
+	for (size_t i=0; i<numTracks; i++) {
+		R2000Track& t = tracks[i];
+		t.age++;
+		
+		if (assignment[i] >= 0) {
+			correct(t, detections[assignment[i]]);
+			t.detection = assignment[i];
+			t.hits++;
+			t.missed = 0;
+			t.confirmed = t.confirmed || t.hits >= minHits;
+			used[assignment[i]] = 1;
+		} else {
+			t.missed++;
+		}
+	}
+	
+	// drop lost tracks
+	size_t k = 0;
+	for (size_t i=0; i<tracks.size(); i++) {
+		if (tracks[i].missed <= maxMissed) {
+			tracks[k++] = tracks[i];
+		}
+	}
+	tracks.resize(k);
+	
+	// new tracks for unassigned detections
+	const float r = measurementNoise * measurementNoise;
+	const float velocityVariance = gate * gate;
+	for (size_t j=0; j<numDetections; j++) {
+		if (used[j]) {
+			continue;
+		}
+		
+		R2000Track t;
+		t.id = nextId++;
+		t.x = detections[j].x;
+		t.y = detections[j].y;
+		t.vx = 0.0f;
+		t.vy = 0.0f;
+		std::fill(t.covariance, t.covariance + 16, 0.0f);
+		t.covariance[0] = r;
+		t.covariance[5] = r;
+		t.covariance[10] = velocityVariance;
+		t.covariance[15] = velocityVariance;
+		t.age = 1;
+		t.hits = 1;
+		t.missed = 0;
+		t.confirmed = minHits <= 1;
+		t.detection = (int)j;
+		
+		tracks.push_back(t);
+	}
+}
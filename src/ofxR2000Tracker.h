@@ -0,0 +1,95 @@
+//
+//  ofxR2000Tracker.h
+//  ofxR2000
+//
+// https://github.com/i-n-g-o/ofxR2000
+//
+// multi-object tracking of scan segments with constant-velocity kalman filters
+//
+
+#ifndef ofxR2000Tracker_h
+#define ofxR2000Tracker_h
+
+#include "ofMain.h"
+#include "ofxR2000Segmenter.h"
+
+struct R2000Track
+{
+	int id;
+	
+	// filtered state, unit of the detections and unit per second
+	float x;
+	float y;
+	float vx;
+	float vy;
+	
+	// state covariance, row-major 4x4 (x, y, vx, vy)
+	float covariance[16];
+	
+	// scans since the track was created / with a detection / without a detection
+	int age;
+	int hits;
+	int missed;
+	
+	// enough hits to be reported as an object
+	bool confirmed;
+	
+	// index of the assigned detection in the last update, -1 if none
+	int detection;
+};
+
+// assigns detections to tracks with the hungarian method on gated distances
+// and filters every track with a constant-velocity kalman filter
+class R2000Tracker
+{
+public:
+	R2000Tracker();
+	
+	// detections further away from the predicted position are never assigned [unit of the detections]
+	void setGate(float distance) { gate = distance; };
+	float getGate() const { return gate; };
+	
+	// standard deviation of the acceleration [unit/s^2] and of the measured position [unit]
+	void setProcessNoise(float acceleration) { processNoise = acceleration; };
+	void setMeasurementNoise(float position) { measurementNoise = position; };
+	
+	// hits until a track is confirmed, missed scans until it is removed
+	void setMinHits(int hits) { minHits = hits; };
+	void setMaxMissed(int missed) { maxMissed = missed; };
+	
+	// time: seconds, e.g. host time of the scan / 1e6
+	void update(const std::vector<ofVec2f>& detections, double time);
+	void update(const std::vector<R2000Segment>& segments, double time);
+	
+	void reset();
+	
+	// all tracks, including unconfirmed ones
+	const std::vector<R2000Track>& getTracks() const { return tracks; };
+	
+	
+private:
+	void predict(R2000Track& t, float dt);
+	void correct(R2000Track& t, const ofVec2f& z);
+	void assign(size_t numTracks, size_t numDetections);
+	
+	float gate;
+	float processNoise;
+	float measurementNoise;
+	int minHits;
+	int maxMissed;
+	
+	std::vector<R2000Track> tracks;
+	int nextId;
+	double lastTime;
+	bool hasTime;
+	
+	// reused buffers
+	std::vector<ofVec2f> points;
+	std::vector<double> cost;
+	std::vector<int> assignment;
+	std::vector<double> u, v, minv;
+	std::vector<int> p, way;
+	std::vector<uint8_t> used;
+};
+
+#endif /* ofxR2000Tracker_h */
@@ -0,0 +1,89 @@
+//
+//  aligned_allocator.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	allocator for std::vector with aligned storage,
+//	so sample arrays start at SIMD friendly addresses
+//
+
+#ifndef ALIGNED_ALLOCATOR_H
+#define ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+	#include <malloc.h>
+#endif
+
+namespace pepperl_fuchs {
+
+//! \class AlignedAllocator
+//! \brief Allocates memory aligned to Alignment bytes (a power of two, at least sizeof(void*))
+template<class T, std::size_t Alignment = 32>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template<class U>
+    struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() throw() {}
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) throw() {}
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(size_type n, const void* = 0)
+    {
+        if( n == 0 )
+            return 0;
+
+        void* p = 0;
+#ifdef _WIN32
+        p = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+        if( posix_memalign(&p, Alignment, n * sizeof(T)) != 0 )
+            p = 0;
+#endif
+        if( !p )
+            throw std::bad_alloc();
+
+        return static_cast<pointer>(p);
+    }
+
+    void deallocate(pointer p, size_type)
+    {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+    size_type max_size() const throw() { return size_type(-1) / sizeof(T); }
+
+    void construct(pointer p, const T& value) { new((void*)p) T(value); }
+    void destroy(pointer p) { p->~T(); }
+};
+
+template<class T, class U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return true; }
+
+template<class T, class U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return false; }
+
+}
+#endif // ALIGNED_ALLOCATOR_H
@@ -0,0 +1,179 @@
+//
+//  cartesian_converter.cpp
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	conversion of polar scan data to cartesian coordinates
+//	using cached sin/cos tables per scan configuration
+//
+
+#include "cartesian_converter.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace pepperl_fuchs {
+
+//-----------------------------------------------------------------------------
+bool CartesianConverter::TableKey::operator<(const TableKey& other) const
+{
+    if( num_points_scan != other.num_points_scan )
+        return num_points_scan < other.num_points_scan;
+    if( start_angle != other.start_angle )
+        return start_angle < other.start_angle;
+    return angular_increment < other.angular_increment;
+}
+
+//-----------------------------------------------------------------------------
+bool CartesianConverter::TableKey::operator==(const TableKey& other) const
+{
+    return num_points_scan == other.num_points_scan
+        && start_angle == other.start_angle
+        && angular_increment == other.angular_increment;
+}
+
+//-----------------------------------------------------------------------------
+CartesianConverter::CartesianConverter(float scale) :
+    scale_(scale)
+    ,tables_()
+    ,last_table_(0)
+{
+    last_key_.num_points_scan = 0;
+    last_key_.start_angle = 0;
+    last_key_.angular_increment = 0;
+}
+
+//-----------------------------------------------------------------------------
+void CartesianConverter::setScale(float scale)
+{
+    scale_ = scale;
+    clearTables();
+}
+
+//-----------------------------------------------------------------------------
+void CartesianConverter::clearTables()
+{
+    tables_.clear();
+    last_table_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+const AngleTable& CartesianConverter::getTable(int num_points_scan, int32_t start_angle, int32_t angular_increment)
+{
+    TableKey key;
+    key.num_points_scan = num_points_scan;
+    key.start_angle = start_angle;
+    key.angular_increment = angular_increment;
+
+    if( last_table_ && key == last_key_ )
+        return *last_table_;
+
+    std::map<TableKey, AngleTable>::iterator it = tables_.find(key);
+    if( it == tables_.end() )
+    {
+        AngleTable& table = tables_[key];
+        table.num_points_scan = num_points_scan;
+        table.start_angle = start_angle;
+        table.angular_increment = angular_increment;
+        table.cos_table.resize(num_points_scan);
+        table.sin_table.resize(num_points_scan);
+
+        // 1/10000° to radians
+        const double to_rad = PI_D / 1800000.0;
+        for( int i=0; i<num_points_scan; i++ )
+        {
+            const double angle = (start_angle + (double)i * angular_increment) * to_rad;
+            table.cos_table[i] = (float)(scale_ * std::cos(angle));
+            table.sin_table[i] = (float)(scale_ * std::sin(angle));
+        }
+
+        it = tables_.find(key);
+    }
+
+    last_key_ = key;
+    last_table_ = &it->second;
+    return it->second;
+}
+
+//-----------------------------------------------------------------------------
+const AngleTable& CartesianConverter::getTable(const PacketHeader& header)
+{
+    // angle of sample index 0
+    const int32_t start_angle = header.first_angle - (int32_t)header.first_index * header.angular_increment;
+    return getTable(header.num_points_scan, start_angle, header.angular_increment);
+}
+
+//-----------------------------------------------------------------------------
+void CartesianConverter::convert(const uint32_t* distances, std::size_t count, const AngleTable& table, std::size_t first_index, float* x, float* y)
+{
+    // never read behind the table, even for broken headers
+    if( first_index >= table.cos_table.size() )
+        return;
+    count = std::min(count, table.cos_table.size() - first_index);
+
+    const float* c = &table.cos_table[first_index];
+    const float* s = &table.sin_table[first_index];
+
+    // plain loop over contiguous arrays, gets vectorized by the compiler
+    for( std::size_t i=0; i<count; i++ )
+    {
+        // masking the integer keeps the loop vectorized
+        const uint32_t distance = distances[i];
+        const float d = (float)(distance & (0u - (uint32_t)(distance < INVALID_DISTANCE)));
+        x[i] = d * c[i];
+        y[i] = d * s[i];
+    }
+}
+
+//-----------------------------------------------------------------------------
+void CartesianConverter::convert(const ScanData& scan, PointCloud2D& cloud)
+{
+    cloud.x.resize(scan.distance_data.size());
+    cloud.y.resize(scan.distance_data.size());
+
+    // every packet covers num_points_packet samples starting at first_index,
+    // this also holds for scans with lost packets
+    std::size_t offset = 0;
+    for( std::size_t h=0; h<scan.headers.size(); h++ )
+    {
+        const PacketHeader& header = scan.headers[h];
+        const AngleTable& table = getTable(header);
+
+        std::size_t count = std::min((std::size_t)header.num_points_packet, scan.distance_data.size() - offset);
+        if( count == 0 )
+            break;
+
+        convert(&scan.distance_data[offset], count, table, header.first_index, &cloud.x[offset], &cloud.y[offset]);
+
+        // samples of broken headers pointing behind the table
+        const std::size_t valid = header.first_index < table.cos_table.size() ? std::min(count, table.cos_table.size() - header.first_index) : 0;
+        if( valid < count )
+        {
+            std::fill(cloud.x.begin() + offset + valid, cloud.x.begin() + offset + count, 0.0f);
+            std::fill(cloud.y.begin() + offset + valid, cloud.y.begin() + offset + count, 0.0f);
+        }
+
+        offset += count;
+    }
+
+    // samples without header
+    cloud.x.resize(offset);
+    cloud.y.resize(offset);
+}
+
+//-----------------------------------------------------------------------------
+void CartesianConverter::convert(const CompactScanData& scan, PointCloud2D& cloud)
+{
+    const std::size_t count = std::min(scan.distance_data.size(), (std::size_t)scan.info.num_points_scan);
+    cloud.x.resize(count);
+    cloud.y.resize(count);
+
+    if( count == 0 )
+        return;
+
+    const AngleTable& table = getTable(scan.info.num_points_scan, scan.info.start_angle, scan.info.angular_increment);
+    convert(&scan.distance_data[0], count, table, 0, &cloud.x[0], &cloud.y[0]);
+}
+
+}
@@ -0,0 +1,130 @@
+//
+//  cartesian_converter.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	conversion of polar scan data to cartesian coordinates
+//	using cached sin/cos tables per scan configuration
+//
+
+#ifndef CARTESIAN_CONVERTER_H
+#define CARTESIAN_CONVERTER_H
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+
+#include "compact_scan_data.h"
+
+namespace pepperl_fuchs {
+
+//! Pi, M_PI is not part of standard C++
+static const double PI_D = 3.14159265358979323846;
+
+//! \struct PointCloud2D
+//! \brief Cartesian points of a scan as structure of arrays
+struct PointCloud2D
+{
+    //! X coordinates, scaled distance * cos(angle)
+    std::vector<float> x;
+
+    //! Y coordinates, scaled distance * sin(angle)
+    std::vector<float> y;
+
+    std::size_t size() const { return x.size(); }
+};
+
+//! \struct AngleTable
+//! \brief Precomputed scaled cos/sin values for every sample index of a scan configuration
+struct AngleTable
+{
+    //! Number of samples per scan
+    int num_points_scan;
+
+    //! Angle of sample index 0 in 1/10000°
+    int32_t start_angle;
+
+    //! Delta between two succeeding samples in 1/10000°
+    int32_t angular_increment;
+
+    //! scale * cos(angle) for every sample index
+    std::vector<float> cos_table;
+
+    //! scale * sin(angle) for every sample index
+    std::vector<float> sin_table;
+};
+
+//! \class CartesianConverter
+//! \brief Converts distance data to cartesian x/y coordinates
+//! The angle of each sample is taken from first_angle/angular_increment of the packet headers.
+//! Tables are built once per (samples per scan, start angle, angular increment) configuration.
+class CartesianConverter
+{
+public:
+    //! @param scale Factor applied to the distances, 1.0 keeps millimeters, 0.001 converts to meters
+    CartesianConverter(float scale = 1.0f);
+
+    //! Set factor applied to the distances, clears cached tables
+    void setScale(float scale);
+
+    //! Get factor applied to the distances
+    float getScale() const { return scale_; }
+
+    //! Convert a scan to cartesian coordinates
+    //! @param scan Scan with distance data and the packet headers belonging to the data
+    //! @param cloud Output, points are in the order of scan.distance_data, invalid samples are set to 0
+    void convert(const ScanData& scan, PointCloud2D& cloud);
+
+    //! Convert a compact scan to cartesian coordinates
+    //! @param scan Compact scan
+    //! @param cloud Output, num_points_scan points in sample order, invalid samples are set to 0
+    void convert(const CompactScanData& scan, PointCloud2D& cloud);
+
+    //! Convert consecutive samples of a scan
+    //! Invalid samples (INVALID_DISTANCE and above: no echo or lost packet) are set to 0, the position of the scanner
+    //! @param distances Distances in millimeter
+    //! @param count Number of distances
+    //! @param table Table of the scan configuration
+    //! @param first_index Sample index of the first distance within the scan
+    //! @param x Output for count x coordinates
+    //! @param y Output for count y coordinates
+    static void convert(const uint32_t* distances, std::size_t count, const AngleTable& table, std::size_t first_index, float* x, float* y);
+
+    //! Get the table of a scan configuration, computed on first use
+    //! @param num_points_scan Number of samples per scan
+    //! @param start_angle Angle of sample index 0 in 1/10000°
+    //! @param angular_increment Delta between two succeeding samples in 1/10000°
+    const AngleTable& getTable(int num_points_scan, int32_t start_angle, int32_t angular_increment);
+
+    //! Get the table matching a packet header
+    const AngleTable& getTable(const PacketHeader& header);
+
+    //! Remove all cached tables
+    void clearTables();
+
+private:
+    //! Key of a scan configuration (num_points_scan, start_angle, angular_increment)
+    struct TableKey
+    {
+        int num_points_scan;
+        int32_t start_angle;
+        int32_t angular_increment;
+
+        bool operator<(const TableKey& other) const;
+        bool operator==(const TableKey& other) const;
+    };
+
+    //! Factor applied to the distances
+    float scale_;
+
+    //! Cached tables
+    std::map<TableKey, AngleTable> tables_;
+
+    //! Table used last, scans of one scanner normally share one configuration
+    const AngleTable* last_table_;
+    TableKey last_key_;
+};
+
+}
+#endif // CARTESIAN_CONVERTER_H
@@ -0,0 +1,160 @@
+//
+//  clock_sync.cpp
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	estimates offset and drift between the scanner clock (PacketHeader::timestamp_raw)
+//	and the monotonic host clock from packet arrival times
+//
+
+#include "clock_sync.h"
+
+#include <cmath>
+
+namespace pepperl_fuchs {
+
+//! Length of a bucket in microseconds of scanner time
+static const double BUCKET_LENGTH = 1000000.0;
+
+//! Deviation from the prediction in microseconds which is treated as a clock jump
+static const double RESET_THRESHOLD = 1000000.0;
+
+//-----------------------------------------------------------------------------
+ClockSynchronizer::ClockSynchronizer()
+{
+    reset();
+}
+
+//-----------------------------------------------------------------------------
+void ClockSynchronizer::reset()
+{
+    has_reference_ = false;
+    device_reference_ = 0;
+    host_reference_ = 0;
+    bucket_count_ = 0;
+    bucket_next_ = 0;
+    bucket_open_ = false;
+    bucket_start_ = 0.0;
+    bucket_min_.time = 0.0;
+    bucket_min_.offset = 0.0;
+    offset_ = 0.0;
+    drift_ = 0.0;
+    last_time_ = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+int64_t ClockSynchronizer::ntpToMicroseconds(uint64_t timestamp_raw)
+{
+    const uint64_t seconds = timestamp_raw >> 32;
+    const uint64_t fraction = timestamp_raw & 0xFFFFFFFFULL;
+
+    return (int64_t)(seconds * 1000000ULL + ((fraction * 1000000ULL) >> 32));
+}
+
+//-----------------------------------------------------------------------------
+void ClockSynchronizer::update(uint64_t timestamp_raw, int64_t host_time)
+{
+    const int64_t device_time = ntpToMicroseconds(timestamp_raw);
+
+    if( !has_reference_ )
+    {
+        device_reference_ = device_time;
+        host_reference_ = host_time;
+        has_reference_ = true;
+    }
+
+    const double t = (double)(device_time - device_reference_);
+    const double offset = (double)(host_time - host_reference_) - t;
+
+    // scanner restarted or its clock was set
+    if( bucket_open_ && std::fabs(offset - predictOffset(t)) > RESET_THRESHOLD )
+    {
+        reset();
+        update(timestamp_raw, host_time);
+        return;
+    }
+
+    last_time_ = t;
+
+    if( !bucket_open_ || t < bucket_start_ || t - bucket_start_ >= BUCKET_LENGTH )
+    {
+        if( bucket_open_ )
+            closeBucket();
+
+        bucket_open_ = true;
+        bucket_start_ = t;
+        bucket_min_.time = t;
+        bucket_min_.offset = offset;
+    }
+    else if( offset < bucket_min_.offset )
+    {
+        bucket_min_.time = t;
+        bucket_min_.offset = offset;
+    }
+
+    // no fit yet, follow the minimum of the first bucket
+    if( bucket_count_ == 0 )
+    {
+        offset_ = bucket_min_.offset;
+        drift_ = 0.0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void ClockSynchronizer::closeBucket()
+{
+    buckets_[bucket_next_] = bucket_min_;
+    bucket_next_ = (bucket_next_ + 1) % MAX_BUCKETS;
+    if( bucket_count_ < MAX_BUCKETS )
+        bucket_count_++;
+
+    if( bucket_count_ == 1 )
+    {
+        offset_ = bucket_min_.offset;
+        drift_ = 0.0;
+        return;
+    }
+
+    // least squares line through the bucket minima
+    double mean_t = 0.0;
+    double mean_o = 0.0;
+    for( std::size_t i=0; i<bucket_count_; i++ )
+    {
+        mean_t += buckets_[i].time;
+        mean_o += buckets_[i].offset;
+    }
+    mean_t /= bucket_count_;
+    mean_o /= bucket_count_;
+
+    double stt = 0.0;
+    double sto = 0.0;
+    for( std::size_t i=0; i<bucket_count_; i++ )
+    {
+        const double dt = buckets_[i].time - mean_t;
+        stt += dt * dt;
+        sto += dt * (buckets_[i].offset - mean_o);
+    }
+
+    drift_ = stt > 0.0 ? sto / stt : 0.0;
+    offset_ = mean_o - drift_ * mean_t;
+}
+
+//-----------------------------------------------------------------------------
+int64_t ClockSynchronizer::toHostTime(uint64_t timestamp_raw) const
+{
+    if( !has_reference_ )
+        return 0;
+
+    const double t = (double)(ntpToMicroseconds(timestamp_raw) - device_reference_);
+
+    return host_reference_ + (int64_t)std::floor(t + predictOffset(t) + 0.5);
+}
+
+//-----------------------------------------------------------------------------
+double ClockSynchronizer::getOffset() const
+{
+    return (double)(host_reference_ - device_reference_) + predictOffset(last_time_);
+}
+
+}
@@ -0,0 +1,99 @@
+//
+//  clock_sync.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	estimates offset and drift between the scanner clock (PacketHeader::timestamp_raw)
+//	and the monotonic host clock from packet arrival times
+//
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace pepperl_fuchs {
+
+//! \class ClockSynchronizer
+//! \brief Maps raw scanner timestamps to host time
+//! Host time is the monotonic Poco::Clock value in microseconds (Poco::Clock::raw()).
+//! The arrival time of a packet is its send time plus a varying network and scheduling delay,
+//! so the smallest offset within each second is kept and a line is fitted through the last minima.
+//! The result is the host time the packet was sent at, shifted by the minimal delay.
+//! update() is O(1) per packet with one small least squares fit per second.
+//! Not thread safe, the owner has to lock.
+class ClockSynchronizer
+{
+public:
+    ClockSynchronizer();
+
+    //! Add a packet
+    //! @param timestamp_raw Raw timestamp of the packet in NTP time format
+    //! @param host_time Host time in microseconds when the packet was received
+    void update(uint64_t timestamp_raw, int64_t host_time);
+
+    //! Convert a raw scanner timestamp to host time
+    //! @param timestamp_raw Raw timestamp in NTP time format
+    //! @returns Host time in microseconds, 0 if no packet was added yet
+    int64_t toHostTime(uint64_t timestamp_raw) const;
+
+    //! Return if at least one packet was added
+    bool isSynchronized() const { return has_reference_; }
+
+    //! Get the current offset between host and scanner clock
+    //! @returns Host time minus scanner time in microseconds
+    double getOffset() const;
+
+    //! Get the estimated drift of the scanner clock relative to the host clock
+    //! @returns Drift in parts per million, positive if the scanner clock runs faster
+    double getDrift() const { return -drift_ * 1000000.0; }
+
+    //! Forget all measurements, e.g. after the scanner was restarted
+    void reset();
+
+    //! Convert a NTP timestamp (32 bit seconds, 32 bit fraction) to microseconds
+    static int64_t ntpToMicroseconds(uint64_t timestamp_raw);
+
+private:
+    //! Close the running bucket and fit the line through all stored minima
+    void closeBucket();
+
+    //! Offset predicted by the fitted line for scanner time t
+    double predictOffset(double t) const { return offset_ + drift_ * t; }
+
+    //! Minimal offset within one bucket
+    struct Bucket
+    {
+        double time;
+        double offset;
+    };
+
+    static const std::size_t MAX_BUCKETS = 32;
+
+    //! First scanner and host time, all internal times are relative to them
+    bool has_reference_;
+    int64_t device_reference_;
+    int64_t host_reference_;
+
+    //! Ring of closed buckets
+    Bucket buckets_[MAX_BUCKETS];
+    std::size_t bucket_count_;
+    std::size_t bucket_next_;
+
+    //! Running bucket
+    bool bucket_open_;
+    double bucket_start_;
+    Bucket bucket_min_;
+
+    //! Fitted line: offset = offset_ + drift_ * t
+    double offset_;
+    double drift_;
+
+    //! Scanner time of the last packet
+    double last_time_;
+};
+
+}
+#endif // CLOCK_SYNC_H
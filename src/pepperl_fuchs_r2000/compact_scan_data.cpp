@@ -0,0 +1,148 @@
+//
+//  compact_scan_data.cpp
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	structure of arrays representation of a scan with fixed-width types,
+//	indexed by sample index and with the per scan meta data pulled out of the packet headers
+//
+
+#include "compact_scan_data.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace pepperl_fuchs {
+
+//-----------------------------------------------------------------------------
+CompactScanData::CompactScanData()
+{
+    std::memset(&info, 0, sizeof(ScanInfo));
+}
+
+//-----------------------------------------------------------------------------
+void initScanInfo(ScanInfo& info, const PacketHeader& header)
+{
+    info.scan_number = header.scan_number;
+    info.timestamp_first = header.timestamp_raw;
+    info.timestamp_last = header.timestamp_raw;
+    info.host_time_first = 0;
+    info.host_time_last = 0;
+    info.first_index = header.first_index;
+    info.scan_frequency = header.scan_frequency;
+    info.num_points_scan = header.num_points_scan;
+    info.start_angle = header.first_angle - (int32_t)header.first_index * header.angular_increment;
+    info.angular_increment = header.angular_increment;
+    info.status_flags = 0;
+    info.num_points_received = 0;
+    info.num_packets = 0;
+    info.follows_gap = 0;
+    info.packet_type = header.packet_type;
+}
+
+//-----------------------------------------------------------------------------
+void addPacketInfo(ScanInfo& info, const PacketHeader& header, uint32_t num_points, int64_t host_time)
+{
+    if( info.num_packets == 0 )
+    {
+        info.timestamp_first = header.timestamp_raw;
+        info.host_time_first = host_time;
+        info.first_index = header.first_index;
+    }
+
+    info.timestamp_last = header.timestamp_raw;
+    info.host_time_last = host_time;
+    info.status_flags |= header.status_flags;
+    info.num_points_received += num_points;
+    info.num_packets++;
+}
+
+//-----------------------------------------------------------------------------
+void CompactScanData::init(const PacketHeader& header)
+{
+    initScanInfo(info, header);
+
+    distance_data.assign(header.num_points_scan, INVALID_DISTANCE);
+    if( header.packet_type == PACKET_TYPE_A )
+        amplitude_data.clear();
+    else
+        amplitude_data.assign(header.num_points_scan, 0);
+}
+
+//-----------------------------------------------------------------------------
+void CompactScanData::addPacketInfo(const PacketHeader& header, uint32_t num_points, int64_t host_time)
+{
+    pepperl_fuchs::addPacketInfo(info, header, num_points, host_time);
+}
+
+//-----------------------------------------------------------------------------
+void compactScanData(const ScanData& scan, CompactScanData& compact)
+{
+    if( scan.headers.empty() )
+    {
+        compact = CompactScanData();
+        return;
+    }
+
+    compact.init(scan.headers[0]);
+    compact.info.follows_gap = scan.follows_gap;
+
+    std::size_t offset = 0;
+    for( std::size_t h=0; h<scan.headers.size(); h++ )
+    {
+        const PacketHeader& header = scan.headers[h];
+
+        if( header.first_index >= compact.info.num_points_scan || offset >= scan.distance_data.size() )
+            break;
+
+        std::size_t count = std::min((std::size_t)header.num_points_packet, scan.distance_data.size() - offset);
+        std::size_t stored = std::min(count, (std::size_t)(compact.info.num_points_scan - header.first_index));
+
+        std::copy(scan.distance_data.begin() + offset, scan.distance_data.begin() + offset + stored, compact.distance_data.begin() + header.first_index);
+
+        if( !compact.amplitude_data.empty() && offset + stored <= scan.amplitude_data.size() )
+        {
+            for( std::size_t i=0; i<stored; i++ )
+                compact.amplitude_data[header.first_index + i] = (uint16_t)scan.amplitude_data[offset + i];
+        }
+
+        compact.addPacketInfo(header, stored, h < scan.host_times.size() ? scan.host_times[h] : 0);
+        offset += count;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void expandScanData(const CompactScanData& compact, ScanData& scan)
+{
+    scan.distance_data.assign(compact.distance_data.begin(), compact.distance_data.end());
+    scan.amplitude_data.assign(compact.amplitude_data.begin(), compact.amplitude_data.end());
+    scan.follows_gap = compact.info.follows_gap != 0;
+
+    PacketHeader header;
+    std::memset(&header, 0, sizeof(PacketHeader));
+    header.magic = 0xa25c;
+    header.packet_type = compact.amplitude_data.empty() ? PACKET_TYPE_A : PACKET_TYPE_C;
+    header.header_size = sizeof(PacketHeader);
+    header.scan_number = compact.info.scan_number;
+    header.packet_number = 1;
+    header.timestamp_raw = compact.info.timestamp_first;
+    header.status_flags = compact.info.status_flags;
+    header.scan_frequency = compact.info.scan_frequency;
+    header.num_points_scan = compact.info.num_points_scan;
+    header.num_points_packet = (uint16_t)compact.distance_data.size();
+    header.first_index = 0;
+    header.first_angle = compact.info.start_angle;
+    header.angular_increment = compact.info.angular_increment;
+
+    // timestamps refer to the first received packet, move them back to sample index 0
+    double offset_us = 0.0;
+    if( compact.info.scan_frequency > 0 && compact.info.num_points_scan > 0 )
+        offset_us = (double)compact.info.first_index * 1.0e9 / compact.info.scan_frequency / compact.info.num_points_scan;
+    header.timestamp_raw -= (uint64_t)(offset_us * 4294.967296);
+
+    scan.headers.assign(1, header);
+    scan.host_times.assign(1, compact.info.host_time_first - (int64_t)offset_us);
+}
+
+}
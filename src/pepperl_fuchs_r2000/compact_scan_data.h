@@ -0,0 +1,136 @@
+//
+//  compact_scan_data.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	structure of arrays representation of a scan with fixed-width types,
+//	indexed by sample index and with the per scan meta data pulled out of the packet headers
+//
+
+#ifndef COMPACT_SCAN_DATA_H
+#define COMPACT_SCAN_DATA_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "aligned_allocator.h"
+
+#if __cplusplus>=201103
+	#include "packet_structure_cpp11.h"
+#else
+	#include "packet_structure.h"
+#endif
+
+namespace pepperl_fuchs {
+
+//! Distance of samples which were not received
+static const uint32_t INVALID_DISTANCE = 0xFFFFF;
+
+typedef std::vector< uint32_t, AlignedAllocator<uint32_t> > AlignedUInt32Vector;
+typedef std::vector< uint16_t, AlignedAllocator<uint16_t> > AlignedUInt16Vector;
+
+#pragma pack(1)
+//! \struct ScanInfo
+//! \brief Meta data of one scan, taken from the packet headers
+struct ScanInfo
+{
+    //! Sequence for scan (incremented for every scan, starting with 0, overflows)
+    uint16_t scan_number;
+
+    //! Raw timestamp of the first received packet in NTP time format
+    uint64_t timestamp_first;
+
+    //! Raw timestamp of the last received packet in NTP time format
+    uint64_t timestamp_last;
+
+    //! Host time of the first received packet in microseconds (Poco::Clock::raw())
+    int64_t host_time_first;
+
+    //! Host time of the last received packet in microseconds (Poco::Clock::raw())
+    int64_t host_time_last;
+
+    //! Sample index of the first received packet, the sample host_time_first and timestamp_first refer to
+    uint16_t first_index;
+
+    //! Frequency of scan-head rotation in mHz (Milli-Hertz)
+    uint32_t scan_frequency;
+
+    //! Total number of scan points (samples) within complete scan
+    uint16_t num_points_scan;
+
+    //! Absolute angle of sample index 0 in 1/10000°
+    int32_t start_angle;
+
+    //! Delta between two succeding scan points 1/10000°
+    int32_t angular_increment;
+
+    //! Status flags of all received packets, combined by OR
+    uint32_t status_flags;
+
+    //! Number of samples received, smaller than num_points_scan if packets were lost
+    uint32_t num_points_received;
+
+    //! Number of packets received
+    uint16_t num_packets;
+
+    //! True if data was lost right before this scan, e.g. while the connection was re-established
+    uint8_t follows_gap;
+
+    //! Packet type of the scan (PACKET_TYPE_A, _B or _C), type A has no amplitudes
+    uint16_t packet_type;
+};
+#pragma pack()
+
+//! \struct CompactScanData
+//! \brief One scan with distance and amplitude arrays indexed by sample index
+//! Samples of lost packets have a distance of INVALID_DISTANCE and an amplitude of 0.
+//! Scans of packet type A have no amplitudes, amplitude_data is empty.
+struct CompactScanData
+{
+    CompactScanData();
+
+    //! Meta data of the scan
+    ScanInfo info;
+
+    //! Distance data in polar form in millimeter, num_points_scan entries
+    AlignedUInt32Vector distance_data;
+
+    //! Amplitude data in the range 32-4095, values lower than 32 indicate an error or undefined values,
+    //! num_points_scan entries or empty for packet type A
+    AlignedUInt16Vector amplitude_data;
+
+    //! Return if all samples of the scan were received
+    bool isComplete() const { return info.num_points_received >= info.num_points_scan; }
+
+    //! Start a scan for the packets belonging to header, sizes the arrays and marks all samples as invalid
+    //! amplitude_data stays empty for packet type A
+    void init(const PacketHeader& header);
+
+    //! Update the meta data with a received packet of this scan
+    //! @param header Header of the packet
+    //! @param num_points Number of samples stored from the packet
+    //! @param host_time Host time of the packet in microseconds
+    void addPacketInfo(const PacketHeader& header, uint32_t num_points, int64_t host_time);
+};
+
+//! Start the meta data of a scan with the first packet belonging to it
+void initScanInfo(ScanInfo& info, const PacketHeader& header);
+
+//! Update the meta data of a scan with a received packet of this scan
+//! @param num_points Number of samples stored from the packet
+//! @param host_time Host time of the packet in microseconds
+void addPacketInfo(ScanInfo& info, const PacketHeader& header, uint32_t num_points, int64_t host_time);
+
+//! Convert a scan to its compact representation
+//! @param scan Scan with the packet headers belonging to the data
+//! @param compact Output
+void compactScanData(const ScanData& scan, CompactScanData& compact);
+
+//! Convert a compact scan to a ScanData with a single header covering all samples
+//! @param compact Compact scan
+//! @param scan Output
+void expandScanData(const CompactScanData& compact, ScanData& scan);
+
+}
+#endif // COMPACT_SCAN_DATA_H
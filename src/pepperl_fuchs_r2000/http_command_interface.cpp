@@ -31,6 +31,10 @@
 #include "Poco/URI.h"
 
 #include "Poco/NumberFormatter.h"
+#include "Poco/StreamCopier.h"
+#include "Poco/Clock.h"
+
+#include "trace.h"
 
 
 namespace pepperl_fuchs {
@@ -44,14 +48,13 @@ namespace pepperl_fuchs {
     {
         http_host_ = http_host;
         http_port_ = http_port;
-		http_status_code_ = Poco::Net::HTTPResponse::HTTP_NOT_FOUND;
-
     }
     
     
     //-----------------------------------------------------------------------------
 	int HttpCommandInterface::httpGet(const std::string request_path, std::string &header, std::string &content)
     {
+        R2000_TRACE_SCOPE("httpGet");
         header = "";
         content = "";
         
@@ -95,26 +98,12 @@ namespace pepperl_fuchs {
 			}
 			
 			
-			std::string tmp;
-			
-			// read until eof
-			while(!response_stream.eof()) {
-				std::getline(response_stream, tmp);
-				content += tmp;
-			}
-			
+			// read the whole body into a single buffer
+			std::streamsize content_length = res.getContentLength();
+			if (content_length > 0)
+				content.reserve(static_cast<std::size_t>(content_length));
 			
-            
-			// Substitute CRs by a space
-			for( std::size_t i=0; i<header.size(); i++ ) {
-                if( header[i] == '\r' )
-                    header[i] = ' ';
-			}
-            
-			for( std::size_t i=0; i<content.size(); i++ ) {
-				if( content[i] == '\r' )
-					content[i] = ' ';
-			}
+			StreamCopier::copyToString(response_stream, content);
 
 			return status_code;
 			
@@ -129,39 +118,57 @@ namespace pepperl_fuchs {
     
     
     //-----------------------------------------------------------------------------
-    bool HttpCommandInterface::sendHttpCommand(const std::string cmd, const std::map<std::string, std::string> param_values)
+    bool HttpCommandInterface::parseResponse(const std::string& content, Json::Value& response)
+    {
+        // Parse JSON response directly from the content buffer, comments are not expected
+		Json::Reader json_parser;
+		const char* begin = content.data();
+		
+        if (!json_parser.parse(begin, begin + content.size(), response, false))
+        {
+			std::cerr << "Json::parse" << "Unable to parse string: " << json_parser.getFormattedErrorMessages() << std::endl;
+            return false;
+        }
+        
+        return true;
+    }
+    
+    
+    //-----------------------------------------------------------------------------
+    bool HttpCommandInterface::sendHttpCommand(const std::string cmd, const std::map<std::string, std::string> param_values, Json::Value& response)
     {
         // Build request string
         std::string request_str = "/cmd/" + cmd + "?";
         
-        
-        
         for( std::map<std::string, std::string>::const_iterator kv = param_values.begin(); kv != param_values.end(); kv++ ) {
             request_str += kv->first + "=" + kv->second + "&";
         }
         
         if(request_str[request_str.size()-1] == '&' )
-            request_str = request_str.substr(0,request_str.size()-1);
+            request_str.erase(request_str.size()-1);
         
         // Do HTTP request
+        Poco::Clock start;
         std::string header, content;
-        http_status_code_ = httpGet(request_str, header, content);
-		
-        // Try to parse JSON response
-		// create parser
+        int http_status_code = httpGet(request_str, header, content);
 		
-		// parse json
-		std::stringstream ss(content);
+        commands_.add(1);
 		
-        if (!jsonParser.parse(ss, root))
+        if (!parseResponse(content, response))
         {
-			std::cerr << "Json::parse" << "Unable to parse string: " << jsonParser.getFormattedErrorMessages() << std::endl;
+            command_failures_.add(1);
+            command_latency_.add(start.elapsed());
             return false;
         }
+		
+        command_latency_.add(start.elapsed());
         
         // Check HTTP-status code
-        if( http_status_code_ != 200 )
+        if( http_status_code != 200 )
+        {
+            command_failures_.add(1);
             return false;
+        }
         else
             return true;
     }
@@ -169,26 +176,28 @@ namespace pepperl_fuchs {
     
     
     //-----------------------------------------------------------------------------
-    bool HttpCommandInterface::sendHttpCommand(const std::string cmd, const std::string param, const std::string value)
+    bool HttpCommandInterface::sendHttpCommand(const std::string cmd, Json::Value& response, const std::string param, const std::string value)
     {
         std::map<std::string, std::string> param_values;
         if( param != "" )
             param_values[param] = value;
-        return sendHttpCommand(cmd,param_values);
+        return sendHttpCommand(cmd,param_values,response);
     }
     
     
     //-----------------------------------------------------------------------------
     bool HttpCommandInterface::setParameter(const std::string name, const std::string value)
     {
-        return sendHttpCommand("set_parameter",name,value) && checkErrorCode();
+        Json::Value root;
+        return sendHttpCommand("set_parameter", root, name,value) && checkErrorCode(root);
     }
     
     
     //-----------------------------------------------------------------------------
     Poco::Optional< std::string > HttpCommandInterface::getParameter(const std::string name)
     {
-        if( !sendHttpCommand("get_parameter","list",name) || ! checkErrorCode()  )
+        Json::Value root;
+        if( !sendHttpCommand("get_parameter", root, "list",name) || ! checkErrorCode(root)  )
             return Poco::Optional<std::string>();
         
         // query json for value
@@ -197,7 +206,7 @@ namespace pepperl_fuchs {
 			return Poco::Optional<std::string>();
 		}
 		
-		Json::Value value = root.get(name, "");
+		const Json::Value& value = root[name];
 		if (!value.isString())
 			return Poco::Optional<std::string>();
 		
@@ -218,30 +227,39 @@ namespace pepperl_fuchs {
             namelist += (*s + ";");
         }
         
-        namelist.substr(0,namelist.size()-1);
+        if( !namelist.empty() )
+            namelist.erase(namelist.size()-1);
         
         // Read parameter values via HTTP/JSON request/response
-        if( !sendHttpCommand("get_parameter","list",namelist) || ! checkErrorCode()  )
+        Json::Value root;
+        if( !sendHttpCommand("get_parameter", root, "list",namelist) || ! checkErrorCode(root)  )
             return key_values;
         
-		
+        return parseParameters(root, names);
+    }
+    
+    
+    //-----------------------------------------------------------------------------
+    std::map< std::string, std::string > HttpCommandInterface::parseParameters(const Json::Value& root, const std::vector<std::string>& names)
+    {
+        std::map< std::string, std::string > key_values;
         
-       
         // Extract values from JSON property_tree
         for( std::vector<std::string>::const_iterator s = names.begin(); s != names.end(); s++ )
         {
 			if( root.isMember(*s) ) {
 				
-				Json::Value v = root[*s];
+				const Json::Value& v = root[*s];
 				try {
 					
 					if (v.isArray()) {
 						
 						std::string arrayString;
-						for (int i=0; i<v.size()-1; i++) {
-							arrayString += v[i].asString() + ", ";
+						for (Json::ArrayIndex i=0; i<v.size(); i++) {
+							if (i > 0)
+								arrayString += ", ";
+							arrayString += v[i].asString();
 						}
-						arrayString += v[v.size()-1].asString();
 						
 						key_values[*s] = arrayString;
 						
@@ -265,11 +283,8 @@ namespace pepperl_fuchs {
     
     
     //-----------------------------------------------------------------------------
-    bool HttpCommandInterface::checkErrorCode()
+    bool HttpCommandInterface::checkErrorCode(const Json::Value& root)
     {
-		Json::Value error_value = root["error_code"];
-		Json::Value error_string = root["error_text"];
-		
 		if (!root.isMember("error_code") || !root["error_code"].isNumeric() || root["error_code"].asInt() != 0 || !root["error_text"].isString() || root["error_text"].asString() != "success") {
 			
 			if (root["error_text"].isString()) {
@@ -287,14 +302,15 @@ namespace pepperl_fuchs {
     Poco::Optional<ProtocolInfo> HttpCommandInterface::getProtocolInfo()
     {
         // Read protocol info via HTTP/JSON request/response
-        if( !sendHttpCommand("get_protocol_info") || !checkErrorCode() )
+        Json::Value root;
+        if( !sendHttpCommand("get_protocol_info", root) || !checkErrorCode(root) )
             return Poco::Optional<ProtocolInfo>();
         
         // Read and set protocol info
-		Json::Value protocol_name = root["protocol_name"];
-		Json::Value version_major = root["version_major"];
-		Json::Value version_minor = root["version_minor"];
-		Json::Value ocommands = root["commands"];
+		const Json::Value& protocol_name = root["protocol_name"];
+		const Json::Value& version_major = root["version_major"];
+		const Json::Value& version_minor = root["version_minor"];
+		const Json::Value& ocommands = root["commands"];
 
 		if (!protocol_name.isString() || !version_major.isNumeric() || !version_minor.isNumeric() || ocommands.isNull())
 			return Poco::Optional<ProtocolInfo>();
@@ -307,8 +323,8 @@ namespace pepperl_fuchs {
 
 		
 		if (ocommands.isArray()) {
-			for (int i=0; i<ocommands.size(); i++) {
-				Json::Value v = ocommands[i];
+			for (Json::ArrayIndex i=0; i<ocommands.size(); i++) {
+				const Json::Value& v = ocommands[i];
 				
 				try {
 					pi.commands.push_back(v.asString());
@@ -326,19 +342,27 @@ namespace pepperl_fuchs {
     std::vector< std::string > HttpCommandInterface::getParameterList()
     {
         // Read available parameters via HTTP/JSON request/response
-        std::vector< std::string > parameter_list;
-        if( !sendHttpCommand("list_parameters") || !checkErrorCode() )
-            return parameter_list;
+        Json::Value root;
+        if( !sendHttpCommand("list_parameters", root) || !checkErrorCode(root) )
+            return std::vector< std::string >();
 		
-		Json::Value oparameters = root["parameters"];
+        return parseParameterList(root);
+    }
+    
+    
+    //-----------------------------------------------------------------------------
+    std::vector< std::string > HttpCommandInterface::parseParameterList(const Json::Value& root)
+    {
+        std::vector< std::string > parameter_list;
+		const Json::Value& oparameters = root["parameters"];
 		
 		if (oparameters.isNull()) {
 			return parameter_list;
 		}
 		
 		if (oparameters.isArray()) {
-			for (int i=0; i<oparameters.size(); i++) {
-				Json::Value v = oparameters[i];
+			for (Json::ArrayIndex i=0; i<oparameters.size(); i++) {
+				const Json::Value& v = oparameters[i];
 				try {
 					parameter_list.push_back(v.asString());
 				} catch(Exception e) {
@@ -353,19 +377,22 @@ namespace pepperl_fuchs {
     
     
     //-----------------------------------------------------------------------------
-    Poco::Optional<HandleInfo> HttpCommandInterface::requestHandleTCP(int start_angle)
+    Poco::Optional<HandleInfo> HttpCommandInterface::requestHandleTCP(int start_angle, int max_num_points_scan, char packet_type)
     {
         // Prepare HTTP request
         std::map< std::string, std::string > params;
-        params["packet_type"] = "C";
+        params["packet_type"] = std::string(1, packet_type);
         params["start_angle"] = Poco::NumberFormatter::format(start_angle);
+        if( max_num_points_scan > 0 )
+            params["max_num_points_scan"] = Poco::NumberFormatter::format(max_num_points_scan);
         
         // Request handle via HTTP/JSON request/response
-        if( !sendHttpCommand("request_handle_tcp", params) || !checkErrorCode() )
+        Json::Value root;
+        if( !sendHttpCommand("request_handle_tcp", params, root) || !checkErrorCode(root) )
             return Poco::Optional<HandleInfo>();
 
-		Json::Value port = root["port"];
-		Json::Value handle = root["handle"];
+		const Json::Value& port = root["port"];
+		const Json::Value& handle = root["handle"];
 		
 		if(!port.isInt() || !handle.isString())
 			return Poco::Optional<HandleInfo>();
@@ -377,8 +404,9 @@ namespace pepperl_fuchs {
 		hi.handle = handle.asString();
         hi.hostname = http_host_;
 		hi.port = port.asInt();
-        hi.packet_type = 'C';
+        hi.packet_type = packet_type;
         hi.start_angle = start_angle;
+        hi.max_num_points_scan = max_num_points_scan;
         hi.watchdog_enabled = true;
         hi.watchdog_timeout = 60000;
         return hi;
@@ -387,22 +415,25 @@ namespace pepperl_fuchs {
     
     
     //-----------------------------------------------------------------------------
-    Poco::Optional<HandleInfo> HttpCommandInterface::requestHandleUDP(int port, std::string hostname, int start_angle)
+    Poco::Optional<HandleInfo> HttpCommandInterface::requestHandleUDP(int port, std::string hostname, int start_angle, int max_num_points_scan, char packet_type)
     {
         // Prepare HTTP request
         if( hostname == "" )
             hostname = discoverLocalIP();
         std::map< std::string, std::string > params;
-        params["packet_type"] = "C";
+        params["packet_type"] = std::string(1, packet_type);
         params["start_angle"] = Poco::NumberFormatter::format(start_angle);
+        if( max_num_points_scan > 0 )
+            params["max_num_points_scan"] = Poco::NumberFormatter::format(max_num_points_scan);
         params["port"] = Poco::NumberFormatter::format(port);
         params["address"] = hostname;
         
         // Request handle via HTTP/JSON request/response
-        if( !sendHttpCommand("request_handle_udp", params) || !checkErrorCode() )
+        Json::Value root;
+        if( !sendHttpCommand("request_handle_udp", params, root) || !checkErrorCode(root) )
             return Poco::Optional<HandleInfo>();
 		
-		Json::Value handle = root["handle"];
+		const Json::Value& handle = root["handle"];
 		if(!handle.isString())
 			return Poco::Optional<HandleInfo>();
 		
@@ -413,8 +444,9 @@ namespace pepperl_fuchs {
 		hi.handle = handle.asString();
         hi.hostname = hostname;
         hi.port = port;
-        hi.packet_type = 'C';
+        hi.packet_type = packet_type;
         hi.start_angle = start_angle;
+        hi.max_num_points_scan = max_num_points_scan;
         hi.watchdog_enabled = true;
         hi.watchdog_timeout = 60000;
         return hi;
@@ -424,7 +456,8 @@ namespace pepperl_fuchs {
     //-----------------------------------------------------------------------------
     bool HttpCommandInterface::releaseHandle(const std::string& handle)
     {
-        if( !sendHttpCommand("release_handle", "handle", handle) || !checkErrorCode() )
+        Json::Value root;
+        if( !sendHttpCommand("release_handle", root, "handle", handle) || !checkErrorCode(root) )
             return false;
         return true;
     }
@@ -433,7 +466,8 @@ namespace pepperl_fuchs {
     //-----------------------------------------------------------------------------
     bool HttpCommandInterface::startScanOutput(const std::string& handle)
     {
-        if( !sendHttpCommand("start_scanoutput", "handle", handle) || !checkErrorCode() )
+        Json::Value root;
+        if( !sendHttpCommand("start_scanoutput", root, "handle", handle) || !checkErrorCode(root) )
             return false;
         return true;
     }
@@ -441,22 +475,44 @@ namespace pepperl_fuchs {
     //-----------------------------------------------------------------------------
     bool HttpCommandInterface::stopScanOutput(const std::string& handle)
     {
-        if( !sendHttpCommand("stop_scanoutput", "handle", handle) || !checkErrorCode() )
+        Json::Value root;
+        if( !sendHttpCommand("stop_scanoutput", root, "handle", handle) || !checkErrorCode(root) )
             return false;
         return true;
     }
     //-----------------------------------------------------------------------------
     bool HttpCommandInterface::feedWatchdog(const std::string &handle)
     {
-        if( !sendHttpCommand("feed_watchdog", "handle", handle) || !checkErrorCode() )
-            return false;
-        return true;
+        Json::Value root;
+        Poco::Clock start;
+        bool fed = sendHttpCommand("feed_watchdog", root, "handle", handle) && checkErrorCode(root);
+		
+        watchdog_feeds_.add(1);
+        watchdog_latency_.add(start.elapsed());
+        if( !fed )
+            watchdog_failures_.add(1);
+		
+        return fed;
+    }
+    
+    //-----------------------------------------------------------------------------
+    CommandMetricsSnapshot HttpCommandInterface::getMetrics() const
+    {
+        CommandMetricsSnapshot snapshot;
+        snapshot.commands = commands_.get();
+        snapshot.command_failures = command_failures_.get();
+        snapshot.command_latency_us = command_latency_.getSnapshot();
+        snapshot.watchdog_feeds = watchdog_feeds_.get();
+        snapshot.watchdog_failures = watchdog_failures_.get();
+        snapshot.watchdog_latency_us = watchdog_latency_.getSnapshot();
+        return snapshot;
     }
     
     //-----------------------------------------------------------------------------
     bool HttpCommandInterface::rebootDevice()
     {
-        if( !sendHttpCommand("reboot_device") || !checkErrorCode() )
+        Json::Value root;
+        if( !sendHttpCommand("reboot_device", root) || !checkErrorCode(root) )
             return false;
         return true;
     }
@@ -469,9 +525,11 @@ namespace pepperl_fuchs {
         
         for( std::vector<std::string>::const_iterator s = names.begin(); s != names.end(); s++ )
             namelist += (*s + ";");
-        namelist.substr(0,namelist.size()-1);
+        if( !namelist.empty() )
+            namelist.erase(namelist.size()-1);
         
-        if( !sendHttpCommand("reset_parameter","list",namelist) || ! checkErrorCode()  )
+        Json::Value root;
+        if( !sendHttpCommand("reset_parameter", root, "list",namelist) || ! checkErrorCode(root)  )
             return false;
         
         return true;
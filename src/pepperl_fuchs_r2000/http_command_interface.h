@@ -24,12 +24,35 @@
 #include <json/json.h>
 
 #include "protocol_info.h"
+#include "receiver_metrics.h"
 
 
 namespace pepperl_fuchs {
+
+//! \struct CommandMetricsSnapshot
+//! \brief Copy of the request counters of a HttpCommandInterface
+struct CommandMetricsSnapshot
+{
+    CommandMetricsSnapshot() : commands(0), command_failures(0), watchdog_feeds(0), watchdog_failures(0) {}
+
+    //! Commands sent and commands without a valid HTTP/JSON response
+    uint64_t commands;
+    uint64_t command_failures;
+
+    //! Time from sending a command until its response was parsed in microseconds
+    HistogramSnapshot command_latency_us;
+
+    //! Watchdog feeds sent and feeds not confirmed by the scanner
+    uint64_t watchdog_feeds;
+    uint64_t watchdog_failures;
+
+    //! Time of a watchdog feed in microseconds, also counted in command_latency_us
+    HistogramSnapshot watchdog_latency_us;
+};
     
 //! \class HttpCommandInterface
 //! \brief Allows accessing the HTTP/JSON interface of the Pepperl+Fuchs Laserscanner R2000
+//! Every command parses its response into a local JSON value, so one instance can be used from several threads
 class HttpCommandInterface
 {
 public:
@@ -67,15 +90,19 @@ public:
     
     //! Request TCP handle
     //! @param start_angle Set start angle for scans in the range [0,3600000] (1/10000°)
+    //! @param max_num_points_scan Optional: Limit the number of samples sent per scan, 0 sends all samples
+    //! @param packet_type Optional: Packet type 'A' (distance), 'B' (distance, 16 bit amplitude) or 'C' (packed 20 bit distance, 12 bit amplitude)
     //! @returns A valid HandleInfo on success, an empty boost::optional<HandleInfo> container otherwise
-    Poco::Optional<HandleInfo> requestHandleTCP(int start_angle=-1800000);
+    Poco::Optional<HandleInfo> requestHandleTCP(int start_angle=-1800000, int max_num_points_scan=0, char packet_type='C');
     
     //! Request UDP handle
     //! @param port Set UDP port where scanner data should be sent to
     //! @param hostname Optional: Set hostname/IP where scanner data should be sent to, local IP is determined automatically if not specified
     //! @param start_angle Optional: Set start angle for scans in the range [0,3600000] (1/10000°), defaults to -1800000
+    //! @param max_num_points_scan Optional: Limit the number of samples sent per scan, 0 sends all samples
+    //! @param packet_type Optional: Packet type 'A' (distance), 'B' (distance, 16 bit amplitude) or 'C' (packed 20 bit distance, 12 bit amplitude)
     //! @returns A valid HandleInfo on success, an empty boost::optional<HandleInfo> container otherwise
-    Poco::Optional<HandleInfo> requestHandleUDP(int port, std::string hostname = std::string(""), int start_angle=-1800000);
+    Poco::Optional<HandleInfo> requestHandleUDP(int port, std::string hostname = std::string(""), int start_angle=-1800000, int max_num_points_scan=0, char packet_type='C');
     
     //! Release handle
     bool releaseHandle( const std::string& handle );
@@ -100,6 +127,31 @@ public:
     //! @returns The local IP as a string, an empty string otherwise
     std::string discoverLocalIP();
     
+    //! Get a copy of the request counters, can be called from any thread
+    CommandMetricsSnapshot getMetrics() const;
+    
+    //! Parse the content of a HTTP response, used by every command
+    //! @param content The response content
+    //! @param response The parsed JSON response
+    //! @returns True on success, false otherwise
+    static bool parseResponse(const std::string& content, Json::Value& response);
+    
+    //! Check the error code and text of a JSON response returned by the scanner
+    //! @param root The parsed JSON response
+    //! @returns False in case of an error, True otherwise
+    static bool checkErrorCode(const Json::Value& root);
+    
+    //! Extract the parameter names of a list_parameters response
+    //! @param root The parsed JSON response
+    //! @returns A vector with the names of all available parameters
+    static std::vector< std::string > parseParameterList(const Json::Value& root);
+    
+    //! Extract parameter values of a get_parameter response
+    //! @param root The parsed JSON response
+    //! @param names Parameter names
+    //! @returns The values of the given parameter names, arrays are joined by ", "
+    static std::map< std::string, std::string > parseParameters(const Json::Value& root, const std::vector< std::string >& names);
+    
 private:
     
     //! Send a HTTP-GET request to http_ip_ at http_port_
@@ -112,17 +164,15 @@ private:
     //! Send a sensor specific HTTP-Command
     //! @param cmd command name
     //! @param keys_values parameter->value map, which is encoded in the GET-request: ?p1=v1&p2=v2
-    bool sendHttpCommand(const std::string cmd, const std::map< std::string, std::string > param_values );
+    //! @param response The parsed JSON response
+    bool sendHttpCommand(const std::string cmd, const std::map< std::string, std::string > param_values, Json::Value& response );
     
     //! Send a sensor specific HTTP-Command with a single parameter
     //! @param cmd Command name
+    //! @param response The parsed JSON response
     //! @param param Parameter
     //! @param value Value
-    bool sendHttpCommand(const std::string cmd, const std::string param = "", const std::string value = "" );
-    
-    //! Check the error code and text of the returned JSON by the last request
-    //! @returns False in case of an error, True otherwise
-    bool checkErrorCode();
+    bool sendHttpCommand(const std::string cmd, Json::Value& response, const std::string param = "", const std::string value = "" );
     
     //! Scanner IP
     std::string http_host_;
@@ -130,12 +180,13 @@ private:
     //! Port of HTTP-Interface
     int http_port_;
     
-    //! Returned JSON as property_tree
-	Json::Reader jsonParser;
-	Json::Value root;
-	
-    //! HTTP-Status code of last request
-	int http_status_code_;
+    //! Request counters, written by all threads sending commands
+    MetricsCounter commands_;
+    MetricsCounter command_failures_;
+    MetricsHistogram command_latency_;
+    MetricsCounter watchdog_feeds_;
+    MetricsCounter watchdog_failures_;
+    MetricsHistogram watchdog_latency_;
 };
     
 }
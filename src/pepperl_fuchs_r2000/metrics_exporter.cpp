@@ -0,0 +1,498 @@
+//
+//  metrics_exporter.cpp
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	serves the driver metrics in the Prometheus text format over HTTP
+//	and pushes them to a StatsD server over UDP
+//
+
+#include "metrics_exporter.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+
+#include "Poco/ScopedLock.h"
+#include "Poco/Timespan.h"
+#include "Poco/Exception.h"
+#include "Poco/Net/StreamSocket.h"
+#include "Poco/Net/SocketAddress.h"
+
+namespace pepperl_fuchs {
+
+//! Time the export thread waits for a HTTP request or sleeps in milliseconds
+static const int EXPORT_POLL_INTERVAL = 100;
+
+//! Largest HTTP request read from a client
+static const std::size_t MAX_REQUEST_SIZE = 8192;
+
+//! Largest StatsD datagram, below the common MTU
+static const std::size_t MAX_DATAGRAM_SIZE = 1400;
+
+//-----------------------------------------------------------------------------
+//! Increment of a counter since the last push, the counter restarts with a new capture
+static uint64_t increment(uint64_t value, uint64_t last)
+{
+    return value >= last ? value - last : value;
+}
+
+//-----------------------------------------------------------------------------
+//! Replace all characters not allowed in metric names and StatsD buckets
+static std::string sanitize(const std::string& name)
+{
+    std::string result(name);
+    for( std::size_t i=0; i<result.size(); i++ )
+    {
+        const char c = result[i];
+        if( !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') )
+            result[i] = '_';
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//! Escape a Prometheus label value
+static std::string escapeLabel(const std::string& value)
+{
+    std::string result;
+    for( std::size_t i=0; i<value.size(); i++ )
+    {
+        if( value[i] == '\\' || value[i] == '"' )
+            result += '\\';
+        if( value[i] == '\n' )
+            result += "\\n";
+        else
+            result += value[i];
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//! Append a StatsD line "bucket:value|type"
+template<class T>
+static void addStatsD(std::vector<std::string>& lines, const std::string& bucket, T value, const char* type)
+{
+    std::ostringstream line;
+    line.precision(15);
+    line << bucket << ":" << value << "|" << type;
+    lines.push_back(line.str());
+}
+
+//-----------------------------------------------------------------------------
+MetricsExporter::MetricsExporter(const std::string& name)
+    : runnable_(*this, &MetricsExporter::run)
+{
+    labels_ = "scanner=\"" + escapeLabel(name) + "\"";
+    statsd_prefix_ = "r2000." + sanitize(name) + ".";
+    http_port_ = 0;
+    http_address_ = "127.0.0.1";
+    statsd_port_ = 0;
+    statsd_interval_ = 10.0;
+    health_port_ = 80;
+    health_interval_ = 10.0;
+    health_parameters_.push_back("temperature_current");
+    health_parameters_.push_back("load_indication");
+    health_parameters_.push_back("up_time");
+    has_metrics_ = false;
+    bytes_per_second_ = 0.0;
+    packets_per_second_ = 0.0;
+    scans_per_second_ = 0.0;
+    health_valid_ = false;
+    health_failures_ = 0;
+    running_ = false;
+    server_open_ = false;
+    statsd_open_ = false;
+}
+
+//-----------------------------------------------------------------------------
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::setHttpEndpoint(int port, const std::string& address)
+{
+    http_port_ = port;
+    http_address_ = address;
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::setStatsD(const std::string& host, int port, double interval)
+{
+    statsd_host_ = host;
+    statsd_port_ = port;
+    statsd_interval_ = interval;
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::setHealthSource(const std::string& http_host, int http_port, double interval)
+{
+    health_host_ = http_host;
+    health_port_ = http_port;
+    health_interval_ = interval;
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::setHealthParameters(const std::vector<std::string>& names)
+{
+    health_parameters_ = names;
+}
+
+//-----------------------------------------------------------------------------
+bool MetricsExporter::start()
+{
+    stop();
+
+    try
+    {
+        if( http_port_ > 0 )
+        {
+            server_ = Poco::Net::ServerSocket();
+            server_.bind(Poco::Net::SocketAddress(http_address_, http_port_), true);
+            server_.listen();
+            server_open_ = true;
+        }
+
+        if( statsd_port_ > 0 && !statsd_host_.empty() )
+        {
+            statsd_socket_ = Poco::Net::DatagramSocket();
+            statsd_socket_.connect(Poco::Net::SocketAddress(statsd_host_, statsd_port_));
+            statsd_open_ = true;
+        }
+    }
+    catch (Poco::Exception& exc)
+    {
+        std::cerr << "ERROR: Could not start metrics exporter: " << exc.displayText() << std::endl;
+        stop();
+        return false;
+    }
+
+    mutex_.lock();
+    running_ = true;
+    mutex_.unlock();
+
+    thread_.setPriority(Poco::Thread::PRIO_LOWEST);
+    thread_.start(runnable_);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::stop()
+{
+    mutex_.lock();
+    const bool was_running = running_;
+    running_ = false;
+    mutex_.unlock();
+
+    if( was_running )
+        thread_.join();
+
+    if( server_open_ )
+        server_.close();
+    if( statsd_open_ )
+        statsd_socket_.close();
+
+    server_open_ = false;
+    statsd_open_ = false;
+}
+
+//-----------------------------------------------------------------------------
+bool MetricsExporter::isRunning()
+{
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    return running_;
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::metricsUpdated(const ReceiverMetricsSnapshot& metrics)
+{
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+
+    const double seconds = metrics_time_.elapsed() / 1000000.0;
+    if( has_metrics_ && seconds > 0.0 )
+    {
+        bytes_per_second_ = increment(metrics.bytes_received, receiver_metrics_.bytes_received) / seconds;
+        packets_per_second_ = increment(metrics.packets_received, receiver_metrics_.packets_received) / seconds;
+        scans_per_second_ = increment(metrics.scans_received, receiver_metrics_.scans_received) / seconds;
+    }
+
+    receiver_metrics_ = metrics;
+    has_metrics_ = true;
+    metrics_time_.update();
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::commandMetricsUpdated(const CommandMetricsSnapshot& metrics)
+{
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    command_metrics_ = metrics;
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::run()
+{
+    Poco::Clock next_push;
+    Poco::Clock next_health;
+
+    while( isRunning() )
+    {
+        if( server_open_ )
+        {
+            try
+            {
+                if( server_.poll(Poco::Timespan(0, EXPORT_POLL_INTERVAL * 1000), Poco::Net::Socket::SELECT_READ) )
+                    serveRequest();
+            }
+            catch (Poco::Exception& exc)
+            {
+                std::cerr << "ERROR: Metrics request failed: " << exc.displayText() << std::endl;
+            }
+        }
+        else
+        {
+            Poco::Thread::sleep(EXPORT_POLL_INTERVAL);
+        }
+
+        if( statsd_open_ && next_push.elapsed() >= 0 )
+        {
+            next_push.update();
+            next_push += (Poco::Clock::ClockDiff)(statsd_interval_ * 1000000.0);
+            pushStatsD();
+        }
+
+        if( !health_host_.empty() && next_health.elapsed() >= 0 )
+        {
+            readHealth();
+            next_health.update();
+            next_health += (Poco::Clock::ClockDiff)(health_interval_ * 1000000.0);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::serveRequest()
+{
+    Poco::Net::StreamSocket client = server_.acceptConnection();
+    client.setReceiveTimeout(Poco::Timespan(1, 0));
+    client.setSendTimeout(Poco::Timespan(1, 0));
+
+    // read the request line and headers, the body of a GET request is ignored
+    std::string request;
+    char buffer[1024];
+    while( request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE )
+    {
+        int received = client.receiveBytes(buffer, sizeof(buffer));
+        if( received <= 0 )
+            break;
+        request.append(buffer, received);
+    }
+
+    std::string status = "404 Not Found";
+    std::string body = "Metrics are served at /metrics\n";
+    if( request.compare(0, 12, "GET /metrics") == 0 && request.size() > 12 && (request[12] == ' ' || request[12] == '?') )
+    {
+        status = "200 OK";
+        body = formatPrometheus();
+    }
+
+    std::ostringstream response;
+    response << "HTTP/1.0 " << status << "\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "Connection: close\r\n\r\n"
+             << body;
+
+    const std::string data = response.str();
+    std::size_t sent = 0;
+    while( sent < data.size() )
+    {
+        int count = client.sendBytes(data.data() + sent, (int)(data.size() - sent));
+        if( count <= 0 )
+            break;
+        sent += count;
+    }
+
+    client.close();
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::writeValue(std::ostream& out, const char* name, const char* type, double value)
+{
+    out << "# TYPE " << name << " " << type << "\n"
+        << name << "{" << labels_ << "} " << value << "\n";
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::writeHistogram(std::ostream& out, const char* name, const HistogramSnapshot& histogram)
+{
+    out << "# TYPE " << name << " histogram\n";
+
+    // buckets up to the largest used one, bucket i holds values up to 2^i - 1
+    std::size_t last = 0;
+    for( std::size_t i=0; i<METRICS_HISTOGRAM_BUCKETS - 1; i++ )
+    {
+        if( histogram.buckets[i] > 0 )
+            last = i;
+    }
+
+    uint64_t cumulative = 0;
+    for( std::size_t i=0; i<=last; i++ )
+    {
+        cumulative += histogram.buckets[i];
+        out << name << "_bucket{" << labels_ << ",le=\"" << (((uint64_t)1 << i) - 1) << "\"} " << cumulative << "\n";
+    }
+    out << name << "_bucket{" << labels_ << ",le=\"+Inf\"} " << histogram.count << "\n"
+        << name << "_sum{" << labels_ << "} " << histogram.sum << "\n"
+        << name << "_count{" << labels_ << "} " << histogram.count << "\n";
+}
+
+//-----------------------------------------------------------------------------
+std::string MetricsExporter::formatPrometheus()
+{
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+
+    const ReceiverMetricsSnapshot& r = receiver_metrics_;
+    const CommandMetricsSnapshot& c = command_metrics_;
+
+    std::ostringstream out;
+    out.precision(15);
+
+    writeValue(out, "r2000_metrics_age_seconds", "gauge", has_metrics_ ? metrics_time_.elapsed() / 1000000.0 : -1.0);
+    writeValue(out, "r2000_received_bytes_total", "counter", (double)r.bytes_received);
+    writeValue(out, "r2000_received_packets_total", "counter", (double)r.packets_received);
+    writeValue(out, "r2000_invalid_packets_total", "counter", (double)r.invalid_packets);
+    writeValue(out, "r2000_resync_bytes_total", "counter", (double)r.resync_bytes);
+    writeValue(out, "r2000_received_scans_total", "counter", (double)r.scans_received);
+    writeValue(out, "r2000_lost_scans_total", "counter", (double)r.scans_lost);
+    writeValue(out, "r2000_lost_packets_total", "counter", (double)r.packets_lost);
+    writeValue(out, "r2000_out_of_order_packets_total", "counter", (double)r.packets_out_of_order);
+    writeValue(out, "r2000_dropped_scans_total", "counter", (double)r.scans_dropped);
+    writeValue(out, "r2000_received_bytes_per_second", "gauge", bytes_per_second_);
+    writeValue(out, "r2000_received_packets_per_second", "gauge", packets_per_second_);
+    writeValue(out, "r2000_received_scans_per_second", "gauge", scans_per_second_);
+    writeValue(out, "r2000_status_flags", "gauge", (double)r.status_flags);
+    writeValue(out, "r2000_status_flags_seen", "gauge", (double)r.status_flags_seen);
+    writeHistogram(out, "r2000_packet_decode_nanoseconds", r.decode_time_ns);
+    writeHistogram(out, "r2000_scan_latency_microseconds", r.scan_latency_us);
+
+    writeValue(out, "r2000_http_commands_total", "counter", (double)c.commands);
+    writeValue(out, "r2000_http_command_failures_total", "counter", (double)c.command_failures);
+    writeHistogram(out, "r2000_http_command_latency_microseconds", c.command_latency_us);
+    writeValue(out, "r2000_watchdog_feeds_total", "counter", (double)c.watchdog_feeds);
+    writeValue(out, "r2000_watchdog_feed_failures_total", "counter", (double)c.watchdog_failures);
+    writeHistogram(out, "r2000_watchdog_feed_latency_microseconds", c.watchdog_latency_us);
+
+    if( !health_host_.empty() )
+    {
+        writeValue(out, "r2000_parameter_read_failures_total", "counter", (double)health_failures_);
+        writeValue(out, "r2000_parameters_valid", "gauge", health_valid_ ? 1.0 : 0.0);
+
+        if( !health_values_.empty() )
+            out << "# TYPE r2000_parameter gauge\n";
+        for( std::map<std::string, double>::const_iterator p = health_values_.begin(); p != health_values_.end(); p++ )
+            out << "r2000_parameter{" << labels_ << ",name=\"" << escapeLabel(p->first) << "\"} " << p->second << "\n";
+    }
+
+    return out.str();
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::pushStatsD()
+{
+    std::vector<std::string> lines;
+    {
+        Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+
+        const ReceiverMetricsSnapshot& r = receiver_metrics_;
+        const ReceiverMetricsSnapshot& pr = pushed_receiver_metrics_;
+        const CommandMetricsSnapshot& c = command_metrics_;
+        const CommandMetricsSnapshot& pc = pushed_command_metrics_;
+
+        addStatsD(lines, statsd_prefix_ + "received_bytes", increment(r.bytes_received, pr.bytes_received), "c");
+        addStatsD(lines, statsd_prefix_ + "received_packets", increment(r.packets_received, pr.packets_received), "c");
+        addStatsD(lines, statsd_prefix_ + "invalid_packets", increment(r.invalid_packets, pr.invalid_packets), "c");
+        addStatsD(lines, statsd_prefix_ + "resync_bytes", increment(r.resync_bytes, pr.resync_bytes), "c");
+        addStatsD(lines, statsd_prefix_ + "received_scans", increment(r.scans_received, pr.scans_received), "c");
+        addStatsD(lines, statsd_prefix_ + "lost_scans", increment(r.scans_lost, pr.scans_lost), "c");
+        addStatsD(lines, statsd_prefix_ + "lost_packets", increment(r.packets_lost, pr.packets_lost), "c");
+        addStatsD(lines, statsd_prefix_ + "out_of_order_packets", increment(r.packets_out_of_order, pr.packets_out_of_order), "c");
+        addStatsD(lines, statsd_prefix_ + "dropped_scans", increment(r.scans_dropped, pr.scans_dropped), "c");
+        addStatsD(lines, statsd_prefix_ + "received_bytes_per_second", bytes_per_second_, "g");
+        addStatsD(lines, statsd_prefix_ + "received_scans_per_second", scans_per_second_, "g");
+        addStatsD(lines, statsd_prefix_ + "status_flags", r.status_flags, "g");
+        addStatsD(lines, statsd_prefix_ + "packet_decode_ns.mean", r.decode_time_ns.mean(), "g");
+        addStatsD(lines, statsd_prefix_ + "packet_decode_ns.p99", r.decode_time_ns.quantile(0.99), "g");
+        addStatsD(lines, statsd_prefix_ + "packet_decode_ns.max", r.decode_time_ns.max, "g");
+        addStatsD(lines, statsd_prefix_ + "scan_latency_us.mean", r.scan_latency_us.mean(), "g");
+        addStatsD(lines, statsd_prefix_ + "scan_latency_us.p99", r.scan_latency_us.quantile(0.99), "g");
+        addStatsD(lines, statsd_prefix_ + "http_commands", increment(c.commands, pc.commands), "c");
+        addStatsD(lines, statsd_prefix_ + "http_command_failures", increment(c.command_failures, pc.command_failures), "c");
+        addStatsD(lines, statsd_prefix_ + "http_command_latency_us.mean", c.command_latency_us.mean(), "g");
+        addStatsD(lines, statsd_prefix_ + "watchdog_feeds", increment(c.watchdog_feeds, pc.watchdog_feeds), "c");
+        addStatsD(lines, statsd_prefix_ + "watchdog_feed_failures", increment(c.watchdog_failures, pc.watchdog_failures), "c");
+        addStatsD(lines, statsd_prefix_ + "watchdog_feed_latency_us.max", c.watchdog_latency_us.max, "g");
+
+        for( std::map<std::string, double>::const_iterator p = health_values_.begin(); p != health_values_.end(); p++ )
+            addStatsD(lines, statsd_prefix_ + "parameter." + sanitize(p->first), p->second, "g");
+
+        pushed_receiver_metrics_ = r;
+        pushed_command_metrics_ = c;
+    }
+
+    // several lines per datagram
+    std::string datagram;
+    for( std::size_t i=0; i<=lines.size(); i++ )
+    {
+        if( i == lines.size() || (!datagram.empty() && datagram.size() + 1 + lines[i].size() > MAX_DATAGRAM_SIZE) )
+        {
+            try
+            {
+                if( !datagram.empty() )
+                    statsd_socket_.sendBytes(datagram.data(), (int)datagram.size());
+            }
+            catch (Poco::Exception& exc)
+            {
+                std::cerr << "ERROR: Sending metrics to StatsD failed: " << exc.displayText() << std::endl;
+                return;
+            }
+            datagram.clear();
+        }
+
+        if( i < lines.size() )
+        {
+            if( !datagram.empty() )
+                datagram += "\n";
+            datagram += lines[i];
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void MetricsExporter::readHealth()
+{
+    // a separate connection, blocking this thread only
+    HttpCommandInterface command_interface(health_host_, health_port_);
+    std::map<std::string, std::string> values = command_interface.getParameters(health_parameters_);
+
+    std::map<std::string, double> numeric;
+    for( std::map<std::string, std::string>::const_iterator p = values.begin(); p != values.end(); p++ )
+    {
+        const char* begin = p->second.c_str();
+        char* end = 0;
+        double value = std::strtod(begin, &end);
+        if( end != begin )
+            numeric[p->first] = value;
+    }
+
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    health_valid_ = !numeric.empty();
+    if( numeric.empty() )
+        health_failures_++;
+    else
+        health_values_ = numeric;
+}
+
+}
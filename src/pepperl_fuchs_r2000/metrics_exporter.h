@@ -0,0 +1,151 @@
+//
+//  metrics_exporter.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	serves the driver metrics in the Prometheus text format over HTTP
+//	and pushes them to a StatsD server over UDP
+//
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+#include "Poco/Thread.h"
+#include "Poco/RunnableAdapter.h"
+#include "Poco/Mutex.h"
+#include "Poco/Clock.h"
+#include "Poco/Net/ServerSocket.h"
+#include "Poco/Net/DatagramSocket.h"
+
+#include "receiver_metrics.h"
+#include "http_command_interface.h"
+
+namespace pepperl_fuchs {
+
+//! \class MetricsExporter
+//! \brief Exports the receiver and HTTP command metrics of a R2000Driver
+//! Register it with R2000Driver::setMetricsListener(), the supervisor thread then only copies the snapshots.
+//! Formatting, serving, pushing and reading scanner parameters happen on an own thread with the lowest priority.
+//! Reading parameters uses an own HTTP connection, so a slow scanner delays the export but never the capture.
+class MetricsExporter : public MetricsListener
+{
+public:
+    //! @param name Value of the scanner label in Prometheus and part of the StatsD prefix "r2000.<name>."
+    MetricsExporter(const std::string& name = "r2000");
+
+    //! Stop the export thread
+    virtual ~MetricsExporter();
+
+    //! Serve the metrics at http://address:port/metrics with the next start()
+    //! @param port TCP port, 0 disables the endpoint
+    //! @param address Local address to listen at, "0.0.0.0" for all interfaces
+    void setHttpEndpoint(int port, const std::string& address = "127.0.0.1");
+
+    //! Push the metrics to a StatsD server after start(), counters as increments and everything else as gauges
+    //! @param port UDP port, 0 disables pushing
+    //! @param interval Time in seconds between two pushes
+    void setStatsD(const std::string& host, int port = 8125, double interval = 10.0);
+
+    //! Read numeric scanner parameters like the temperature after start() and export them as r2000_parameter
+    //! @param http_host HTTP host of the scanner like passed to R2000Driver::connect(), empty disables reading
+    //! @param interval Time in seconds between two reads
+    void setHealthSource(const std::string& http_host, int http_port = 80, double interval = 10.0);
+
+    //! Names of the parameters read from the health source
+    //! Defaults to temperature_current, load_indication and up_time
+    void setHealthParameters(const std::vector<std::string>& names);
+
+    //! Open the HTTP endpoint and the StatsD socket and start the export thread
+    //! @returns False if a socket could not be opened
+    bool start();
+
+    //! Stop the export thread and close all sockets
+    void stop();
+
+    //! Return if the export thread is running
+    bool isRunning();
+
+    //! Format the current metrics in the Prometheus text exposition format
+    std::string formatPrometheus();
+
+    //! Copy the receiver metrics, called by the driver
+    virtual void metricsUpdated(const ReceiverMetricsSnapshot& metrics);
+
+    //! Copy the HTTP command metrics, called by the driver
+    virtual void commandMetricsUpdated(const CommandMetricsSnapshot& metrics);
+
+private:
+    //! Export loop, runs on thread_
+    void run();
+
+    //! Answer one request of the HTTP endpoint
+    void serveRequest();
+
+    //! Send all metrics to the StatsD server
+    void pushStatsD();
+
+    //! Read the health parameters from the scanner
+    void readHealth();
+
+    //! Write a counter or gauge with its type line
+    void writeValue(std::ostream& out, const char* name, const char* type, double value);
+
+    //! Write a histogram with cumulative buckets
+    void writeHistogram(std::ostream& out, const char* name, const HistogramSnapshot& histogram);
+
+    //! Configuration, changed while the thread is stopped only
+    std::string labels_;
+    std::string statsd_prefix_;
+    int http_port_;
+    std::string http_address_;
+    std::string statsd_host_;
+    int statsd_port_;
+    double statsd_interval_;
+    std::string health_host_;
+    int health_port_;
+    double health_interval_;
+    std::vector<std::string> health_parameters_;
+
+    //! Last metrics passed by the driver
+    ReceiverMetricsSnapshot receiver_metrics_;
+    CommandMetricsSnapshot command_metrics_;
+    bool has_metrics_;
+    Poco::Clock metrics_time_;
+
+    //! Receive rates between the last two updates
+    double bytes_per_second_;
+    double packets_per_second_;
+    double scans_per_second_;
+
+    //! Numeric health parameters of the last successful read
+    std::map<std::string, double> health_values_;
+    bool health_valid_;
+    uint64_t health_failures_;
+
+    //! Counters at the last StatsD push, counters are pushed as increments
+    ReceiverMetricsSnapshot pushed_receiver_metrics_;
+    CommandMetricsSnapshot pushed_command_metrics_;
+
+    //! Export thread, Poco::Thread also with C++11 to set its priority
+    Poco::Thread thread_;
+    Poco::RunnableAdapter<MetricsExporter> runnable_;
+    bool running_;
+
+    Poco::Net::ServerSocket server_;
+    bool server_open_;
+    Poco::Net::DatagramSocket statsd_socket_;
+    bool statsd_open_;
+
+    //! Protection of the metrics and running_ between the driver, the export thread and the user
+    Poco::FastMutex mutex_;
+};
+
+}
+
+#endif // METRICS_EXPORTER_H
@@ -15,6 +15,11 @@
 
 namespace pepperl_fuchs {
 
+//! Values of PacketHeader::packet_type
+static const std::tr1::uint16_t PACKET_TYPE_A = 0x0041;
+static const std::tr1::uint16_t PACKET_TYPE_B = 0x0042;
+static const std::tr1::uint16_t PACKET_TYPE_C = 0x0043;
+
 #pragma pack(1)
 //! \struct PacketHeader
 //! \brief Header of a TCP or UDP data packet from the scanner
@@ -23,7 +28,7 @@ struct PacketHeader
     //! Magic bytes, must be  5C A2 (hex)
     std::tr1::uint16_t magic;
 
-    //! Packet type, must be 43 00 (hex)
+    //! Packet type, 41 00, 42 00 or 43 00 (hex) for packet type A, B or C
     std::tr1::uint16_t packet_type;
 
     //! Overall packet size (header+payload), 1404 bytes with maximum payload
@@ -75,6 +80,23 @@ struct PacketHeader
     //std::uint8 padding[0];
 };
 
+//! \struct PacketTypeA
+//! \brief Structure of a UDP or TCP data packet with distances only
+struct PacketTypeA
+{
+    PacketHeader header;
+    std::tr1::uint32_t distance_payload; // distance 32 bit, 0xFFFFFFFF for invalid samples
+};
+
+//! \struct PacketTypeB
+//! \brief Structure of a UDP or TCP data packet with distances and amplitudes, 6 bytes per sample
+struct PacketTypeB
+{
+    PacketHeader header;
+    std::tr1::uint32_t distance_payload; // distance 32 bit, 0xFFFFFFFF for invalid samples
+    std::tr1::uint16_t amplitude_payload; // amplitude 16 bit
+};
+
 //! \struct PacketTypeC
 //! \brief Structure of a UDP or TCP data packet from the laserscanner
 struct PacketTypeC
@@ -88,14 +110,22 @@ struct PacketTypeC
 //! \brief Normally contains one complete laserscan (a full rotation of the scanner head)
 struct ScanData
 {
+    ScanData() : follows_gap(false) {}
+
     //! Distance data in polar form in millimeter
     std::vector<std::tr1::uint32_t> distance_data;
 
-    //! Amplitude data in the range 32-4095, values lower than 32 indicate an error or undefined values
+    //! Amplitude data in the range 32-4095, values lower than 32 indicate an error or undefined values, empty for packet type A
     std::vector<std::tr1::uint32_t> amplitude_data;
 
     //! Header received with the distance and amplitude data
     std::vector<PacketHeader> headers;
+
+    //! Host time of each header in microseconds (Poco::Clock::raw()), estimated from timestamp_raw by the ClockSynchronizer
+    std::vector<std::tr1::int64_t> host_times;
+
+    //! True if data was lost right before this scan, e.g. while the connection was re-established
+    bool follows_gap;
 };
 
 }
@@ -60,6 +60,9 @@ struct HandleInfo
     //! Start angle of scan in 1/10000°, defaults to -1800000
     int start_angle;
 
+    //! Maximum number of samples sent per scan, 0 if not limited
+    int max_num_points_scan;
+
     //! If watchdog is enabled, it has to be fed otherwise scanner closes the connection after timeout
     bool watchdog_enabled;
 
@@ -34,6 +34,7 @@
 
 
 #include <ctime>
+#include <cstdlib>
 #include <algorithm>
 #include "r2000_driver.h"
 #include "http_command_interface.h"
@@ -41,50 +42,128 @@
 #include "scan_data_receiver.h"
 #include "scan_data_receiver_udp.h"
 #include "scan_data_receiver_tcp.h"
+#include "trace.h"
 
 #include "Poco/NumberFormatter.h"
+#include "Poco/Clock.h"
+
+#if __cplusplus>=201103
+	#include <chrono>
+#endif
 
 
 namespace pepperl_fuchs
 {
+	//! Backoff between reconnection attempts in seconds
+	static const double RECONNECT_BACKOFF_MIN = 0.5;
+	static const double RECONNECT_BACKOFF_MAX = 30.0;
+	
+	//! Polling interval of the supervisor in milliseconds
+	static const int SUPERVISOR_INTERVAL = 100;
 
 	R2000Driver::R2000Driver()
+#if __cplusplus<201103
+		: parameter_runnable_(*this, &R2000Driver::fetchParameters)
+		, supervisor_runnable_(*this, &R2000Driver::superviseCapture)
+#endif
 	{
 		command_interface_ = 0;
 		data_receiver_ = 0;
 		is_connected_ = false;
 		is_capturing_ = false;
 		watchdog_feed_time_ = 0;
+		parameter_fetch_pending_ = false;
+		capture_handle_type_ = HandleInfo::HANDLE_TYPE_TCP;
+		compact_output_ = false;
+		latest_output_ = false;
+		scan_sink_ = 0;
+		scan_sink_only_ = false;
+		roi_enabled_ = false;
+		roi_start_angle_ = -1800000;
+		roi_end_angle_ = -1800000;
+		decimation_ = 1;
+		queue_policy_ = SCAN_QUEUE_DROP_OLDEST;
+		queue_capacity_ = SCAN_QUEUE_DEFAULT_CAPACITY;
+		packet_type_ = 'C';
+		handle_start_angle_ = -1800000;
+		handle_max_num_points_scan_ = 0;
+		auto_reconnect_ = false;
+		silence_timeout_ = 2.0;
+		reconnect_count_ = 0;
+		metrics_listener_ = 0;
+		metrics_interval_ = 1.0;
+		supervisor_running_ = false;
 	}
 
 	//-----------------------------------------------------------------------------
-	bool R2000Driver::connect(const std::string hostname, int port)
+	bool R2000Driver::connect(const std::string hostname, int port, bool wait_for_parameters)
 	{
 //		std::cout << "connect to: " << hostname << std::endl;
 		
+		// a pending fetch uses the current command interface, joining it also makes the thread reusable
+		waitForParameters();
+		
+		// already connected: release the capture and the old command interface
+		if (command_interface_)
+			disconnect();
+		
 		command_interface_ = new HttpCommandInterface(hostname, port);
 		
+		// request the parameter dump while checking the protocol info
+		parameter_fetch_pending_ = true;
+#if __cplusplus>=201103
+		parameter_thread_ = std::thread(&R2000Driver::fetchParameters, this);
+#else
+		parameter_thread_.start(parameter_runnable_);
+#endif
+		
 		Poco::Optional<ProtocolInfo> opi = command_interface_->getProtocolInfo();
 		
 		if (!opi.isSpecified() ||
 			(opi.value()).version_major != 1)
 		{
+			waitForParameters();
+			parameters_ = std::map< std::string, std::string >();
 			std::cerr << "ERROR: Could not connect to laser range finder!" << std::endl;
 			return false;
 		}
 
 		if (opi.value().version_major != 1 )
 		{
+			waitForParameters();
+			parameters_ = std::map< std::string, std::string >();
 			std::cerr << "ERROR: Wrong protocol version (version_major=" << (opi.value()).version_major << ", version_minor=" << (opi.value()).version_minor << ")" << std::endl;
 			return false;
 		}
 		
-		protocol_info_ = opi.value();    
-		parameters_ = command_interface_->getParameters(command_interface_->getParameterList());
+		protocol_info_ = opi.value();
 		is_connected_ = true;
+		
+		if (wait_for_parameters)
+			waitForParameters();
+		
 		return true;
 	}
 
+	//-----------------------------------------------------------------------------
+	void R2000Driver::fetchParameters()
+	{
+		fetched_parameters_ = command_interface_->getParameters(command_interface_->getParameterList());
+	}
+
+	//-----------------------------------------------------------------------------
+	void R2000Driver::waitForParameters()
+	{
+		if (!parameter_fetch_pending_)
+			return;
+		
+		parameter_thread_.join();
+		parameter_fetch_pending_ = false;
+		
+		parameters_.swap(fetched_parameters_);
+		fetched_parameters_.clear();
+	}
+
 	//-----------------------------------------------------------------------------
 	R2000Driver::~R2000Driver()
 	{
@@ -94,20 +173,25 @@ namespace pepperl_fuchs
 	//-----------------------------------------------------------------------------
 	bool R2000Driver::startCapturingTCP()
 	{
-		if(!checkConnection()) {
+		if(!checkSession()) {
 			return false;
 		}
 
+		// the supervisor uses the receiver
+		stopSupervisor();
+		
 		if (data_receiver_) {
 			delete data_receiver_;
 			data_receiver_ = 0;
 		}
 		
-		handle_info_ = command_interface_->requestHandleTCP();
+		prepareHandleParameters();
+		handle_info_ = requestHandle(HandleInfo::HANDLE_TYPE_TCP);
 		if( !handle_info_.isSpecified() )
 			return false;
 
 		data_receiver_ = (ScanDataReceiver*)new ScanDataReceiverTCP(handle_info_.value().hostname, handle_info_.value().port);
+		configureReceiver();
 		
 		if(!data_receiver_->isConnected() ||
 		   !command_interface_->startScanOutput(handle_info_.value().handle))
@@ -117,32 +201,37 @@ namespace pepperl_fuchs
 
 		
 		food_timeout_ = floor(std::max((handle_info_.value().watchdog_timeout/1000.0/3.0),1.0));
+		capture_handle_type_ = HandleInfo::HANDLE_TYPE_TCP;
 		is_capturing_ = true;
+		reconnect_count_ = 0;
+		startSupervisor();
 		return true;
 	}
 
 	//-----------------------------------------------------------------------------
 	bool R2000Driver::startCapturingUDP()
 	{
-		if (!checkConnection()) {
+		if (!checkSession()) {
 			return false;
 		}
 
+		// the supervisor uses the receiver
+		stopSupervisor();
+		
 		if (data_receiver_) {
 			delete data_receiver_;
 			data_receiver_ = 0;
 		}
 		
 		data_receiver_ = (ScanDataReceiver*)new ScanDataReceiverUDP();
+		configureReceiver();
 		
 		if (!data_receiver_->isConnected()) {
 			return false;
 		}
 		
-		// get udp port
-		int udp_port = ((ScanDataReceiverUDP*)data_receiver_)->getUDPPort();
-		
-		handle_info_ = command_interface_->requestHandleUDP(udp_port);
+		prepareHandleParameters();
+		handle_info_ = requestHandle(HandleInfo::HANDLE_TYPE_UDP);
 		
 		if (!handle_info_.isSpecified() ||
 			!command_interface_->startScanOutput(handle_info_.value().handle))
@@ -151,7 +240,10 @@ namespace pepperl_fuchs
 		}
 
 		food_timeout_ = std::floor(std::max((handle_info_.value().watchdog_timeout/1000.0/3.0),1.0));
+		capture_handle_type_ = HandleInfo::HANDLE_TYPE_UDP;
 		is_capturing_ = true;
+		reconnect_count_ = 0;
+		startSupervisor();
 		return true;
 	}
 
@@ -161,7 +253,9 @@ namespace pepperl_fuchs
 		if( !is_capturing_ || !command_interface_ )
 			return false;
 
-		bool return_val = checkConnection();
+		stopSupervisor();
+
+		bool return_val = checkSession();
 
 		// safety
 		if (data_receiver_) {
@@ -169,6 +263,8 @@ namespace pepperl_fuchs
 			data_receiver_ = 0;
 		}
 		
+		// a failed reconnect can leave the driver capturing without a handle
+		return_val = return_val && handle_info_.isSpecified();
 		return_val = return_val && command_interface_->stopScanOutput(handle_info_.value().handle);
 
 		is_capturing_ = false;
@@ -188,9 +284,21 @@ namespace pepperl_fuchs
 		return true;
 	}
 
+	//-----------------------------------------------------------------------------
+	bool R2000Driver::checkSession()
+	{
+		if( !command_interface_ || !isConnected() )
+		{
+			std::cerr << "ERROR: No connection to laser range finder or connection lost!" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
 	//-----------------------------------------------------------------------------
 	ScanData R2000Driver::getScan()
 	{
+		R2000_TRACE_SCOPE("driver getScan");
 		feedWatchdog();
 		
 		if( data_receiver_ )
@@ -203,6 +311,226 @@ namespace pepperl_fuchs
 		return ScanData();
 	}
 
+	//-----------------------------------------------------------------------------
+	CompactScanData R2000Driver::getCompactScan()
+	{
+		R2000_TRACE_SCOPE("driver getCompactScan");
+		feedWatchdog();
+		
+		if( data_receiver_ )
+			return data_receiver_->getCompactScan();
+		
+		std::cerr << "ERROR: No scan capturing started!" << std::endl;
+		return CompactScanData();
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::setCompactOutput(bool compact)
+	{
+		compact_output_ = compact;
+		
+		if( data_receiver_ )
+			data_receiver_->setCompactOutput(compact);
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::setLatestScanOutput(bool latest)
+	{
+		latest_output_ = latest;
+		
+		if( data_receiver_ )
+			data_receiver_->setLatestScanOutput(latest);
+	}
+	
+	//-----------------------------------------------------------------------------
+	bool R2000Driver::fetchLatestScan()
+	{
+		return data_receiver_ && data_receiver_->fetchLatestScan();
+	}
+	
+	//-----------------------------------------------------------------------------
+	const ScanData& R2000Driver::getLatestScan() const
+	{
+		static const ScanData empty;
+		return data_receiver_ ? data_receiver_->getLatestScan() : empty;
+	}
+	
+	//-----------------------------------------------------------------------------
+	bool R2000Driver::fetchLatestCompactScan()
+	{
+		return data_receiver_ && data_receiver_->fetchLatestCompactScan();
+	}
+	
+	//-----------------------------------------------------------------------------
+	const CompactScanData& R2000Driver::getLatestCompactScan() const
+	{
+		static const CompactScanData empty;
+		return data_receiver_ ? data_receiver_->getLatestCompactScan() : empty;
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::setScanSink(ScanSink* sink, bool sink_only)
+	{
+		scan_sink_ = sink;
+		scan_sink_only_ = sink_only;
+		
+		if( data_receiver_ )
+			data_receiver_->setScanSink(sink, sink_only);
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::setRegionOfInterest(int start_angle, int end_angle)
+	{
+		roi_enabled_ = true;
+		roi_start_angle_ = start_angle;
+		roi_end_angle_ = end_angle;
+		
+		if( data_receiver_ )
+			data_receiver_->setRegionOfInterest(start_angle, end_angle);
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::clearRegionOfInterest()
+	{
+		roi_enabled_ = false;
+		
+		if( data_receiver_ )
+			data_receiver_->clearRegionOfInterest();
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::setDecimation(unsigned int factor)
+	{
+		decimation_ = std::max(1u, factor);
+		
+		if( data_receiver_ )
+			data_receiver_->setDecimation(decimation_);
+	}
+	
+	//-----------------------------------------------------------------------------
+	bool R2000Driver::setQueuePolicy(ScanQueuePolicy policy, std::size_t capacity)
+	{
+		if( policy == SCAN_QUEUE_BLOCK_PRODUCER )
+		{
+			std::cerr << "ERROR: The scan data receiver can not block, use SCAN_QUEUE_DROP_OLDEST or SCAN_QUEUE_DROP_NEWEST" << std::endl;
+			return false;
+		}
+		
+		queue_policy_ = policy;
+		queue_capacity_ = std::max<std::size_t>(1, capacity);
+		
+		if( data_receiver_ )
+			data_receiver_->setQueuePolicy(queue_policy_, queue_capacity_);
+		return true;
+	}
+	
+	//-----------------------------------------------------------------------------
+	ScanQueueCounters R2000Driver::getQueueCounters()
+	{
+		if( !data_receiver_ )
+			return ScanQueueCounters();
+		
+		return data_receiver_->getQueueCounters();
+	}
+	
+	//-----------------------------------------------------------------------------
+	bool R2000Driver::setPacketType(char packet_type)
+	{
+		if( packet_type != 'A' && packet_type != 'B' && packet_type != 'C' )
+		{
+			std::cerr << "ERROR: Unknown packet type " << packet_type << ", use A, B or C" << std::endl;
+			return false;
+		}
+		
+		packet_type_ = packet_type;
+		return true;
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::configureReceiver()
+	{
+		data_receiver_->setCompactOutput(compact_output_);
+		data_receiver_->setLatestScanOutput(latest_output_);
+		data_receiver_->setScanSink(scan_sink_, scan_sink_only_);
+		data_receiver_->setDecimation(decimation_);
+		data_receiver_->setQueuePolicy(queue_policy_, queue_capacity_);
+		
+		if( roi_enabled_ )
+			data_receiver_->setRegionOfInterest(roi_start_angle_, roi_end_angle_);
+		else
+			data_receiver_->clearRegionOfInterest();
+	}
+	
+	//-----------------------------------------------------------------------------
+	void R2000Driver::prepareHandleParameters()
+	{
+		handle_start_angle_ = -1800000;
+		handle_max_num_points_scan_ = 0;
+		
+		if( !roi_enabled_ )
+			return;
+		
+		// let the scan start at the sector, in the range [-1800000,1800000)
+		const int full = 3600000;
+		handle_start_angle_ = ((roi_start_angle_ + 1800000) % full + full) % full - 1800000;
+		
+		// samples covering the sector, needs the samples per scan of the cached parameters
+		waitForParameters();
+		std::map< std::string, std::string >::const_iterator it = parameters_.find("samples_per_scan");
+		if( it == parameters_.end() )
+			return;
+		
+		const long samples_per_scan = atol(it->second.c_str());
+		int width = ((roi_end_angle_ - roi_start_angle_) % full + full) % full;
+		if( width == 0 )
+			width = full;
+		
+		const long num_points = (long)((double)width * samples_per_scan / full) + 1;
+		if( samples_per_scan > 0 && num_points < samples_per_scan )
+			handle_max_num_points_scan_ = (int)num_points;
+	}
+	
+	//-----------------------------------------------------------------------------
+	Poco::Optional<HandleInfo> R2000Driver::requestHandle(int handle_type)
+	{
+		Poco::Optional<HandleInfo> handle_info;
+		int max_num_points_scan = handle_max_num_points_scan_;
+		
+		// the first try sends max_num_points_scan, older firmware rejects it
+		for( int attempt=0; attempt<2 && !handle_info.isSpecified(); attempt++ )
+		{
+			if( handle_type == HandleInfo::HANDLE_TYPE_TCP )
+				handle_info = command_interface_->requestHandleTCP(handle_start_angle_, max_num_points_scan, packet_type_);
+			else
+				handle_info = command_interface_->requestHandleUDP(((ScanDataReceiverUDP*)data_receiver_)->getUDPPort(), std::string(""), handle_start_angle_, max_num_points_scan, packet_type_);
+			
+			if( max_num_points_scan == 0 )
+				break;
+			
+			max_num_points_scan = 0;
+		}
+		
+		return handle_info;
+	}
+	
+	//-----------------------------------------------------------------------------
+	int64_t R2000Driver::toHostTime(uint64_t timestamp_raw)
+	{
+		if( data_receiver_ )
+			return data_receiver_->toHostTime(timestamp_raw);
+		
+		return 0;
+	}
+	
+	//-----------------------------------------------------------------------------
+	ClockSynchronizer R2000Driver::getClockSynchronizer()
+	{
+		if( data_receiver_ )
+			return data_receiver_->getClockSynchronizer();
+		
+		return ClockSynchronizer();
+	}
+
 
 	//-----------------------------------------------------------------------------
 	std::size_t R2000Driver::getScansAvailable() const
@@ -231,9 +559,13 @@ namespace pepperl_fuchs
 	//-----------------------------------------------------------------------------
 	void R2000Driver::disconnect()
 	{
-		if( isCapturing() )
+		// also while the receiver is disconnected and the supervisor is reconnecting, the handle has to be released
+		if( is_capturing_ )
 			stopCapturing();
 
+		stopSupervisor();
+		waitForParameters();
+
 		if (data_receiver_)
 			delete data_receiver_;
 		
@@ -261,11 +593,20 @@ namespace pepperl_fuchs
 	//-----------------------------------------------------------------------------
 	const std::map< std::string, std::string >& R2000Driver::getParameters()
 	{
+		waitForParameters();
+		
 		if( command_interface_ )
 			parameters_ = command_interface_->getParameters(command_interface_->getParameterList());
 		return parameters_;
 	}
 
+	//-----------------------------------------------------------------------------
+	const std::map< std::string, std::string >& R2000Driver::getParametersCached()
+	{
+		waitForParameters();
+		return parameters_;
+	}
+
 	//-----------------------------------------------------------------------------
 	bool R2000Driver::setScanFrequency(unsigned int frequency)
 	{
@@ -309,17 +650,224 @@ namespace pepperl_fuchs
 
 	//-----------------------------------------------------------------------------
 	void R2000Driver::feedWatchdog(bool feed_always)
+	{
+		// while the supervisor is reconnecting it takes care of the watchdog
+#if __cplusplus>=201103
+		std::unique_lock<std::recursive_mutex> lock(driver_mutex_, std::try_to_lock);
+		if (!lock.owns_lock())
+			return;
+		
+		feedWatchdogLocked(feed_always);
+#else
+		if (!driver_mutex_.tryLock())
+			return;
+		
+		feedWatchdogLocked(feed_always);
+		driver_mutex_.unlock();
+#endif
+	}
+
+	//-----------------------------------------------------------------------------
+	void R2000Driver::feedWatchdogLocked(bool feed_always)
 	{
 		const double current_time = std::time(0);
 
 		if( (feed_always || watchdog_feed_time_<(current_time-food_timeout_)) && handle_info_.isSpecified() && command_interface_  )
 		{
+			R2000_TRACE_SCOPE("feedWatchdog");
 			if( !command_interface_->feedWatchdog(handle_info_.value().handle) )
 				std::cerr << "ERROR: Feeding watchdog failed!" << std::endl;
 			watchdog_feed_time_ = current_time;
 		}
 	}
 
+	//-----------------------------------------------------------------------------
+	void R2000Driver::setAutoReconnect(bool enable, double silence_timeout)
+	{
+		// the supervisor reads the settings, change them while it is stopped
+		stopSupervisor();
+		
+		auto_reconnect_ = enable;
+		silence_timeout_ = silence_timeout;
+		
+		if (is_capturing_)
+			startSupervisor();
+	}
+
+	//-----------------------------------------------------------------------------
+	ReceiverMetricsSnapshot R2000Driver::getMetrics() const
+	{
+		if (!data_receiver_)
+			return ReceiverMetricsSnapshot();
+		
+		return data_receiver_->getMetrics();
+	}
+
+	//-----------------------------------------------------------------------------
+	void R2000Driver::resetMetrics()
+	{
+		if (data_receiver_)
+			data_receiver_->resetMetrics();
+	}
+
+	//-----------------------------------------------------------------------------
+	CommandMetricsSnapshot R2000Driver::getCommandMetrics() const
+	{
+		if (!command_interface_)
+			return CommandMetricsSnapshot();
+		
+		return command_interface_->getMetrics();
+	}
+
+	//-----------------------------------------------------------------------------
+	void R2000Driver::setMetricsListener(MetricsListener* listener, double interval)
+	{
+		stopSupervisor();
+		
+		metrics_listener_ = listener;
+		metrics_interval_ = interval;
+		
+		if (is_capturing_)
+			startSupervisor();
+	}
+
+	//-----------------------------------------------------------------------------
+	void R2000Driver::startSupervisor()
+	{
+		if ((!auto_reconnect_ && !metrics_listener_) || isSupervising())
+			return;
+		
+#if __cplusplus>=201103
+		if (supervisor_thread_.joinable())
+			supervisor_thread_.join();
+		
+		supervisor_running_ = true;
+		supervisor_thread_ = std::thread(&R2000Driver::superviseCapture, this);
+#else
+		supervisor_mutex_.lock();
+		supervisor_running_ = true;
+		supervisor_mutex_.unlock();
+		
+		supervisor_thread_.start(supervisor_runnable_);
+#endif
+	}
+
+	//-----------------------------------------------------------------------------
+	void R2000Driver::stopSupervisor()
+	{
+		if (!isSupervising())
+			return;
+		
+#if __cplusplus>=201103
+		supervisor_running_ = false;
+		supervisor_thread_.join();
+#else
+		supervisor_mutex_.lock();
+		supervisor_running_ = false;
+		supervisor_mutex_.unlock();
+		
+		supervisor_thread_.join();
+#endif
+	}
+
+	//-----------------------------------------------------------------------------
+	bool R2000Driver::isSupervising()
+	{
+#if __cplusplus>=201103
+		return supervisor_running_;
+#else
+		Poco::ScopedLock<Poco::FastMutex> lock(supervisor_mutex_);
+		return supervisor_running_;
+#endif
+	}
+
+	//-----------------------------------------------------------------------------
+	void R2000Driver::superviseCapture()
+	{
+		double backoff = RECONNECT_BACKOFF_MIN;
+		Poco::Clock next_attempt;
+		Poco::Clock next_export;
+		
+		while (isSupervising())
+		{
+#if __cplusplus>=201103
+			std::this_thread::sleep_for(std::chrono::milliseconds(SUPERVISOR_INTERVAL));
+#else
+			Poco::Thread::sleep(SUPERVISOR_INTERVAL);
+#endif
+			
+			if (metrics_listener_ && next_export.elapsed() >= 0)
+			{
+				next_export.update();
+				next_export += (Poco::Clock::ClockDiff)(metrics_interval_ * 1000000.0);
+				metrics_listener_->metricsUpdated(data_receiver_->getMetrics());
+				metrics_listener_->commandMetricsUpdated(command_interface_->getMetrics());
+			}
+			
+			if (!auto_reconnect_)
+				continue;
+			
+			if (data_receiver_->isConnected() && data_receiver_->getSecondsSinceLastData() < silence_timeout_)
+			{
+				// keep the handle alive even if nobody is calling getScan()
+				feedWatchdog();
+				continue;
+			}
+			
+			// wait for the next attempt
+			if (next_attempt.elapsed() < 0)
+				continue;
+			
+			if (reconnectCapture())
+			{
+				reconnect_count_++;
+				backoff = RECONNECT_BACKOFF_MIN;
+				std::cerr << "Reconnected to laser range finder." << std::endl;
+			}
+			else
+			{
+				next_attempt.update();
+				next_attempt += (Poco::Clock::ClockDiff)(backoff * 1000000.0);
+				backoff = std::min(backoff * 2.0, RECONNECT_BACKOFF_MAX);
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------------
+	bool R2000Driver::reconnectCapture()
+	{
+#if __cplusplus>=201103
+		std::unique_lock<std::recursive_mutex> lock(driver_mutex_);
+#else
+		Poco::ScopedLock<Poco::Mutex> lock(driver_mutex_);
+#endif
+		
+		std::cerr << "WARNING: No data from laser range finder, trying to reconnect..." << std::endl;
+		
+		if (!command_interface_->getProtocolInfo().isSpecified())
+			return false;
+		
+		// the old handle is gone after a reboot of the scanner, ignore errors
+		if (handle_info_.isSpecified())
+			command_interface_->releaseHandle(handle_info_.value().handle);
+		
+		// keep the previous handle info if no new handle is granted, stopCapturing() needs one
+		Poco::Optional<HandleInfo> handle_info = requestHandle(capture_handle_type_);
+		if (!handle_info.isSpecified())
+			return false;
+		
+		handle_info_ = handle_info;
+		
+		if (!data_receiver_->reconnect(handle_info_.value()) ||
+			!command_interface_->startScanOutput(handle_info_.value().handle))
+		{
+			return false;
+		}
+		
+		watchdog_feed_time_ = std::time(0);
+		return true;
+	}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 } // namespace
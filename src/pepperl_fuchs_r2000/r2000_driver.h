@@ -40,16 +40,27 @@
 #include <map>
 #include "Poco/Optional.h"
 #include "protocol_info.h"
+#include "compact_scan_data.h"
+#include "clock_sync.h"
+#include "receiver_metrics.h"
+#include "scan_queue.h"
+#include "scan_sink.h"
+#include "http_command_interface.h"
 
 #if __cplusplus>=201103
+	#include <thread>
+	#include <mutex>
+	#include <atomic>
 	#include "packet_structure_cpp11.h"
 #else
+	#include "Poco/Thread.h"
+	#include "Poco/RunnableAdapter.h"
+	#include "Poco/Mutex.h"
 	#include "packet_structure.h"
 #endif
 
 namespace pepperl_fuchs {
 
-class HttpCommandInterface;
 class ScanDataReceiver;
 
 //! \class R2000Driver
@@ -64,9 +75,11 @@ public:
     ~R2000Driver();
 
     //! Connects to a given laserscanner, gets and checks protocol info of scanner, retrieves values of all parameters
+    //! The parameter dump is requested in the background while the protocol info is checked
     //! @param ip IP or hostname of laserscanner
     //! @param port Port to use for HTTP-Interface (defaults to 80)
-    bool connect(const std::string hostname, int port=80);
+    //! @param wait_for_parameters If false, return as soon as the protocol info is verified and let the parameter dump complete in the background
+    bool connect(const std::string hostname, int port=80, bool wait_for_parameters=true);
 
     //! Disconnect from the laserscanner and reset internal state
     void disconnect();
@@ -94,6 +107,9 @@ public:
     //! @returns True if connection is alive, false otherwise
     bool checkConnection();
 
+    //! Block until a parameter dump started by connect() has completed
+    void waitForParameters();
+
     //! Retrieve Protocol information of the scanner
     //! @returns A struct containing name, version and available commands of the protocol
     const ProtocolInfo& getProtocolInfo() { return protocol_info_; }
@@ -103,8 +119,9 @@ public:
     const std::map< std::string, std::string >& getParameters();
 
     //! Get cached parameter values of the scanner
+    //! Waits for the parameter dump of connect() if it is still running
     //! @returns A key->value map with parametername->value
-    const std::map< std::string, std::string >& getParametersCached() const {return parameters_;}
+    const std::map< std::string, std::string >& getParametersCached();
 
     //! Pop a single scan out of the driver's interal FIFO queue
     //! CAUTION: Returns also unfinished scans for which a full rotation is not received yet
@@ -112,6 +129,105 @@ public:
     //! @returns A ScanData struct with distance and amplitude data as well as the packet headers belonging to the data
     ScanData getScan();
 
+    //! Pop a single compact scan out of the driver's interal FIFO queue, requires setCompactOutput(true)
+    //! CAUTION: Returns also unfinished scans for which a full rotation is not received yet
+    //! @returns A CompactScanData struct with sample-indexed distance and amplitude arrays
+    CompactScanData getCompactScan();
+
+    //! Store received scans as CompactScanData instead of ScanData, read them with getCompactScan()
+    //! Switching the mode drops all queued scans
+    void setCompactOutput(bool compact);
+
+    //! Return if received scans are stored as CompactScanData
+    bool getCompactOutput() const { return compact_output_; }
+
+    //! Publish completed scans as latest scan instead of queueing them, read them with fetchLatestScan()
+    //! The receiver hands the newest scan over without copying it, intermediate scans the consumer missed are dropped.
+    //! Switching the mode drops all queued scans
+    void setLatestScanOutput(bool latest);
+
+    //! Return if completed scans are published as latest scan
+    bool getLatestScanOutput() const { return latest_output_; }
+
+    //! Take the newest completed scan as getLatestScan(), requires setLatestScanOutput(true)
+    //! Does not lock or copy, call it and getLatestScan() from one consumer thread only, e.g. in update()
+    //! @returns True if a scan newer than the current getLatestScan() was taken
+    bool fetchLatestScan();
+
+    //! Scan taken by the last fetchLatestScan(), unchanged until the next fetchLatestScan() returning True
+    //! The reference is valid until capturing stops, empty before the first scan
+    const ScanData& getLatestScan() const;
+
+    //! Take the newest completed compact scan, like fetchLatestScan() with setCompactOutput(true)
+    bool fetchLatestCompactScan();
+
+    //! Compact scan taken by the last fetchLatestCompactScan(), like getLatestScan()
+    const CompactScanData& getLatestCompactScan() const;
+
+    //! Decode received samples additionally straight into the arrays of a sink, e.g. mapped GPU memory
+    //! The sink is called on the IO thread of the receiver, takes effect immediately and for following captures
+    //! @param sink Sink outliving the capture or until setScanSink(0), 0 to stop
+    //! @param sink_only Only feed the sink, e.g. for visualization only, getScan() and getLatestScan() stay empty
+    void setScanSink(ScanSink* sink, bool sink_only = false);
+
+    //! Return the sink set with setScanSink()
+    ScanSink* getScanSink() const { return scan_sink_; }
+
+    //! Return if only the sink is fed
+    bool isScanSinkOnly() const { return scan_sink_only_; }
+
+    //! Only receive samples within a sector, packets outside are dropped by the receiver without decoding
+    //! Takes effect immediately. The next startCapturingTCP()/startCapturingUDP() also requests the handle with
+    //! the sector start as start_angle and, if the scanner supports it, max_num_points_scan covering the sector
+    //! @param start_angle Start of the sector in 1/10000°, like PacketHeader::first_angle
+    //! @param end_angle End of the sector in 1/10000°, counterclockwise from start_angle, equal to start_angle for the full circle
+    void setRegionOfInterest(int start_angle, int end_angle);
+
+    //! Receive the samples of all angles again
+    void clearRegionOfInterest();
+
+    //! Only store every factor-th sample of a scan, the scans look like scans with num_points_scan/factor samples
+    //! @param factor 1 stores all samples
+    void setDecimation(unsigned int factor);
+
+    //! Return the decimation factor
+    unsigned int getDecimation() const { return decimation_; }
+
+    //! Set capacity and overflow policy of the receiver scan queue, takes effect immediately
+    //! The scan currently received counts as queued scan, a capacity of 2 holds one full scan.
+    //! Use SCAN_QUEUE_KEEP_LATEST if only the newest scan is of interest, e.g. for rendering.
+    //! @returns False for SCAN_QUEUE_BLOCK_PRODUCER, the receiver has to keep reading the socket
+    bool setQueuePolicy(ScanQueuePolicy policy, std::size_t capacity = SCAN_QUEUE_DEFAULT_CAPACITY);
+
+    //! Return the policy of the receiver scan queue
+    ScanQueuePolicy getQueuePolicy() const { return queue_policy_; }
+
+    //! Return the capacity of the receiver scan queue
+    std::size_t getQueueCapacity() const { return queue_capacity_; }
+
+    //! Get the counters of the receiver scan queue of the running capture
+    //! @returns All counters zero if not capturing
+    ScanQueueCounters getQueueCounters();
+
+    //! Set the packet type requested with the next startCapturingTCP()/startCapturingUDP()
+    //! 'A': 32 bit distance only, ScanData::amplitude_data stays empty
+    //! 'B': 32 bit distance and 16 bit amplitude, 6 bytes per sample
+    //! 'C': 20 bit distance and 12 bit amplitude packed into 4 bytes (default)
+    //! All types are decoded into the same ScanData/CompactScanData representation
+    //! @returns False for an unknown type
+    bool setPacketType(char packet_type);
+
+    //! Return the packet type requested for captures
+    char getPacketType() const { return packet_type_; }
+
+    //! Convert a raw scanner timestamp to host time, estimated from the packets of the running capture
+    //! @param timestamp_raw Raw timestamp in NTP time format, e.g. PacketHeader::timestamp_raw
+    //! @returns Host time in microseconds (Poco::Clock::raw()), 0 if no packet was received yet
+    int64_t toHostTime(uint64_t timestamp_raw);
+
+    //! Get a copy of the clock synchronization state of the running capture
+    ClockSynchronizer getClockSynchronizer();
+
     //! Get the total number of laserscans available (even scans which are not fully reveived yet)
     std::size_t getScansAvailable() const;
 
@@ -143,7 +259,74 @@ public:
     //! Feed the watchdog with the current handle ID, to keep the data connection alive
     void feedWatchdog(bool feed_always = false);
 
+    //! Enable or disable automatic reconnection while capturing
+    //! A background supervisor watches the data connection and, after silence_timeout seconds without data,
+    //! requests a new handle and restarts the scan output with exponential backoff between attempts.
+    //! The first scan after a reconnection is marked with ScanData::follows_gap.
+    //! @param enable True to enable automatic reconnection
+    //! @param silence_timeout Time in seconds without data after which the data connection is considered lost
+    void setAutoReconnect(bool enable, double silence_timeout = 2.0);
+
+    //! Return if automatic reconnection is enabled
+    bool getAutoReconnect() const { return auto_reconnect_; }
+
+    //! Get the number of successful automatic reconnections since capturing started
+    unsigned int getReconnectCount() const { return reconnect_count_; }
+
+    //! Get a copy of the packet, sequence and timing counters of the running capture
+    //! @returns All counters zero if not capturing
+    ReceiverMetricsSnapshot getMetrics() const;
+
+    //! Set the packet, sequence and timing counters of the running capture to zero
+    void resetMetrics();
+
+    //! Get a copy of the HTTP command counters, including watchdog feeds
+    //! @returns All counters zero if not connected
+    CommandMetricsSnapshot getCommandMetrics() const;
+
+    //! Pass a copy of the metrics to a listener periodically while capturing
+    //! The listener is called on the supervisor thread, which also runs without automatic reconnection
+    //! @param listener Listener to call, 0 to stop, has to stay valid until it is replaced or capturing stops
+    //! @param interval Time in seconds between two calls
+    void setMetricsListener(MetricsListener* listener, double interval = 1.0);
+
 private:
+    //! Check the connection state using the protocol info cached at connect()
+    //! @returns True if connected, false otherwise
+    bool checkSession();
+
+    //! Read the parameter list and all parameter values, runs on parameter_thread_
+    void fetchParameters();
+
+    //! Feed the watchdog, driver_mutex_ has to be locked
+    void feedWatchdogLocked(bool feed_always);
+
+    //! Start the supervisor thread if automatic reconnection or a metrics listener is enabled
+    void startSupervisor();
+
+    //! Stop the supervisor thread and wait until it is done
+    void stopSupervisor();
+
+    //! Return if the supervisor thread should keep running
+    bool isSupervising();
+
+    //! Watch the data connection, reconnect and export metrics, runs on supervisor_thread_
+    void superviseCapture();
+
+    //! Pass output mode, region of interest, decimation and queue policy to a new data receiver
+    void configureReceiver();
+
+    //! Compute start_angle and max_num_points_scan of the handle from the region of interest
+    void prepareHandleParameters();
+
+    //! Request a handle of the given type with the parameters of prepareHandleParameters()
+    //! Retries without max_num_points_scan for scanners not supporting it
+    Poco::Optional<HandleInfo> requestHandle(int handle_type);
+
+    //! Request a new handle and restart the scan output of the current data receiver
+    //! @returns True in case of success, False otherwise
+    bool reconnectCapture();
+
     //! HTTP/JSON interface of the scanner
     HttpCommandInterface* command_interface_;
 
@@ -165,11 +348,86 @@ private:
     //! Handle information about data connection
     Poco::Optional<HandleInfo> handle_info_;
 
+    //! Handle type of the running capture (HandleInfo::HANDLE_TYPE_TCP or HandleInfo::HANDLE_TYPE_UDP)
+    int capture_handle_type_;
+
+    //! Store received scans as CompactScanData
+    bool compact_output_;
+
+    //! Publish completed scans as latest scan
+    bool latest_output_;
+
+    //! Sink passed to the data receiver
+    ScanSink* scan_sink_;
+    bool scan_sink_only_;
+
+    //! Region of interest in 1/10000° and decimation passed to the data receiver
+    bool roi_enabled_;
+    int roi_start_angle_;
+    int roi_end_angle_;
+    unsigned int decimation_;
+
+    //! Scan queue policy passed to the data receiver
+    ScanQueuePolicy queue_policy_;
+    std::size_t queue_capacity_;
+
+    //! Packet type requested for captures, 'A', 'B' or 'C'
+    char packet_type_;
+
+    //! Handle parameters of the running capture
+    int handle_start_angle_;
+    int handle_max_num_points_scan_;
+
+    //! Automatic reconnection state
+    bool auto_reconnect_;
+    double silence_timeout_;
+#if __cplusplus>=201103
+    std::atomic<unsigned int> reconnect_count_;
+#else
+    unsigned int reconnect_count_;
+#endif
+
+    //! Periodic metrics export, only changed while the supervisor is stopped
+    MetricsListener* metrics_listener_;
+    double metrics_interval_;
+
     //! Cached version of the protocol info
     ProtocolInfo protocol_info_;
 
     //! Cached version of all parameter values
     std::map< std::string, std::string > parameters_;
+
+    //! Parameter values read by the background parameter dump
+    std::map< std::string, std::string > fetched_parameters_;
+
+    //! True while a background parameter dump has to be joined
+    bool parameter_fetch_pending_;
+
+    //! Thread reading the parameter dump during connect()
+#if __cplusplus>=201103
+    std::thread parameter_thread_;
+#else
+    Poco::Thread parameter_thread_;
+    Poco::RunnableAdapter<R2000Driver> parameter_runnable_;
+#endif
+
+    //! Thread running superviseCapture()
+#if __cplusplus>=201103
+    std::thread supervisor_thread_;
+    std::atomic<bool> supervisor_running_;
+#else
+    Poco::Thread supervisor_thread_;
+    Poco::RunnableAdapter<R2000Driver> supervisor_runnable_;
+    bool supervisor_running_;
+    Poco::FastMutex supervisor_mutex_;
+#endif
+
+    //! Protection of handle_info_ and the watchdog between user and supervisor thread
+#if __cplusplus>=201103
+    std::recursive_mutex driver_mutex_;
+#else
+    Poco::Mutex driver_mutex_;
+#endif
 };
 
 } // NS pepperl_fuchs
@@ -0,0 +1,350 @@
+//
+//  receiver_metrics.cpp
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	packet, sequence and timing counters of a scan data receiver
+//	and decoding of the scanner status flags
+//
+
+#include "receiver_metrics.h"
+
+#include <algorithm>
+
+#if __cplusplus<201103
+	#include "Poco/ScopedLock.h"
+#endif
+
+namespace pepperl_fuchs {
+
+//! Names of the status flags as used in the protocol description
+static const struct
+{
+    uint32_t flag;
+    const char* name;
+} STATUS_FLAG_NAMES[] =
+{
+    { STATUS_SCAN_DATA_INFO, "scan_data_info" },
+    { STATUS_NEW_SETTINGS, "new_settings" },
+    { STATUS_INVALID_DATA, "invalid_data" },
+    { STATUS_UNSTABLE_ROTATION, "unstable_rotation" },
+    { STATUS_SKIPPED_PACKETS, "skipped_packets" },
+    { STATUS_DEVICE_WARNING, "device_warning" },
+    { STATUS_LOW_TEMPERATURE_WARNING, "low_temperature_warning" },
+    { STATUS_HIGH_TEMPERATURE_WARNING, "high_temperature_warning" },
+    { STATUS_DEVICE_OVERLOAD, "device_overload" },
+    { STATUS_DEVICE_ERROR, "device_error" },
+    { STATUS_LOW_TEMPERATURE_ERROR, "low_temperature_error" },
+    { STATUS_HIGH_TEMPERATURE_ERROR, "high_temperature_error" },
+    { STATUS_DEVICE_OVERLOAD_ERROR, "device_overload_error" },
+    { STATUS_DEVICE_DEFECT, "device_defect" }
+};
+
+//-----------------------------------------------------------------------------
+std::string decodeStatusFlags(uint32_t flags)
+{
+    std::string names;
+    for( std::size_t i=0; i<sizeof(STATUS_FLAG_NAMES)/sizeof(STATUS_FLAG_NAMES[0]); i++ )
+    {
+        if( (flags & STATUS_FLAG_NAMES[i].flag) == 0 )
+            continue;
+        if( !names.empty() )
+            names += ",";
+        names += STATUS_FLAG_NAMES[i].name;
+    }
+    return names;
+}
+
+//-----------------------------------------------------------------------------
+//! Bucket of a value: 0 for 0, otherwise 1 + position of the highest set bit
+static std::size_t bucketOf(uint64_t value)
+{
+    std::size_t bucket = 0;
+    while( value != 0 && bucket < METRICS_HISTOGRAM_BUCKETS - 1 )
+    {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+//-----------------------------------------------------------------------------
+HistogramSnapshot::HistogramSnapshot()
+{
+    for( std::size_t i=0; i<METRICS_HISTOGRAM_BUCKETS; i++ )
+        buckets[i] = 0;
+    count = 0;
+    sum = 0;
+    max = 0;
+}
+
+//-----------------------------------------------------------------------------
+double HistogramSnapshot::mean() const
+{
+    return count > 0 ? (double)sum / count : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t HistogramSnapshot::quantile(double q) const
+{
+    if( count == 0 )
+        return 0;
+
+    const double rank = q * count;
+    uint64_t seen = 0;
+    for( std::size_t i=0; i<METRICS_HISTOGRAM_BUCKETS - 1; i++ )
+    {
+        seen += buckets[i];
+        if( seen > 0 && seen >= rank )
+            return std::min<uint64_t>(i == 0 ? 0 : ((uint64_t)1 << i) - 1, max);
+    }
+    return max;
+}
+
+//-----------------------------------------------------------------------------
+ReceiverMetricsSnapshot::ReceiverMetricsSnapshot()
+{
+    bytes_received = 0;
+    packets_received = 0;
+    invalid_packets = 0;
+    resync_bytes = 0;
+    scans_received = 0;
+    scans_lost = 0;
+    packets_lost = 0;
+    packets_out_of_order = 0;
+    scans_dropped = 0;
+    status_flags = 0;
+    status_flags_seen = 0;
+}
+
+//-----------------------------------------------------------------------------
+double ReceiverMetricsSnapshot::packetLossRatio() const
+{
+    const uint64_t expected = packets_received + packets_lost;
+    return expected > 0 ? (double)packets_lost / expected : 0.0;
+}
+
+//-----------------------------------------------------------------------------
+void MetricsCounter::add(uint64_t value)
+{
+#if __cplusplus>=201103
+    value_.fetch_add(value, std::memory_order_relaxed);
+#else
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    value_ += value;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+uint64_t MetricsCounter::get() const
+{
+#if __cplusplus>=201103
+    return value_.load(std::memory_order_relaxed);
+#else
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    return value_;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void MetricsCounter::set(uint64_t value)
+{
+#if __cplusplus>=201103
+    value_.store(value, std::memory_order_relaxed);
+#else
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    value_ = value;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void MetricsCounter::setBits(uint64_t value)
+{
+#if __cplusplus>=201103
+    value_.fetch_or(value, std::memory_order_relaxed);
+#else
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    value_ |= value;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+MetricsHistogram::MetricsHistogram()
+{
+    reset();
+}
+
+//-----------------------------------------------------------------------------
+void MetricsHistogram::add(uint64_t value)
+{
+#if __cplusplus>=201103
+    buckets_[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while( value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed) ) {}
+#else
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    values_.buckets[bucketOf(value)]++;
+    values_.count++;
+    values_.sum += value;
+    if( value > values_.max )
+        values_.max = value;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void MetricsHistogram::reset()
+{
+#if __cplusplus>=201103
+    for( std::size_t i=0; i<METRICS_HISTOGRAM_BUCKETS; i++ )
+        buckets_[i].store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+#else
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    values_ = HistogramSnapshot();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+HistogramSnapshot MetricsHistogram::getSnapshot() const
+{
+#if __cplusplus>=201103
+    HistogramSnapshot snapshot;
+    for( std::size_t i=0; i<METRICS_HISTOGRAM_BUCKETS; i++ )
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+#else
+    Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+    return values_;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+ReceiverMetrics::ReceiverMetrics()
+{
+    has_sequence_ = false;
+    scan_number_ = 0;
+    packet_number_ = 0;
+    next_index_ = 0;
+    num_points_scan_ = 0;
+    num_points_packet_ = 0;
+    scan_start_time_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+void ReceiverMetrics::addPacket(const PacketHeader& header, int64_t host_time, int64_t receive_time)
+{
+    packets_received_.add(1);
+    status_flags_.set(header.status_flags);
+    status_flags_seen_.setBits(header.status_flags);
+
+    if( !has_sequence_ || header.scan_number != scan_number_ )
+    {
+        const uint16_t scan_step = (uint16_t)(header.scan_number - scan_number_);
+
+        if( has_sequence_ && scan_step >= 0x8000 )
+        {
+            // packet of an older scan, keep following the current one
+            packets_out_of_order_.add(1);
+            return;
+        }
+
+        if( has_sequence_ )
+        {
+            // missing packets at the end of the previous scan and whole scans in between
+            if( next_index_ < num_points_scan_ && num_points_packet_ > 0 )
+                packets_lost_.add((num_points_scan_ - next_index_ + num_points_packet_ - 1) / num_points_packet_);
+            scans_lost_.add(scan_step - 1);
+
+            // missing packets at the start of this scan, unknown when joining a running scan output
+            if( header.packet_number > 1 )
+                packets_lost_.add(header.packet_number - 1);
+        }
+
+        scans_received_.add(1);
+        scan_start_time_ = 0;
+    }
+    else if( header.packet_number <= packet_number_ )
+    {
+        // late packets were already counted as lost
+        packets_out_of_order_.add(1);
+        return;
+    }
+    else if( header.packet_number > packet_number_ + 1 )
+    {
+        packets_lost_.add(header.packet_number - packet_number_ - 1);
+    }
+
+    has_sequence_ = true;
+    scan_number_ = header.scan_number;
+    packet_number_ = header.packet_number;
+    next_index_ = (uint32_t)header.first_index + header.num_points_packet;
+    num_points_scan_ = header.num_points_scan;
+    num_points_packet_ = header.num_points_packet;
+
+    // latency of a scan received from its first to its last packet
+    if( header.first_index == 0 )
+        scan_start_time_ = host_time;
+
+    if( next_index_ >= num_points_scan_ && scan_start_time_ != 0 )
+    {
+        if( receive_time > scan_start_time_ )
+            scan_latency_.add((uint64_t)(receive_time - scan_start_time_));
+        scan_start_time_ = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+void ReceiverMetrics::skipSequence()
+{
+    has_sequence_ = false;
+    scan_start_time_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+void ReceiverMetrics::reset()
+{
+    bytes_received_.set(0);
+    packets_received_.set(0);
+    invalid_packets_.set(0);
+    resync_bytes_.set(0);
+    scans_received_.set(0);
+    scans_lost_.set(0);
+    packets_lost_.set(0);
+    packets_out_of_order_.set(0);
+    scans_dropped_.set(0);
+    status_flags_.set(0);
+    status_flags_seen_.set(0);
+    decode_time_.reset();
+    scan_latency_.reset();
+}
+
+//-----------------------------------------------------------------------------
+ReceiverMetricsSnapshot ReceiverMetrics::getSnapshot() const
+{
+    ReceiverMetricsSnapshot snapshot;
+    snapshot.bytes_received = bytes_received_.get();
+    snapshot.packets_received = packets_received_.get();
+    snapshot.invalid_packets = invalid_packets_.get();
+    snapshot.resync_bytes = resync_bytes_.get();
+    snapshot.scans_received = scans_received_.get();
+    snapshot.scans_lost = scans_lost_.get();
+    snapshot.packets_lost = packets_lost_.get();
+    snapshot.packets_out_of_order = packets_out_of_order_.get();
+    snapshot.scans_dropped = scans_dropped_.get();
+    snapshot.status_flags = (uint32_t)status_flags_.get();
+    snapshot.status_flags_seen = (uint32_t)status_flags_seen_.get();
+    snapshot.decode_time_ns = decode_time_.getSnapshot();
+    snapshot.scan_latency_us = scan_latency_.getSnapshot();
+    return snapshot;
+}
+
+}
@@ -0,0 +1,270 @@
+//
+//  receiver_metrics.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	packet, sequence and timing counters of a scan data receiver
+//	and decoding of the scanner status flags
+//
+
+#ifndef RECEIVER_METRICS_H
+#define RECEIVER_METRICS_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+
+#if __cplusplus>=201103
+	#include <atomic>
+	#include "packet_structure_cpp11.h"
+#else
+	#include "Poco/Mutex.h"
+	#include "packet_structure.h"
+#endif
+
+namespace pepperl_fuchs {
+
+//! Bits of PacketHeader::status_flags
+enum StatusFlag
+{
+    //! Accumulative flag, set if one of the information flags below is set
+    STATUS_SCAN_DATA_INFO = 1u << 0,
+    //! System settings changed during this scan
+    STATUS_NEW_SETTINGS = 1u << 1,
+    //! The scan data is not consistent, e.g. while the scan frequency changes
+    STATUS_INVALID_DATA = 1u << 2,
+    //! The rotation of the scan head is not stable
+    STATUS_UNSTABLE_ROTATION = 1u << 3,
+    //! The scanner skipped packets, e.g. because of insufficient network bandwidth
+    STATUS_SKIPPED_PACKETS = 1u << 4,
+    //! Accumulative warning flag
+    STATUS_DEVICE_WARNING = 1u << 8,
+    STATUS_LOW_TEMPERATURE_WARNING = 1u << 10,
+    STATUS_HIGH_TEMPERATURE_WARNING = 1u << 11,
+    STATUS_DEVICE_OVERLOAD = 1u << 12,
+    //! Accumulative error flag
+    STATUS_DEVICE_ERROR = 1u << 16,
+    STATUS_LOW_TEMPERATURE_ERROR = 1u << 18,
+    STATUS_HIGH_TEMPERATURE_ERROR = 1u << 19,
+    STATUS_DEVICE_OVERLOAD_ERROR = 1u << 20,
+    //! Unrecoverable defect of the device
+    STATUS_DEVICE_DEFECT = 1u << 30
+};
+
+//! Names of the set status flags
+//! @param flags Value of PacketHeader::status_flags
+//! @returns Comma separated names like "unstable_rotation,high_temperature_warning", empty if no flag is set
+std::string decodeStatusFlags(uint32_t flags);
+
+//! Number of histogram buckets, bucket 0 counts the value 0, bucket i counts values in [2^(i-1), 2^i)
+//! The last bucket also counts all larger values
+static const std::size_t METRICS_HISTOGRAM_BUCKETS = 32;
+
+//! \struct HistogramSnapshot
+//! \brief Copy of a histogram with power of two buckets
+struct HistogramSnapshot
+{
+    HistogramSnapshot();
+
+    uint64_t buckets[METRICS_HISTOGRAM_BUCKETS];
+
+    //! Number, sum and maximum of all added values
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    //! Mean of all added values, 0 if empty
+    double mean() const;
+
+    //! Upper bound of the bucket holding the q-quantile, exact to a factor of two
+    //! @param q Quantile in [0, 1], e.g. 0.99
+    uint64_t quantile(double q) const;
+};
+
+//! \struct ReceiverMetricsSnapshot
+//! \brief Copy of the counters of a ReceiverMetrics
+struct ReceiverMetricsSnapshot
+{
+    ReceiverMetricsSnapshot();
+
+    //! Bytes read from the socket
+    uint64_t bytes_received;
+
+    //! Packets with a valid header, including packets dropped by the region of interest
+    uint64_t packets_received;
+
+    //! Packets dropped because their payload did not match the header
+    uint64_t invalid_packets;
+
+    //! Bytes skipped while searching for the next packet start
+    uint64_t resync_bytes;
+
+    //! Scans with at least one received packet
+    uint64_t scans_received;
+
+    //! Scans missing in the scan_number sequence
+    uint64_t scans_lost;
+
+    //! Packets missing in the packet_number sequence of received scans
+    uint64_t packets_lost;
+
+    //! Packets older than their predecessor
+    uint64_t packets_out_of_order;
+
+    //! Scans dropped because the receiver queue was full, see ScanQueuePolicy
+    //! Scans replaced with SCAN_QUEUE_KEEP_LATEST are not counted
+    uint64_t scans_dropped;
+
+    //! status_flags of the last packet and all flags seen since the last reset
+    uint32_t status_flags;
+    uint32_t status_flags_seen;
+
+    //! Time to decode and store a packet in nanoseconds
+    HistogramSnapshot decode_time_ns;
+
+    //! Time from the first sample of a scan until its last packet was received in microseconds
+    //! Includes the duration of the rotation, only complete scans are counted
+    HistogramSnapshot scan_latency_us;
+
+    //! Share of lost packets, scans lost as a whole are not included
+    double packetLossRatio() const;
+};
+
+//! \class MetricsCounter
+//! \brief Counter written and read by any thread
+//! A relaxed atomic with C++11, protected by a mutex otherwise
+class MetricsCounter
+{
+public:
+    MetricsCounter() : value_(0) {}
+
+    void add(uint64_t value);
+    uint64_t get() const;
+    void set(uint64_t value);
+
+    //! Set the bits of value in addition to the bits already set
+    void setBits(uint64_t value);
+
+private:
+    MetricsCounter(const MetricsCounter&);
+    MetricsCounter& operator=(const MetricsCounter&);
+
+#if __cplusplus>=201103
+    std::atomic<uint64_t> value_;
+#else
+    uint64_t value_;
+    mutable Poco::FastMutex mutex_;
+#endif
+};
+
+//! \class MetricsHistogram
+//! \brief Histogram with power of two buckets written and read by any thread
+//! With C++11 all counts are relaxed atomics and neither side blocks, a snapshot is consistent per bucket only.
+//! Without C++11 a mutex protects all counts.
+class MetricsHistogram
+{
+public:
+    MetricsHistogram();
+
+    void add(uint64_t value);
+    void reset();
+    HistogramSnapshot getSnapshot() const;
+
+private:
+    MetricsHistogram(const MetricsHistogram&);
+    MetricsHistogram& operator=(const MetricsHistogram&);
+
+#if __cplusplus>=201103
+    std::atomic<uint64_t> buckets_[METRICS_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+#else
+    HistogramSnapshot values_;
+    mutable Poco::FastMutex mutex_;
+#endif
+};
+
+//! \class ReceiverMetrics
+//! \brief Counters written by the IO thread of a ScanDataReceiver and read from any thread
+//! With C++11 reading does not block the IO thread, see MetricsCounter and MetricsHistogram
+class ReceiverMetrics
+{
+public:
+    ReceiverMetrics();
+
+    //! Count bytes read from the socket
+    void addBytes(std::size_t count) { bytes_received_.add(count); }
+
+    //! Count bytes skipped while searching for a packet start
+    void addResyncBytes(std::size_t count) { resync_bytes_.add(count); }
+
+    //! Count a packet with a payload not matching its header
+    void addInvalidPacket() { invalid_packets_.add(1); }
+
+    //! Count a valid packet and follow the scan and packet sequence, IO thread only
+    //! @param header Header as received, before region of interest and decimation
+    //! @param host_time Host time of the first sample of the packet in microseconds
+    //! @param receive_time Host time the packet was received in microseconds
+    void addPacket(const PacketHeader& header, int64_t host_time, int64_t receive_time);
+
+    //! Count scans dropped because the receiver queue was full
+    void addDroppedScan(std::size_t count = 1) { scans_dropped_.add(count); }
+
+    //! Add the time needed to decode and store one packet
+    void addDecodeTime(uint64_t nanoseconds) { decode_time_.add(nanoseconds); }
+
+    //! Do not count the data lost until the next packet, e.g. while reconnecting, IO thread stopped only
+    void skipSequence();
+
+    //! Set all counters to zero
+    void reset();
+
+    //! Get a copy of all counters
+    ReceiverMetricsSnapshot getSnapshot() const;
+
+private:
+    MetricsCounter bytes_received_;
+    MetricsCounter packets_received_;
+    MetricsCounter invalid_packets_;
+    MetricsCounter resync_bytes_;
+    MetricsCounter scans_received_;
+    MetricsCounter scans_lost_;
+    MetricsCounter packets_lost_;
+    MetricsCounter packets_out_of_order_;
+    MetricsCounter scans_dropped_;
+    MetricsCounter status_flags_;
+    MetricsCounter status_flags_seen_;
+    MetricsHistogram decode_time_;
+    MetricsHistogram scan_latency_;
+
+    //! Sequence state of the IO thread
+    bool has_sequence_;
+    uint16_t scan_number_;
+    uint16_t packet_number_;
+    uint32_t next_index_;
+    uint16_t num_points_scan_;
+    uint16_t num_points_packet_;
+    int64_t scan_start_time_;
+};
+
+struct CommandMetricsSnapshot;
+
+//! \class MetricsListener
+//! \brief Receives periodic copies of the driver metrics, see R2000Driver::setMetricsListener()
+class MetricsListener
+{
+public:
+    virtual ~MetricsListener() {}
+
+    //! Called on the supervisor thread of the driver
+    virtual void metricsUpdated(const ReceiverMetricsSnapshot& metrics) = 0;
+
+    //! Called on the supervisor thread of the driver right after metricsUpdated()
+    virtual void commandMetricsUpdated(const CommandMetricsSnapshot& metrics) {}
+};
+
+}
+
+#endif // RECEIVER_METRICS_H
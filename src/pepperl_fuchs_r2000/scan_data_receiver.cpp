@@ -14,12 +14,16 @@
 //
 
 #include "scan_data_receiver.h"
+#include "trace.h"
 
+#include <algorithm>
 #include <ctime>
+#include <cstring>
 #include <unistd.h>
 
 #if __cplusplus>=201103
 	#include <thread>
+	#include <chrono>
 #else
 	#include "Poco/ScopedLock.h"
 #endif
@@ -31,13 +35,209 @@ namespace pepperl_fuchs {
 		recv.run();
 	}
 	
+//-----------------------------------------------------------------------------
+//! Payload bytes per sample of a packet type, 0 for unknown types
+static std::size_t sampleSize(uint16_t packet_type)
+{
+    switch( packet_type )
+    {
+        case PACKET_TYPE_A: return sizeof(PacketTypeA) - sizeof(PacketHeader);
+        case PACKET_TYPE_B: return sizeof(PacketTypeB) - sizeof(PacketHeader);
+        case PACKET_TYPE_C: return sizeof(PacketTypeC) - sizeof(PacketHeader);
+        default: return 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//! Decode the samples of a payload of any packet type into distances and optional amplitudes
+//! Invalid distances of type A and B (0xFFFFFFFF) are stored as INVALID_DISTANCE like in type C
+//! @param stride Bytes between two decoded samples
+//! @param amplitude Output, may be 0 to skip amplitudes, not written for type A
+template<class T>
+static void decodeSamples(uint16_t packet_type, const char* payload, std::size_t stride, std::size_t count, uint32_t* distance, T* amplitude)
+{
+    uint32_t data;
+    uint16_t amp;
+	
+    switch( packet_type )
+    {
+        case PACKET_TYPE_A:
+            for( std::size_t i=0; i<count; i++ )
+            {
+                std::memcpy(&data, payload + i * stride, sizeof(data));
+                distance[i] = data == 0xFFFFFFFF ? INVALID_DISTANCE : data;
+            }
+            break;
+			
+        case PACKET_TYPE_B:
+            for( std::size_t i=0; i<count; i++ )
+            {
+                std::memcpy(&data, payload + i * stride, sizeof(data));
+                std::memcpy(&amp, payload + i * stride + sizeof(data), sizeof(amp));
+                distance[i] = data == 0xFFFFFFFF ? INVALID_DISTANCE : data;
+                if( amplitude )
+                    amplitude[i] = amp;
+            }
+            break;
+			
+        default:
+            for( std::size_t i=0; i<count; i++ )
+            {
+                std::memcpy(&data, payload + i * stride, sizeof(data));
+                distance[i] = data & 0x000FFFFF;
+                if( amplitude )
+                    amplitude[i] = (T)(data >> 20);
+            }
+            break;
+    }
+}
+	
+//-----------------------------------------------------------------------------
+//! Pack the samples of a payload of any packet type like type C, 20 bit distance and 12 bit amplitude per word
+//! Type C payloads without decimation are copied, distances and amplitudes of type A and B are clamped to 20 and 12 bits
+//! @param stride Bytes between two packed samples
+static void packSamples(uint16_t packet_type, const char* payload, std::size_t stride, std::size_t count, uint32_t* packed)
+{
+    uint32_t data;
+    uint16_t amp;
+	
+    switch( packet_type )
+    {
+        case PACKET_TYPE_A:
+            for( std::size_t i=0; i<count; i++ )
+            {
+                std::memcpy(&data, payload + i * stride, sizeof(data));
+                packed[i] = std::min(data, INVALID_DISTANCE);
+            }
+            break;
+			
+        case PACKET_TYPE_B:
+            for( std::size_t i=0; i<count; i++ )
+            {
+                std::memcpy(&data, payload + i * stride, sizeof(data));
+                std::memcpy(&amp, payload + i * stride + sizeof(data), sizeof(amp));
+                packed[i] = data >= INVALID_DISTANCE ? INVALID_DISTANCE : data | (uint32_t)std::min<uint16_t>(amp, 0xFFF) << 20;
+            }
+            break;
+			
+        default:
+            if( stride == sizeof(uint32_t) )
+            {
+                std::memcpy(packed, payload, count * sizeof(uint32_t));
+                break;
+            }
+			
+            for( std::size_t i=0; i<count; i++ )
+                std::memcpy(&packed[i], payload + i * stride, sizeof(uint32_t));
+            break;
+    }
+}
+	
 //-----------------------------------------------------------------------------
 ScanDataReceiver::ScanDataReceiver():
     ring_buffer_(65536)
     ,scan_data_()
 {
-    last_data_time_ = std::time(0);
-    is_connected_ = false;
+    last_data_time_.update();
+    receive_time_ = last_data_time_.raw();
+    setConnected(false);
+    compact_output_ = false;
+    latest_output_ = false;
+    scan_sink_ = 0;
+    sink_only_ = false;
+    sink_active_ = false;
+    sink_packed_ = false;
+    sink_distance_ = 0;
+    sink_amplitude_ = 0;
+    std::memset(&sink_info_, 0, sizeof(sink_info_));
+    gap_pending_ = false;
+    roi_enabled_ = false;
+    roi_start_ = 0;
+    roi_width_ = 3600000;
+    decimation_ = 1;
+    rejecting_scan_ = false;
+    rejected_scan_number_ = 0;
+    overflow_reported_ = false;
+}
+
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::startThread()
+{
+	// set before starting, so a following stopThread() can not be missed
+#if __cplusplus>=201103
+	isRunning = true;
+	io_service_thread_ = std::thread(runner, std::ref(*this));
+#else
+	run_mutex.lock();
+	isRunning = true;
+	run_mutex.unlock();
+	
+	io_service_thread_.start(*this);
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::stopThread()
+{
+#if __cplusplus>=201103
+	isRunning = false;
+	
+	if (io_service_thread_.joinable())
+		io_service_thread_.join();
+#else
+	run_mutex.lock();
+	isRunning = false;
+	run_mutex.unlock();
+	
+	io_service_thread_.join();
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+bool ScanDataReceiver::isConnected() const
+{
+#if __cplusplus>=201103
+	return is_connected_;
+#else
+	Poco::ScopedLock<Poco::FastMutex> lock(connected_mutex_);
+	return is_connected_;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::setConnected(bool connected)
+{
+#if __cplusplus>=201103
+	is_connected_ = connected;
+#else
+	Poco::ScopedLock<Poco::FastMutex> lock(connected_mutex_);
+	is_connected_ = connected;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::prepareReconnect()
+{
+	// only called while the IO thread is stopped
+	{
+		Poco::ScopedLock<Poco::Mutex> lock(ring_buffer_.mutex());
+		ring_buffer_.drain();
+	}
+	
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	gap_pending_ = true;
+	last_data_time_.update();
+	metrics_.skipSequence();
 }
 
 
@@ -46,6 +246,14 @@ bool ScanDataReceiver::handleNextPacket()
 {
     // Search for a packet
     int packet_start = findPacketStart();
+    if( packet_start==-2 )
+    {
+        // No packet start in the buffer, keep the last bytes which may hold the beginning of the magic bytes
+        const std::size_t skipped = ring_buffer_.used() - 4;
+        ring_buffer_.drain(skipped);
+        metrics_.addResyncBytes(skipped);
+        return false;
+    }
     if( packet_start<0 )
         return false;
 
@@ -54,51 +262,507 @@ bool ScanDataReceiver::handleNextPacket()
     PacketTypeC* p = (PacketTypeC*) buf;
     if( !retrievePacket(packet_start,p) )
         return false;
+	
+    R2000_TRACE_SCOPE("handleNextPacket");
+	
+#if __cplusplus>=201103
+    const std::chrono::steady_clock::time_point decode_start = std::chrono::steady_clock::now();
+#else
+    const Poco::Clock decode_start;
+#endif
+	
+    // Drop packets with a payload not matching their header
+    const std::size_t sample_size = sampleSize(p->header.packet_type);
+    if( sample_size == 0 || p->header.header_size + (std::size_t)p->header.num_points_packet * sample_size > p->header.packet_size )
+    {
+        metrics_.addInvalidPacket();
+        return true;
+    }
 
 	
 	// Lock internal outgoing data queue, automatically unlocks at end of function
+    R2000_TRACE_BEGIN("receiver lock");
 #if __cplusplus>=201103
 	std::unique_lock<std::mutex> lock(data_mutex_);
 #else
     Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
 #endif
+    R2000_TRACE_END("receiver lock");
+	
+    last_data_time_.update();
+	
+    clock_sync_.update(p->header.timestamp_raw, receive_time_);
+    metrics_.addPacket(p->header, clock_sync_.toHostTime(p->header.timestamp_raw), receive_time_);
 	
-    // Create new scan container if necessary
-    if( p->header.packet_number == 1 || scan_data_.empty() )
+    // Region of interest and decimation are decided by the header, dropped samples are never decoded
+    SampleSelection selections[2];
+    std::size_t num_selections = selectSamples(p->header, selections);
+    const char* payload = &buf[p->header.header_size];
+    const std::size_t stride = sample_size * decimation_;
+	
+    for( std::size_t s=0; s<num_selections; s++ )
     {
+        const PacketHeader& header = selections[s].header;
+        int64_t host_time = clock_sync_.toHostTime(header.timestamp_raw);
+		
+        const char* samples = payload + selections[s].offset * sample_size;
+		
+        // before the output, which resets gap_pending_
+        if( scan_sink_ )
+            handleSinkPacket(header, samples, stride, host_time);
 		
+        // the sink takes all samples, nothing is decoded or queued for the outputs
+        if( scan_sink_ && sink_only_ )
+        {
+            gap_pending_ = false;
+            continue;
+        }
+		
+        if( latest_output_ && compact_output_ )
+            handleLatestCompactPacket(header, samples, stride, host_time);
+        else if( latest_output_ )
+            handleLatestScanPacket(header, samples, stride, host_time);
+        else if( compact_output_ )
+            handleCompactPacket(header, samples, stride, host_time);
+        else
+            handleScanPacket(header, samples, stride, host_time);
+    }
+	
 #if __cplusplus>=201103
-        scan_data_.emplace_back();
+    metrics_.addDecodeTime(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decode_start).count());
 #else
-		scan_data_.push_back(ScanData());
+    metrics_.addDecodeTime(decode_start.elapsed() * 1000);
 #endif
-        if( scan_data_.size() > 100 )
+	
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//! Append the samples and the header of a packet to a scan
+static void storeScanPacket(ScanData& scandata, const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    // Parse payload of packet, type A has no amplitudes
+    const std::size_t offset = scandata.distance_data.size();
+    const std::size_t num_scan_points = header.num_points_packet;
+	
+    scandata.distance_data.resize(offset + num_scan_points);
+    if( header.packet_type != PACKET_TYPE_A )
+        scandata.amplitude_data.resize(offset + num_scan_points);
+	
+    if( num_scan_points > 0 )
+        decodeSamples(header.packet_type, payload, stride, num_scan_points, &scandata.distance_data[offset],
+                      header.packet_type != PACKET_TYPE_A ? &scandata.amplitude_data[offset] : (uint32_t*)0);
+
+    // Save header
+    scandata.headers.push_back(header);
+    scandata.host_times.push_back(host_time);
+}
+
+//-----------------------------------------------------------------------------
+//! Remove all samples and headers of a scan, keeping the memory for the next scan
+static void clearScanData(ScanData& scandata)
+{
+    scandata.distance_data.clear();
+    scandata.amplitude_data.clear();
+    scandata.headers.clear();
+    scandata.host_times.clear();
+    scandata.follows_gap = false;
+}
+
+//-----------------------------------------------------------------------------
+//! Store the samples of a packet at their index within arrays of num_points_scan entries and update the scan info
+//! @param amplitude Array of num_points_scan amplitudes or 0 for a scan without amplitudes
+template<class T>
+static void storeIndexedPacket(ScanInfo& info, uint32_t* distance, T* amplitude, const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    if( header.first_index >= info.num_points_scan )
+        return;
+	
+    // Store samples at their index within the scan
+    uint32_t num_scan_points = header.num_points_packet;
+    if( num_scan_points > (uint32_t)(info.num_points_scan - header.first_index) )
+        num_scan_points = info.num_points_scan - header.first_index;
+	
+    decodeSamples(header.packet_type, payload, stride, num_scan_points, distance + header.first_index, amplitude ? amplitude + header.first_index : (T*)0);
+	
+    addPacketInfo(info, header, num_scan_points, host_time);
+}
+
+//-----------------------------------------------------------------------------
+//! Store the samples of a packet packed at their index within an array of num_points_scan words and update the scan info
+static void storePackedPacket(ScanInfo& info, uint32_t* packed, const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    if( header.first_index >= info.num_points_scan )
+        return;
+	
+    uint32_t num_scan_points = header.num_points_packet;
+    if( num_scan_points > (uint32_t)(info.num_points_scan - header.first_index) )
+        num_scan_points = info.num_points_scan - header.first_index;
+	
+    packSamples(header.packet_type, payload, stride, num_scan_points, packed + header.first_index);
+	
+    addPacketInfo(info, header, num_scan_points, host_time);
+}
+
+//-----------------------------------------------------------------------------
+//! Store the samples of a packet at their index within a compact scan started with init()
+static void storeCompactPacket(CompactScanData& scandata, const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    if( scandata.distance_data.empty() )
+        return;
+	
+    // type A scans have no amplitudes
+    storeIndexedPacket(scandata.info, &scandata.distance_data[0], scandata.amplitude_data.empty() ? (uint16_t*)0 : &scandata.amplitude_data[0],
+                       header, payload, stride, host_time);
+}
+
+//-----------------------------------------------------------------------------
+template<class T>
+bool ScanDataReceiver::prepareNewScan(std::deque<T>& queue, const PacketHeader& header)
+{
+    std::size_t dropped = 0;
+    bool accepted = true;
+	
+    if( queue_control_.rejectNewScan(queue.size()) )
+    {
+        rejecting_scan_ = true;
+        rejected_scan_number_ = header.scan_number;
+        dropped = 1;
+        accepted = false;
+    }
+    else
+    {
+        // the scan at the back is complete now, SCAN_QUEUE_KEEP_LATEST keeps it until the new one is complete
+        dropped = queue_control_.makeRoom(queue, 1);
+    }
+	
+    if( dropped > 0 )
+    {
+        metrics_.addDroppedScan(dropped);
+        if( !overflow_reported_ )
         {
-            scan_data_.pop_front();
-            std::cerr << "Too many scans in receiver queue: Dropping scans!" << std::endl;
+            std::cerr << "Too many scans in receiver queue: Dropping scans! See getQueueCounters()" << std::endl;
+            overflow_reported_ = true;
         }
     }
+	
+    return accepted;
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::handleScanPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    // Packets of a scan dropped by SCAN_QUEUE_DROP_NEWEST
+    if( rejecting_scan_ && !gap_pending_ && header.scan_number == rejected_scan_number_ )
+        return;
+    rejecting_scan_ = false;
+	
+    // Create new scan container if necessary, the first packets of a scan may be dropped by the region of interest
+    if( scan_data_.empty() || gap_pending_
+       || (!scan_data_.back().headers.empty() && scan_data_.back().headers.back().scan_number != header.scan_number) )
+    {
+        if( !prepareNewScan(scan_data_, header) )
+            return;
+		
+#if __cplusplus>=201103
+        scan_data_.emplace_back();
+#else
+		scan_data_.push_back(ScanData());
+#endif
+        scan_data_.back().follows_gap = gap_pending_;
+        gap_pending_ = false;
+        queue_control_.addQueued(scan_data_.size());
+        R2000_TRACE_COUNTER("receiver queue", scan_data_.size());
+    }
     
-    ScanData& scandata = scan_data_.back();
+    storeScanPacket(scan_data_.back(), header, payload, stride, host_time);
+}
 
-    // Parse payload of packet
-    uint32_t* p_scan_data = (uint32_t*) &buf[p->header.header_size];
-    int num_scan_points = p->header.num_points_packet;
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::handleCompactPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    // Packets of a scan dropped by SCAN_QUEUE_DROP_NEWEST
+    if( rejecting_scan_ && !gap_pending_ && header.scan_number == rejected_scan_number_ )
+        return;
+    rejecting_scan_ = false;
+	
+    // Create new scan container if necessary, the first packets of a scan may be dropped by the region of interest
+    if( compact_scan_data_.empty() || gap_pending_
+       || compact_scan_data_.back().info.scan_number != header.scan_number
+       || compact_scan_data_.back().info.num_points_scan != header.num_points_scan )
+    {
+        if( !prepareNewScan(compact_scan_data_, header) )
+            return;
+		
+#if __cplusplus>=201103
+        compact_scan_data_.emplace_back();
+#else
+        compact_scan_data_.push_back(CompactScanData());
+#endif
+        compact_scan_data_.back().init(header);
+        compact_scan_data_.back().info.follows_gap = gap_pending_;
+        gap_pending_ = false;
+        queue_control_.addQueued(compact_scan_data_.size());
+        R2000_TRACE_COUNTER("receiver queue", compact_scan_data_.size());
+    }
+	
+    storeCompactPacket(compact_scan_data_.back(), header, payload, stride, host_time);
+}
 
-    for( int i=0; i<num_scan_points; i++ )
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::handleLatestScanPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    // Publish the unfinished scan when the next one starts, its last packets were lost or dropped by the region of interest
+    if( !latest_scan_.writeBuffer().headers.empty()
+       && (gap_pending_ || latest_scan_.writeBuffer().headers.back().scan_number != header.scan_number) )
+        publishLatestScan();
+	
+    ScanData& scandata = latest_scan_.writeBuffer();
+    if( scandata.headers.empty() )
     {
-        unsigned int data = p_scan_data[i];
-        unsigned int distance = (data & 0x000FFFFF);
-        unsigned int amplitude = (data & 0xFFFFF000) >> 20;
+        scandata.follows_gap = gap_pending_;
+        gap_pending_ = false;
+    }
+	
+    storeScanPacket(scandata, header, payload, stride, host_time);
+	
+    // Publish without waiting for the next scan if the packet holds the last sample
+    if( (uint32_t)header.first_index + header.num_points_packet >= header.num_points_scan )
+        publishLatestScan();
+}
 
-        scandata.distance_data.push_back(distance);
-        scandata.amplitude_data.push_back(amplitude);
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::handleLatestCompactPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    // Publish the unfinished scan when the next one starts, its last packets were lost or dropped by the region of interest
+    const ScanInfo& info = latest_compact_scan_.writeBuffer().info;
+    if( info.num_packets > 0
+       && (gap_pending_ || info.scan_number != header.scan_number || info.num_points_scan != header.num_points_scan) )
+        publishLatestCompactScan();
+	
+    CompactScanData& scandata = latest_compact_scan_.writeBuffer();
+    if( scandata.info.num_packets == 0 )
+    {
+        scandata.init(header);
+        scandata.info.follows_gap = gap_pending_;
+        gap_pending_ = false;
     }
+	
+    storeCompactPacket(scandata, header, payload, stride, host_time);
+	
+    if( scandata.isComplete() || (uint32_t)header.first_index + header.num_points_packet >= header.num_points_scan )
+        publishLatestCompactScan();
+}
 
-    // Save header
-    scandata.headers.push_back(p->header);
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::handleSinkPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time)
+{
+    // Finish the scan when the next one starts, its last packets were lost or dropped by the region of interest
+    if( sink_active_
+       && (gap_pending_ || sink_info_.scan_number != header.scan_number || sink_info_.num_points_scan != header.num_points_scan) )
+        finishSinkScan();
 	
-    return true;
+    if( !sink_active_ )
+    {
+        // a scan skipped by the sink stays active without arrays, so the sink is asked once per scan
+        sink_active_ = true;
+        sink_packed_ = scan_sink_->getFormat() == SCAN_SINK_PACKED;
+        initScanInfo(sink_info_, header);
+        sink_info_.follows_gap = gap_pending_;
+		
+        sink_distance_ = 0;
+        sink_amplitude_ = 0;
+        if( !scan_sink_->beginScan(header, sink_distance_, sink_amplitude_) || !sink_distance_ || (!sink_amplitude_ && !sink_packed_) )
+        {
+            sink_distance_ = 0;
+            sink_amplitude_ = 0;
+        }
+    }
+	
+    if( !sink_distance_ )
+        return;
+	
+    if( sink_packed_ )
+        storePackedPacket(sink_info_, sink_distance_, header, payload, stride, host_time);
+    else
+        storeIndexedPacket(sink_info_, sink_distance_, sink_amplitude_, header, payload, stride, host_time);
+	
+    if( sink_info_.num_points_received >= sink_info_.num_points_scan
+       || (uint32_t)header.first_index + header.num_points_packet >= header.num_points_scan )
+        finishSinkScan();
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::finishSinkScan()
+{
+    if( sink_active_ && sink_distance_ )
+        scan_sink_->endScan(sink_info_);
+	
+    sink_active_ = false;
+    sink_distance_ = 0;
+    sink_amplitude_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::setScanSink(ScanSink* sink, bool sink_only)
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	sink_only_ = sink_only;
+	if( sink == scan_sink_ )
+		return;
+	
+	// the previous sink gets its unfinished scan back
+	finishSinkScan();
+	scan_sink_ = sink;
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::publishLatestScan()
+{
+    queue_control_.addQueued(1);
+    if( latest_scan_.publish() )
+        queue_control_.addReplaced();
+	
+    // the buffer to fill next holds an old scan
+    clearScanData(latest_scan_.writeBuffer());
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::publishLatestCompactScan()
+{
+    queue_control_.addQueued(1);
+    if( latest_compact_scan_.publish() )
+        queue_control_.addReplaced();
+	
+    // the buffer to fill next holds an old scan, init() with the next packet reuses its memory
+    latest_compact_scan_.writeBuffer().info.num_packets = 0;
+}
+
+//-----------------------------------------------------------------------------
+std::size_t ScanDataReceiver::selectSamples(const PacketHeader& header, SampleSelection* selections) const
+{
+    const int64_t factor = decimation_;
+    if( !roi_enabled_ && factor <= 1 )
+    {
+        selections[0].header = header;
+        selections[0].offset = 0;
+        return 1;
+    }
+	
+    if( header.num_points_packet == 0 || header.num_points_scan == 0 )
+        return 0;
+	
+    const int64_t num_points = header.num_points_scan;
+    const int64_t first = header.first_index;
+    const int64_t last = std::min(first + header.num_points_packet, num_points) - 1;
+    const int64_t increment = header.angular_increment;
+	
+    // Sample index ranges to keep, in increasing order
+    int64_t range_begin[2];
+    int64_t range_end[2];
+    std::size_t num_ranges = 0;
+	
+    if( !roi_enabled_ || increment <= 0 )
+    {
+        range_begin[0] = 0;
+        range_end[0] = num_points - 1;
+        num_ranges = 1;
+    }
+    else
+    {
+        // sector relative to the angle of sample index 0
+        const int64_t full = 3600000;
+        const int64_t angle0 = (int64_t)header.first_angle - first * increment;
+        const int64_t start = (((int64_t)roi_start_ - angle0) % full + full) % full;
+        const int64_t end = start + roi_width_;
+		
+        // part of the sector behind the end of the scan continues at sample index 0
+        if( end >= full )
+        {
+            range_begin[num_ranges] = 0;
+            range_end[num_ranges] = (end - full) / increment;
+            num_ranges++;
+        }
+		
+        range_begin[num_ranges] = (start + increment - 1) / increment;
+        range_end[num_ranges] = std::min(end, full - 1) / increment;
+        num_ranges++;
+    }
+	
+    // Length of one sample in NTP time units, to move timestamp_raw to the first selected sample
+    const double sample_ntp = header.scan_frequency > 0 ? 4294967296.0 * 1000.0 / header.scan_frequency / num_points : 0.0;
+	
+    std::size_t count = 0;
+    for( std::size_t r=0; r<num_ranges; r++ )
+    {
+        int64_t a = std::max(range_begin[r], first);
+        const int64_t b = std::min(range_end[r], last);
+		
+        // first multiple of factor
+        a = (a + factor - 1) / factor * factor;
+        if( a > b )
+            continue;
+		
+        SampleSelection& selection = selections[count++];
+        selection.header = header;
+        selection.header.first_index = (uint16_t)(a / factor);
+        selection.header.num_points_packet = (uint16_t)((b - a) / factor + 1);
+        selection.header.num_points_scan = (uint16_t)((num_points + factor - 1) / factor);
+        selection.header.first_angle = (int32_t)(header.first_angle + (a - first) * increment);
+        selection.header.angular_increment = (int32_t)(increment * factor);
+        selection.header.timestamp_raw = header.timestamp_raw + (uint64_t)((a - first) * sample_ntp + 0.5);
+        selection.offset = (std::size_t)(a - first);
+    }
+	
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::setRegionOfInterest(int32_t start_angle, int32_t end_angle)
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	const int32_t full = 3600000;
+	const int32_t width = ((end_angle - start_angle) % full + full) % full;
+	
+	roi_enabled_ = true;
+	roi_start_ = start_angle;
+	roi_width_ = width == 0 ? full : width;
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::clearRegionOfInterest()
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	roi_enabled_ = false;
+	roi_start_ = 0;
+	roi_width_ = 3600000;
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::setDecimation(unsigned int factor)
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	decimation_ = std::max(1u, factor);
 }
 
 //-----------------------------------------------------------------------------
@@ -108,9 +772,11 @@ int ScanDataReceiver::findPacketStart()
         return -1;
     for( std::size_t i=0; i<ring_buffer_.used()-4; i++)
     {
+        // packet type A, B or C
         if(   ((unsigned char) ring_buffer_[i])   == 0x5c
            && ((unsigned char) ring_buffer_[i+1]) == 0xa2
-           && ((unsigned char) ring_buffer_[i+2]) == 0x43
+           && ((unsigned char) ring_buffer_[i+2]) >= 0x41
+           && ((unsigned char) ring_buffer_[i+2]) <= 0x43
            && ((unsigned char) ring_buffer_[i+3]) == 0x00 )
         {
             return i;
@@ -127,7 +793,10 @@ bool ScanDataReceiver::retrievePacket(std::size_t start, PacketTypeC* p)
 
     // Erase preceding bytes
     if (start > 0)
+    {
         ring_buffer_.drain(start);
+        metrics_.addResyncBytes(start);
+    }
 
     char* pp = (char*) p;
     // Peek from header (leave header in the ringbuffer for now)
@@ -147,7 +816,7 @@ bool ScanDataReceiver::checkConnection()
 {
     if( !isConnected() )
         return false;
-    if( (std::time(0)-last_data_time_) > 2 )
+    if( getSecondsSinceLastData() > 2 )
     {
         disconnect();
         return false;
@@ -155,11 +824,32 @@ bool ScanDataReceiver::checkConnection()
     return true;
 }
 
+//-----------------------------------------------------------------------------
+double ScanDataReceiver::getSecondsSinceLastData()
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	return last_data_time_.elapsed() / 1000000.0;
+}
+
 //-----------------------------------------------------------------------------
 ScanData ScanDataReceiver::getScan()
 {
+	R2000_TRACE_SCOPE("getScan");
+	
 #if __cplusplus>=201103
+	R2000_TRACE_BEGIN("receiver lock");
 	std::unique_lock<std::mutex> lock(data_mutex_);
+	R2000_TRACE_END("receiver lock");
+	
+	if (scan_data_.empty()) {
+		return ScanData();
+	}
+	
 	ScanData data(std::move(scan_data_.front()));
 	scan_data_.pop_front();
 	return data;
@@ -180,6 +870,136 @@ ScanData ScanDataReceiver::getScan()
 #endif
 }
 
+//-----------------------------------------------------------------------------
+CompactScanData ScanDataReceiver::getCompactScan()
+{
+	R2000_TRACE_SCOPE("getCompactScan");
+	
+#if __cplusplus>=201103
+	R2000_TRACE_BEGIN("receiver lock");
+	std::unique_lock<std::mutex> lock(data_mutex_);
+	R2000_TRACE_END("receiver lock");
+	
+	if (compact_scan_data_.empty()) {
+		return CompactScanData();
+	}
+	
+	CompactScanData data(std::move(compact_scan_data_.front()));
+	compact_scan_data_.pop_front();
+	return data;
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+	
+	if (compact_scan_data_.empty()) {
+		return CompactScanData();
+	}
+	
+	CompactScanData data(compact_scan_data_.front());
+	compact_scan_data_.pop_front();
+	return data;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::setCompactOutput(bool compact)
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	if (compact == compact_output_)
+		return;
+	
+	compact_output_ = compact;
+	scan_data_.clear();
+	compact_scan_data_.clear();
+	resetLatestScans();
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::setLatestScanOutput(bool latest)
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	if (latest == latest_output_)
+		return;
+	
+	latest_output_ = latest;
+	scan_data_.clear();
+	compact_scan_data_.clear();
+	resetLatestScans();
+}
+
+//-----------------------------------------------------------------------------
+void ScanDataReceiver::resetLatestScans()
+{
+	// only the write buffers, the consumer keeps its scans
+	clearScanData(latest_scan_.writeBuffer());
+	latest_compact_scan_.writeBuffer().info.num_packets = 0;
+}
+
+//-----------------------------------------------------------------------------
+bool ScanDataReceiver::setQueuePolicy(ScanQueuePolicy policy, std::size_t capacity)
+{
+	if( policy == SCAN_QUEUE_BLOCK_PRODUCER )
+	{
+		std::cerr << "ERROR: The scan data receiver can not block, use SCAN_QUEUE_DROP_OLDEST or SCAN_QUEUE_DROP_NEWEST" << std::endl;
+		return false;
+	}
+	
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	queue_control_.setPolicy(policy, capacity);
+	overflow_reported_ = false;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+ScanQueueCounters ScanDataReceiver::getQueueCounters()
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	return queue_control_.getCounters();
+}
+
+//-----------------------------------------------------------------------------
+int64_t ScanDataReceiver::toHostTime(uint64_t timestamp_raw)
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	return clock_sync_.toHostTime(timestamp_raw);
+}
+
+//-----------------------------------------------------------------------------
+ClockSynchronizer ScanDataReceiver::getClockSynchronizer()
+{
+#if __cplusplus>=201103
+	std::unique_lock<std::mutex> lock(data_mutex_);
+#else
+	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
+#endif
+	
+	return clock_sync_;
+}
+
 //-----------------------------------------------------------------------------
 std::size_t ScanDataReceiver::getScansAvailable()
 {
@@ -190,16 +1010,17 @@ std::size_t ScanDataReceiver::getScansAvailable()
 	Poco::ScopedLock<Poco::Mutex> lock(data_mutex_);
 #endif
 	
-	return scan_data_.size();
+	return compact_output_ ? compact_scan_data_.size() : scan_data_.size();
 }
 	
 //-----------------------------------------------------------------------------
 std::size_t ScanDataReceiver::getFullScansAvailable() const
 {
-    if( scan_data_.size() == 0 )
+    std::size_t size = compact_output_ ? compact_scan_data_.size() : scan_data_.size();
+    if( size == 0 )
         return 0;
     else
-        return scan_data_.size()-1;
+        return size-1;
 }
 	
 //-----------------------------------------------------------------------------
@@ -212,6 +1033,8 @@ void ScanDataReceiver::writeBufferBack(char *src, std::size_t numbytes)
 	Poco::ScopedLock<Poco::Mutex> lock(ring_buffer_.mutex());
     // append data to rungbuffer
     ring_buffer_.write(src, numbytes);
+	
+    metrics_.addBytes(numbytes);
 }
 
 //-----------------------------------------------------------------------------
@@ -23,6 +23,15 @@
 
 #include "Poco/Array.h"
 #include "Poco/FIFOBuffer.h"
+#include "Poco/Clock.h"
+
+#include "protocol_info.h"
+#include "compact_scan_data.h"
+#include "clock_sync.h"
+#include "receiver_metrics.h"
+#include "scan_queue.h"
+#include "triple_buffer.h"
+#include "scan_sink.h"
 
 #if __cplusplus>=201103
 	#include <mutex>
@@ -51,17 +60,105 @@ public:
     ScanDataReceiver();
     
     //! Return connection status
-    bool isConnected() const { return is_connected_; }
+    bool isConnected() const;
 
     //! Disconnect and cleanup
     virtual void disconnect() = 0;
 
+    //! Re-establish the data connection after the scanner handle has been renewed
+    //! Data received afterwards starts a new scan which is marked with follows_gap
+    //! @param handle_info The renewed handle
+    //! @returns True if data can be received again, False otherwise
+    virtual bool reconnect(const HandleInfo& handle_info) = 0;
+
+    //! Get the time since the last packet was received
+    //! @returns Time in seconds
+    double getSecondsSinceLastData();
+
     //! Pop a single scan out of the internal FIFO queue
     //! CAUTION: Returns also unfinished scans for which a full rotation is not received yet
     //! Call getFullScansAvailable() first to see how many full scans are available
     //! @returns A ScanData struct with distance and amplitude data as well as the packet headers belonging to the data
     ScanData getScan();
 
+    //! Pop a single compact scan out of the internal FIFO queue, only filled in compact output mode
+    //! CAUTION: Returns also unfinished scans, see isComplete() and getFullScansAvailable()
+    //! @returns A CompactScanData struct with sample-indexed distance and amplitude arrays
+    CompactScanData getCompactScan();
+
+    //! Store received scans as CompactScanData instead of ScanData
+    //! Switching the mode drops all queued scans
+    void setCompactOutput(bool compact);
+
+    //! Return if received scans are stored as CompactScanData
+    bool getCompactOutput() const { return compact_output_; }
+
+    //! Publish completed scans as latest scan instead of queueing them, for consumers only wanting the newest scan
+    //! Scans are received into a triple buffer and handed over without copying, see fetchLatestScan()
+    //! Switching the mode drops all queued scans
+    void setLatestScanOutput(bool latest);
+
+    //! Return if completed scans are published as latest scan
+    bool getLatestScanOutput() const { return latest_output_; }
+
+    //! Take the newest completed scan as getLatestScan(), does not lock, one consumer thread only
+    //! @returns True if a scan newer than the current getLatestScan() was taken
+    bool fetchLatestScan() { return latest_scan_.update(); }
+
+    //! Scan taken by the last fetchLatestScan(), unchanged until the next fetchLatestScan() returning True
+    //! Empty before the first scan, consumer thread only
+    const ScanData& getLatestScan() const { return latest_scan_.readBuffer(); }
+
+    //! Take the newest completed compact scan as getLatestCompactScan(), like fetchLatestScan() in compact output mode
+    bool fetchLatestCompactScan() { return latest_compact_scan_.update(); }
+
+    //! Compact scan taken by the last fetchLatestCompactScan(), like getLatestScan()
+    const CompactScanData& getLatestCompactScan() const { return latest_compact_scan_.readBuffer(); }
+
+    //! Decode received samples additionally straight into the arrays of a sink, on the IO thread
+    //! Unfinished scans are passed to the previous sink with endScan() before switching
+    //! @param sink Sink outliving the receiver or until setScanSink(0), 0 to stop
+    //! @param sink_only Only feed the sink, no scans are decoded or queued for getScan(), getLatestScan() and the compact variants
+    void setScanSink(ScanSink* sink, bool sink_only = false);
+
+    //! Only store samples within a sector, packets outside are dropped by inspecting their header without decoding the payload
+    //! Headers of stored packets are rewritten (first_index, first_angle, num_points_packet, timestamp_raw) to describe the stored samples
+    //! @param start_angle Start of the sector in 1/10000°, like PacketHeader::first_angle
+    //! @param end_angle End of the sector in 1/10000°, counterclockwise from start_angle, equal to start_angle for the full circle
+    void setRegionOfInterest(int32_t start_angle, int32_t end_angle);
+
+    //! Store the samples of all angles
+    void clearRegionOfInterest();
+
+    //! Only store samples with an index that is a multiple of factor
+    //! Headers describe a scan with num_points_scan/factor samples and factor times the angular increment
+    //! @param factor 1 stores all samples
+    void setDecimation(unsigned int factor);
+
+    //! Convert a raw scanner timestamp to host time using the packets received so far
+    //! @param timestamp_raw Raw timestamp in NTP time format, e.g. PacketHeader::timestamp_raw
+    //! @returns Host time in microseconds (Poco::Clock::raw()), 0 if no packet was received yet
+    int64_t toHostTime(uint64_t timestamp_raw);
+
+    //! Get a copy of the current clock synchronization state
+    ClockSynchronizer getClockSynchronizer();
+
+    //! Get a copy of the packet, sequence and timing counters, does not block the IO thread with C++11
+    ReceiverMetricsSnapshot getMetrics() const { return metrics_.getSnapshot(); }
+
+    //! Set all packet, sequence and timing counters to zero
+    void resetMetrics() { metrics_.reset(); }
+
+    //! Set capacity and overflow policy of the scan queue, switching the policy keeps the queued scans
+    //! The scan currently received counts as queued scan, a capacity of 2 holds one full scan
+    //! SCAN_QUEUE_BLOCK_PRODUCER is not supported, the IO thread has to keep reading the socket
+    //! @returns False for SCAN_QUEUE_BLOCK_PRODUCER
+    bool setQueuePolicy(ScanQueuePolicy policy, std::size_t capacity = SCAN_QUEUE_DEFAULT_CAPACITY);
+
+    //! Get the counters of the scan queue
+    //! With setLatestScanOutput() scans_queued counts the published scans and replaced the ones never fetched
+    ScanQueueCounters getQueueCounters();
+
     //! Get the total number of laserscans available (even scans which are not fully reveived yet)
 	std::size_t getScansAvailable();
 
@@ -77,12 +174,86 @@ protected:
     Poco::Thread io_service_thread_;
 #endif
 	
-    //! Internal connection state
+    //! Internal connection state, written by the IO thread and read by the driver and its supervisor
+#if __cplusplus>=201103
+    std::atomic<bool> is_connected_;
+#else
     bool is_connected_;
+    mutable Poco::FastMutex connected_mutex_;
+#endif
+
+    //! Set the connection state
+    void setConnected(bool connected);
+    
+    //! Start the IO thread calling run()
+    void startThread();
+    
+    //! Signal the IO thread to stop and wait until it is done
+    void stopThread();
+    
+    //! Drop buffered bytes and let the next packet start a new scan marked with follows_gap
+    void prepareReconnect();
     
     //! Try to read and parse next packet from the internal ring buffer
     //! @returns True if a packet has been parsed, false otherwise
     bool handleNextPacket();
+
+    //! Store samples of a packet in the scan queue, called with the data queue locked
+    //! @param header Header describing the stored samples
+    //! @param payload Payload at the first stored sample, packet type A, B or C
+    //! @param stride Bytes between two stored samples in the payload
+    //! @param host_time Host time of the first stored sample
+    void handleScanPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time);
+
+    //! Store samples of a packet in the compact scan queue, called with the data queue locked
+    //! @param header Header describing the stored samples
+    //! @param payload Payload at the first stored sample, packet type A, B or C
+    //! @param stride Bytes between two stored samples in the payload
+    //! @param host_time Host time of the first stored sample
+    void handleCompactPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time);
+
+    //! Store samples of a packet in the write buffer of latest_scan_, called with the data queue locked
+    void handleLatestScanPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time);
+
+    //! Store samples of a packet in the write buffer of latest_compact_scan_, called with the data queue locked
+    void handleLatestCompactPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time);
+
+    //! Decode the samples of a packet into the arrays of scan_sink_, called with the data queue locked
+    void handleSinkPacket(const PacketHeader& header, const char* payload, std::size_t stride, int64_t host_time);
+
+    //! Pass the scan of the sink to endScan() if it has arrays and start a new one with the next packet
+    void finishSinkScan();
+
+    //! Publish the write buffer of latest_scan_ and clear the next one
+    void publishLatestScan();
+
+    //! Publish the write buffer of latest_compact_scan_ and mark the next one as unused
+    void publishLatestCompactScan();
+
+    //! Drop the scans received into the write buffers of latest_scan_ and latest_compact_scan_
+    void resetLatestScans();
+
+    //! Apply the queue policy before a new scan is appended, called with the data queue locked
+    //! @param queue scan_data_ or compact_scan_data_
+    //! @param header First packet of the new scan
+    //! @returns False if the new scan is dropped, its following packets are dropped too
+    template<class T> bool prepareNewScan(std::deque<T>& queue, const PacketHeader& header);
+
+    //! Samples of a packet passing region of interest and decimation
+    struct SampleSelection
+    {
+        //! Header rewritten to describe the selected samples only
+        PacketHeader header;
+
+        //! Position of the first selected sample in the payload
+        std::size_t offset;
+    };
+
+    //! Select the samples of a packet to store, using the header only
+    //! @param header Header of the received packet
+    //! @param selections Output for up to two selections, two if the gap of a sector wrapping around lies within the packet
+    //! @returns Number of selections, 0 if the packet can be dropped
+    std::size_t selectSamples(const PacketHeader& header, SampleSelection* selections) const;
     
     //! Search for magic header bytes in the internal ring buffer
     //! @returns Position of possible packet start, which normally should be zero
@@ -109,6 +280,9 @@ protected:
     
     //! data Buffer
     Poco::Array< char, 65536 > data_buffer_;
+
+    //! Host time when the bytes in data_buffer_ were received, set by run() before handling packets
+    Poco::Clock::ClockVal receive_time_;
 	
 #if __cplusplus>=201103
 	std::atomic<bool> isRunning;
@@ -131,8 +305,62 @@ private:
     //! Double ended queue with sucessfully received and parsed data, organized as single complete scans
     std::deque<ScanData> scan_data_;
 
-    //! time in seconds since epoch, when last data was received
-    double last_data_time_;
+    //! Double ended queue with scans in compact form, used instead of scan_data_ in compact output mode
+    std::deque<CompactScanData> compact_scan_data_;
+
+    //! Store scans as CompactScanData
+    bool compact_output_;
+
+    //! Publish completed scans to latest_scan_ or latest_compact_scan_ instead of the queues
+    bool latest_output_;
+
+    //! Newest completed scans, written by the IO thread with the data queue locked and read without locking
+    TripleBuffer<ScanData> latest_scan_;
+    TripleBuffer<CompactScanData> latest_compact_scan_;
+
+    //! Receives the samples of every scan, see setScanSink()
+    ScanSink* scan_sink_;
+
+    //! Skip the outputs while a sink is set
+    bool sink_only_;
+
+    //! Scan of the sink, active from its first packet on, the arrays are 0 if the sink skipped it
+    //! sink_packed_ is the ScanSinkFormat of the scan
+    bool sink_active_;
+    bool sink_packed_;
+    ScanInfo sink_info_;
+    uint32_t* sink_distance_;
+    uint32_t* sink_amplitude_;
+
+    //! Capacity, overflow policy and counters of scan_data_ and compact_scan_data_
+    ScanQueueControl queue_control_;
+
+    //! Scan dropped by SCAN_QUEUE_DROP_NEWEST, its following packets are dropped too
+    bool rejecting_scan_;
+    uint16_t rejected_scan_number_;
+
+    //! An overflow of the queue has been reported since the policy was set
+    bool overflow_reported_;
+
+    //! Monotonic time when last data was received
+    Poco::Clock last_data_time_;
+
+    //! Start a new scan with the next packet and mark it with follows_gap
+    bool gap_pending_;
+
+    //! Region of interest in 1/10000°, width 3600000 for the full circle
+    bool roi_enabled_;
+    int32_t roi_start_;
+    int32_t roi_width_;
+
+    //! Store every decimation_-th sample
+    unsigned int decimation_;
+
+    //! Maps scanner timestamps to host time, updated with every packet
+    ClockSynchronizer clock_sync_;
+
+    //! Packet, sequence and timing counters, written by the IO thread
+    ReceiverMetrics metrics_;
 };
 
 	void runner(ScanDataReceiver& recv);
@@ -12,21 +12,29 @@
 
 #include "scan_data_receiver_tcp.h"
 
+#include "Poco/Exception.h"
+#include "trace.h"
+
 
 namespace pepperl_fuchs
 {
 	ScanDataReceiverTCP::ScanDataReceiverTCP(const std::string hostname, const int tcp_port) :
-		ScanDataReceiver(),
-		tcp_socket(Poco::Net::SocketAddress(hostname, tcp_port))
-    {	
-		is_connected_ = true;
+		ScanDataReceiver()
+    {
+		try
+		{
+			connectSocket(hostname, tcp_port);
+		}
+		catch (Poco::Exception& exc)
+		{
+			std::cerr << "ERROR: Could not connect to TCP port " << tcp_port << ": " << exc.displayText() << std::endl;
+			return;
+		}
+		
+		setConnected(true);
 		
 		// start thread
-#if __cplusplus>=201103
-		io_service_thread_ = std::thread(runner, std::ref(*this));
-#else
-        io_service_thread_.start(*this);
-#endif
+		startThread();
     }
     
     
@@ -36,35 +44,66 @@ namespace pepperl_fuchs
     }
     
     
+	void ScanDataReceiverTCP::connectSocket(const std::string hostname, const int tcp_port)
+	{
+		tcp_socket = Poco::Net::StreamSocket();
+		tcp_socket.connect(Poco::Net::SocketAddress(hostname, tcp_port), Poco::Timespan(2, 0));
+		
+		// wake up regularly to check isRunning
+		tcp_socket.setReceiveTimeout(Poco::Timespan(0, 500000));
+	}
+	
+	
 	void ScanDataReceiverTCP::run()
 	{
 		char* buffer = data_buffer_.data();
 		
+		R2000_TRACE_THREAD_NAME("r2000 tcp receiver");
+		
 		// thread worker
 #if __cplusplus>=201103
-		isRunning = true;
-		
 		while(isRunning)
 #else
 		bool doIt = true;
-			
-		run_mutex.lock();
-		isRunning = true;
-		run_mutex.unlock();
-			
+		
 		while(doIt)
 #endif
 		{
 			// do
-			std::size_t numBytes = tcp_socket.receiveBytes(buffer, data_buffer_.size());
-			
-			if (numBytes == 0) break; // gracefull shutdown...
+			std::size_t numBytes = 0;
 			
-			// write data to ringbuffer
-			writeBufferBack(buffer, numBytes);
+			try
+			{
+				numBytes = tcp_socket.receiveBytes(buffer, data_buffer_.size());
+				
+				if (numBytes == 0) {
+					// gracefull shutdown...
+					setConnected(false);
+					break;
+				}
+			}
+			catch (Poco::TimeoutException&)
+			{
+				// no data, check isRunning
+			}
+			catch (Poco::Exception& exc)
+			{
+				std::cerr << "ERROR: TCP data connection: " << exc.displayText() << std::endl;
+				setConnected(false);
+				break;
+			}
 			
-			// handle packets
-			while( handleNextPacket() ) {}
+			if (numBytes > 0)
+			{
+				R2000_TRACE_SCOPE("receiver handle bytes");
+				receive_time_ = Poco::Clock().raw();
+				
+				// write data to ringbuffer
+				writeBufferBack(buffer, numBytes);
+				
+				// handle packets
+				while( handleNextPacket() ) {}
+			}
 			
 #if __cplusplus<201103
             run_mutex.lock();
@@ -79,19 +118,38 @@ namespace pepperl_fuchs
     
     void ScanDataReceiverTCP::disconnect()
     {
-        is_connected_ = false;
-		
-#if __cplusplus>=201103
-        isRunning = false;
-#else
-		run_mutex.lock();
-		isRunning = false;
-		run_mutex.unlock();
-#endif
+        setConnected(false);
 		
         // wait until thread is done
-        io_service_thread_.join();
+        stopThread();
 		
         tcp_socket.close();
     }
-}
\ No newline at end of file
+	
+	
+	bool ScanDataReceiverTCP::reconnect(const HandleInfo& handle_info)
+	{
+		setConnected(false);
+		
+		stopThread();
+		tcp_socket.close();
+		
+		// drop partial packets of the old connection
+		prepareReconnect();
+		
+		try
+		{
+			connectSocket(handle_info.hostname, handle_info.port);
+		}
+		catch (Poco::Exception& exc)
+		{
+			std::cerr << "ERROR: Could not reconnect to TCP port " << handle_info.port << ": " << exc.displayText() << std::endl;
+			return false;
+		}
+		
+		setConnected(true);
+		startThread();
+		
+		return true;
+	}
+}
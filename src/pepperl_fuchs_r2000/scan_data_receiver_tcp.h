@@ -31,11 +31,17 @@ namespace pepperl_fuchs
 		
 		void disconnect();
 		
+		//! Connect a new socket to the TCP port of the renewed handle
+		bool reconnect(const HandleInfo& handle_info);
+		
 		//! do threaded work here
 		void run();
 		
 		
 	private:
+		//! Connect tcp_socket and set the receive timeout used to poll isRunning
+		void connectSocket(const std::string hostname, const int tcp_port);
+		
 		Poco::Net::StreamSocket tcp_socket;
 	};
 }
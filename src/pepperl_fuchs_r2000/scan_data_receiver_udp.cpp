@@ -11,6 +11,9 @@
 
 #include "scan_data_receiver_udp.h"
 
+#include "Poco/Exception.h"
+#include "trace.h"
+
 namespace pepperl_fuchs {
 
     ScanDataReceiverUDP::ScanDataReceiverUDP() :
@@ -19,14 +22,13 @@ namespace pepperl_fuchs {
 		,udp_socket(Poco::Net::SocketAddress(Poco::Net::IPAddress(Poco::Net::IPAddress::IPv4), 0))
     {
 		udp_port_ = udp_socket.address().port();
+		
+		// wake up regularly to check isRunning
+		udp_socket.setReceiveTimeout(Poco::Timespan(0, 500000));
 
-		is_connected_ = true;
+		setConnected(true);
 		
-#if __cplusplus>=201103
-		io_service_thread_ = std::thread(runner, std::ref(*this));
-#else
-        io_service_thread_.start(*this);
-#endif
+		startThread();
 		
 //        std::cout << "Receiving scanner data at local UDP port " << udp_port_ << " ... ";
     }
@@ -43,28 +45,45 @@ namespace pepperl_fuchs {
 		Poco::Net::SocketAddress sender;
 		char* buffer = data_buffer_.data();
 		
-#if __cplusplus>=201103
-		isRunning = true;
+		R2000_TRACE_THREAD_NAME("r2000 udp receiver");
 		
+#if __cplusplus>=201103
 		while(isRunning)
 #else
 		bool doIt = true;
 		
-		run_mutex.lock();
-		isRunning = true;
-		run_mutex.unlock();
-		
 		
 		// thread worker
 		while (doIt)
 #endif
 		{
             // do
-			std::size_t numBytes = udp_socket.receiveFrom(buffer, data_buffer_.size(), sender);
-
-            writeBufferBack(buffer, numBytes);
-            
-            while( handleNextPacket() ) {}
+			std::size_t numBytes = 0;
+			
+			try
+			{
+				numBytes = udp_socket.receiveFrom(buffer, data_buffer_.size(), sender);
+			}
+			catch (Poco::TimeoutException&)
+			{
+				// no data, check isRunning
+			}
+			catch (Poco::Exception& exc)
+			{
+				std::cerr << "ERROR: UDP data connection: " << exc.displayText() << std::endl;
+				setConnected(false);
+				break;
+			}
+			
+			if (numBytes > 0)
+			{
+				R2000_TRACE_SCOPE("receiver handle bytes");
+				receive_time_ = Poco::Clock().raw();
+				
+				writeBufferBack(buffer, numBytes);
+				
+				while( handleNextPacket() ) {}
+			}
 			
 #if __cplusplus<201103
             run_mutex.lock();
@@ -79,19 +98,24 @@ namespace pepperl_fuchs {
     
     void ScanDataReceiverUDP::disconnect()
     {
-        is_connected_ = false;
-        
-#if __cplusplus>=201103
-		isRunning = false;
-#else
-		run_mutex.lock();
-		isRunning = false;
-		run_mutex.unlock();
-#endif
+        setConnected(false);
 		
         // wait until thread is done
-        io_service_thread_.join();
+        stopThread();
 		
 		udp_socket.close();        
     }
+	
+	
+	bool ScanDataReceiverUDP::reconnect(const HandleInfo& handle_info)
+	{
+		stopThread();
+		
+		prepareReconnect();
+		
+		setConnected(true);
+		startThread();
+		
+		return true;
+	}
 }
\ No newline at end of file
@@ -30,6 +30,9 @@ namespace pepperl_fuchs {
 		
 		void disconnect();
 		
+		//! Keep the local UDP port and restart receiving, the renewed handle sends to the same port
+		bool reconnect(const HandleInfo& handle_info);
+		
 		//! do threaded work here
 		void run();
 		
@@ -0,0 +1,149 @@
+//
+//  scan_queue.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	capacity and overflow policy of the scan queues of ScanDataReceiver and R2000DataReader
+//
+
+#ifndef SCAN_QUEUE_H
+#define SCAN_QUEUE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <deque>
+
+namespace pepperl_fuchs {
+
+//! What happens to a scan queue when a new scan arrives and the queue is full
+enum ScanQueuePolicy
+{
+    //! Drop the oldest queued scans (default)
+    SCAN_QUEUE_DROP_OLDEST,
+    //! Drop the new scan and keep the queued ones
+    SCAN_QUEUE_DROP_NEWEST,
+    //! Let the producer wait until the consumer popped a scan, file replay (R2000DataReader) only
+    SCAN_QUEUE_BLOCK_PRODUCER,
+    //! Only keep the latest scan, the capacity is ignored, for consumers like renderers wanting the newest scan only
+    SCAN_QUEUE_KEEP_LATEST
+};
+
+//! Default capacity of a scan queue
+static const std::size_t SCAN_QUEUE_DEFAULT_CAPACITY = 100;
+
+//! \struct ScanQueueCounters
+//! \brief Counters of a scan queue since it was created
+struct ScanQueueCounters
+{
+    ScanQueueCounters() : scans_queued(0), dropped_oldest(0), dropped_newest(0), replaced(0), producer_blocks(0), max_size(0) {}
+
+    //! Scans appended to the queue
+    uint64_t scans_queued;
+
+    //! Queued scans dropped to make room, SCAN_QUEUE_DROP_OLDEST
+    uint64_t dropped_oldest;
+
+    //! New scans dropped because the queue was full, SCAN_QUEUE_DROP_NEWEST
+    uint64_t dropped_newest;
+
+    //! Scans replaced by a newer one before they were popped, SCAN_QUEUE_KEEP_LATEST or latest scan output
+    uint64_t replaced;
+
+    //! Times the producer waited for room, SCAN_QUEUE_BLOCK_PRODUCER
+    uint64_t producer_blocks;
+
+    //! Largest number of queued scans
+    std::size_t max_size;
+};
+
+//! \class ScanQueueControl
+//! \brief Applies a ScanQueuePolicy to a std::deque of scans
+//! Not thread safe, the owner of the queue has to lock.
+class ScanQueueControl
+{
+public:
+    ScanQueueControl() : policy_(SCAN_QUEUE_DROP_OLDEST), capacity_(SCAN_QUEUE_DEFAULT_CAPACITY) {}
+
+    //! @param capacity Maximum number of queued scans, at least 1
+    void setPolicy(ScanQueuePolicy policy, std::size_t capacity)
+    {
+        policy_ = policy;
+        capacity_ = capacity > 0 ? capacity : 1;
+    }
+
+    ScanQueuePolicy getPolicy() const { return policy_; }
+    std::size_t getCapacity() const { return capacity_; }
+    const ScanQueueCounters& getCounters() const { return counters_; }
+
+    //! Return if a new scan has to be dropped, counts the dropped scan
+    //! @param size Number of queued scans
+    bool rejectNewScan(std::size_t size)
+    {
+        if( policy_ != SCAN_QUEUE_DROP_NEWEST || size < capacity_ )
+            return false;
+
+        counters_.dropped_newest++;
+        return true;
+    }
+
+    //! Return if the producer has to wait before appending a scan
+    //! @param size Number of queued scans
+    bool producerMustWait(std::size_t size) const
+    {
+        return policy_ == SCAN_QUEUE_BLOCK_PRODUCER && size >= capacity_;
+    }
+
+    //! Count a wait of the producer
+    void addProducerBlock() { counters_.producer_blocks++; }
+
+    //! Drop queued scans to make room for a new one, call rejectNewScan() first
+    //! @param queue Queue the new scan is appended to afterwards
+    //! @param latest Scans at the back kept by SCAN_QUEUE_KEEP_LATEST,
+    //!        1 if the back of the queue is the last scan before the new one, still unpopped
+    //! @returns Number of scans dropped because the queue was full, scans replaced by SCAN_QUEUE_KEEP_LATEST are not included
+    template<class T> std::size_t makeRoom(std::deque<T>& queue, std::size_t latest = 0)
+    {
+        std::size_t dropped = 0;
+        if( policy_ == SCAN_QUEUE_KEEP_LATEST )
+        {
+            while( queue.size() > latest )
+            {
+                queue.pop_front();
+                counters_.replaced++;
+            }
+        }
+        else
+        {
+            // also used by SCAN_QUEUE_BLOCK_PRODUCER, if the capacity was reduced while the producer did not wait
+            while( !queue.empty() && queue.size() >= capacity_ )
+            {
+                queue.pop_front();
+                counters_.dropped_oldest++;
+                dropped++;
+            }
+        }
+        return dropped;
+    }
+
+    //! Count scans replaced by a newer one before they were popped, e.g. by a TripleBuffer
+    void addReplaced(std::size_t count = 1) { counters_.replaced += count; }
+
+    //! Count a scan appended to the queue
+    //! @param size Number of queued scans including the appended one
+    void addQueued(std::size_t size)
+    {
+        counters_.scans_queued++;
+        if( size > counters_.max_size )
+            counters_.max_size = size;
+    }
+
+private:
+    ScanQueuePolicy policy_;
+    std::size_t capacity_;
+    ScanQueueCounters counters_;
+};
+
+}
+
+#endif // SCAN_QUEUE_H
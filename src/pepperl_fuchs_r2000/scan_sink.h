@@ -0,0 +1,58 @@
+//
+//  scan_sink.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	interface for decoding received samples directly into memory provided by the user,
+//	e.g. mapped GPU buffers
+//
+
+#ifndef SCAN_SINK_H
+#define SCAN_SINK_H
+
+#include <stdint.h>
+
+#include "compact_scan_data.h"
+
+namespace pepperl_fuchs {
+
+//! Layout of the arrays a ScanSink provides
+enum ScanSinkFormat
+{
+    //! Distances and amplitudes in separate arrays, decoded like CompactScanData (default)
+    SCAN_SINK_DECODED,
+    //! One word per sample in the distance array, packed like packet type C: 20 bit distance, 12 bit amplitude above
+    //! Payloads of type C are copied without decoding, type A and B are packed, the amplitude array is not used
+    SCAN_SINK_PACKED
+};
+
+//! \class ScanSink
+//! \brief Receives the samples of every scan on the IO thread of the receiver, see R2000Driver::setScanSink()
+//! The sink provides two arrays per scan, the receiver decodes the packets straight into them,
+//! indexed by sample index like CompactScanData. Samples of lost packets are not written.
+//! Both methods are called with the receiver locked, they should only hand over memory and never wait.
+class ScanSink
+{
+public:
+    virtual ~ScanSink() {}
+
+    //! Layout of the arrays of the next beginScan(), asked once per scan
+    virtual ScanSinkFormat getFormat() const { return SCAN_SINK_DECODED; }
+
+    //! Start a scan
+    //! @param header Header of the first packet stored of the scan
+    //! @param distance Output, array of at least header.num_points_scan distances, or packed samples with SCAN_SINK_PACKED
+    //! @param amplitude Output, array of at least header.num_points_scan amplitudes, not written for packet type A
+    //!        and SCAN_SINK_PACKED, may stay 0 with SCAN_SINK_PACKED
+    //! @returns False to skip the scan
+    virtual bool beginScan(const PacketHeader& header, uint32_t*& distance, uint32_t*& amplitude) = 0;
+
+    //! Finish the scan of the last successful beginScan(), also called for incomplete scans
+    //! @param info Meta data of the scan, info.num_points_received tells how many samples were written
+    virtual void endScan(const ScanInfo& info) = 0;
+};
+
+}
+
+#endif // SCAN_SINK_H
@@ -0,0 +1,300 @@
+//
+//  scan_timing.cpp
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	per-sample time and angle of a scan and motion compensation (de-skew)
+//	of scans taken while the scanner moves
+//
+
+#include "scan_timing.h"
+#include "clock_sync.h"
+
+#include <cmath>
+#include <algorithm>
+
+namespace pepperl_fuchs {
+
+//! 1/10000° to radians
+static const double TO_RAD = PI_D / 1800000.0;
+
+//-----------------------------------------------------------------------------
+//! Time between two samples in seconds
+static double sampleInterval(uint32_t scan_frequency, int num_points_scan)
+{
+    if( scan_frequency == 0 || num_points_scan <= 0 )
+        return 0.0;
+
+    // scan_frequency is in mHz
+    return 1000.0 / scan_frequency / num_points_scan;
+}
+
+//-----------------------------------------------------------------------------
+//! Host time of a header, scanner time for scans without host times
+static int64_t headerTime(const ScanData& scan, std::size_t h)
+{
+    if( h < scan.host_times.size() )
+        return scan.host_times[h];
+
+    return ClockSynchronizer::ntpToMicroseconds(scan.headers[h].timestamp_raw);
+}
+
+//-----------------------------------------------------------------------------
+//! Wrap an angle to [-pi, pi]
+static float wrapAngle(float angle)
+{
+    while( angle > (float)PI_D )
+        angle -= (float)(2.0 * PI_D);
+    while( angle < (float)-PI_D )
+        angle += (float)(2.0 * PI_D);
+    return angle;
+}
+
+//-----------------------------------------------------------------------------
+//! Interpolate the pose at time, starting the search at segment (updated)
+static void poseAt(const std::vector<Pose2D>& trajectory, double time, std::size_t& segment, Pose2D& pose)
+{
+    const std::size_t last = trajectory.size() - 1;
+
+    if( time <= (double)trajectory[0].time )
+    {
+        segment = 0;
+        pose = trajectory[0];
+        return;
+    }
+    if( time >= (double)trajectory[last].time )
+    {
+        segment = last;
+        pose = trajectory[last];
+        return;
+    }
+
+    // samples are mostly in time order, so walk forward from the last segment
+    if( segment >= last || (double)trajectory[segment].time > time )
+        segment = 0;
+    while( segment + 1 < last && (double)trajectory[segment + 1].time <= time )
+        segment++;
+
+    const Pose2D& a = trajectory[segment];
+    const Pose2D& b = trajectory[segment + 1];
+    const double span = (double)(b.time - a.time);
+    const float f = span > 0.0 ? (float)((time - (double)a.time) / span) : 0.0f;
+
+    pose.time = (int64_t)time;
+    pose.x = a.x + f * (b.x - a.x);
+    pose.y = a.y + f * (b.y - a.y);
+    pose.theta = a.theta + f * wrapAngle(b.theta - a.theta);
+}
+
+//-----------------------------------------------------------------------------
+bool ScanTiming::TableKey::operator<(const TableKey& other) const
+{
+    if( num_points_scan != other.num_points_scan )
+        return num_points_scan < other.num_points_scan;
+    if( start_angle != other.start_angle )
+        return start_angle < other.start_angle;
+    if( angular_increment != other.angular_increment )
+        return angular_increment < other.angular_increment;
+    return scan_frequency < other.scan_frequency;
+}
+
+//-----------------------------------------------------------------------------
+bool ScanTiming::TableKey::operator==(const TableKey& other) const
+{
+    return num_points_scan == other.num_points_scan
+        && start_angle == other.start_angle
+        && angular_increment == other.angular_increment
+        && scan_frequency == other.scan_frequency;
+}
+
+//-----------------------------------------------------------------------------
+ScanTiming::ScanTiming() :
+    tables_()
+    ,last_table_(0)
+{
+    last_key_.num_points_scan = 0;
+    last_key_.start_angle = 0;
+    last_key_.angular_increment = 0;
+    last_key_.scan_frequency = 0;
+}
+
+//-----------------------------------------------------------------------------
+void ScanTiming::clearTables()
+{
+    tables_.clear();
+    last_table_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+const SampleTable& ScanTiming::getTable(int num_points_scan, int32_t start_angle, int32_t angular_increment, uint32_t scan_frequency)
+{
+    TableKey key;
+    key.num_points_scan = num_points_scan;
+    key.start_angle = start_angle;
+    key.angular_increment = angular_increment;
+    key.scan_frequency = scan_frequency;
+
+    if( last_table_ && key == last_key_ )
+        return *last_table_;
+
+    std::map<TableKey, SampleTable>::iterator it = tables_.find(key);
+    if( it == tables_.end() )
+    {
+        SampleTable& table = tables_[key];
+        table.num_points_scan = num_points_scan;
+        table.start_angle = start_angle;
+        table.angular_increment = angular_increment;
+        table.scan_frequency = scan_frequency;
+        table.time.resize(std::max(num_points_scan, 0));
+        table.angle.resize(std::max(num_points_scan, 0));
+
+        const double interval = sampleInterval(scan_frequency, num_points_scan);
+        for( int i=0; i<num_points_scan; i++ )
+        {
+            table.time[i] = (float)(i * interval);
+            table.angle[i] = (float)((start_angle + (double)i * angular_increment) * TO_RAD);
+        }
+
+        it = tables_.find(key);
+    }
+
+    last_key_ = key;
+    last_table_ = &it->second;
+    return it->second;
+}
+
+//-----------------------------------------------------------------------------
+const SampleTable& ScanTiming::getTable(const PacketHeader& header)
+{
+    // angle of sample index 0
+    const int32_t start_angle = header.first_angle - (int32_t)header.first_index * header.angular_increment;
+    return getTable(header.num_points_scan, start_angle, header.angular_increment, header.scan_frequency);
+}
+
+//-----------------------------------------------------------------------------
+void ScanTiming::compute(const ScanData& scan, SampleTiming& timing)
+{
+    timing.time.resize(scan.distance_data.size());
+    timing.angle.resize(scan.distance_data.size());
+
+    if( scan.headers.empty() )
+    {
+        timing.reference_time = 0;
+        timing.time.clear();
+        timing.angle.clear();
+        return;
+    }
+
+    // time of sample index 0, extrapolated from the first packet
+    const PacketHeader& first = scan.headers[0];
+    const double first_interval = sampleInterval(first.scan_frequency, first.num_points_scan);
+    timing.reference_time = headerTime(scan, 0) - (int64_t)(first.first_index * first_interval * 1.0e6);
+
+    std::size_t offset = 0;
+    for( std::size_t h=0; h<scan.headers.size(); h++ )
+    {
+        const PacketHeader& header = scan.headers[h];
+        const SampleTable& table = getTable(header);
+
+        const std::size_t count = std::min((std::size_t)header.num_points_packet, scan.distance_data.size() - offset);
+        if( count == 0 )
+            break;
+
+        // packet time relative to the table time of its first sample
+        const double interval = sampleInterval(header.scan_frequency, header.num_points_scan);
+        const float shift = (float)((headerTime(scan, h) - timing.reference_time) * 1.0e-6 - header.first_index * interval);
+
+        float* time = &timing.time[offset];
+        float* angle = &timing.angle[offset];
+
+        const std::size_t index = header.first_index;
+        const std::size_t valid = index < table.time.size() ? std::min(count, table.time.size() - index) : 0;
+
+        for( std::size_t i=0; i<valid; i++ )
+        {
+            time[i] = shift + table.time[index + i];
+            angle[i] = table.angle[index + i];
+        }
+
+        // samples of broken headers pointing behind the table
+        for( std::size_t i=valid; i<count; i++ )
+        {
+            time[i] = (float)(shift + (index + i) * interval);
+            angle[i] = (float)((header.first_angle + (double)i * header.angular_increment) * TO_RAD);
+        }
+
+        offset += count;
+    }
+
+    // samples without header
+    timing.time.resize(offset);
+    timing.angle.resize(offset);
+}
+
+//-----------------------------------------------------------------------------
+void ScanTiming::compute(const CompactScanData& scan, SampleTiming& timing)
+{
+    const ScanInfo& info = scan.info;
+
+    const SampleTable& table = getTable(info.num_points_scan, info.start_angle, info.angular_increment, info.scan_frequency);
+    timing.time.assign(table.time.begin(), table.time.end());
+    timing.angle.assign(table.angle.begin(), table.angle.end());
+
+    const int64_t first_time = info.host_time_first != 0 ? info.host_time_first : ClockSynchronizer::ntpToMicroseconds(info.timestamp_first);
+    const double interval = sampleInterval(info.scan_frequency, info.num_points_scan);
+
+    timing.reference_time = first_time - (int64_t)(info.first_index * interval * 1.0e6);
+}
+
+//-----------------------------------------------------------------------------
+bool ScanTiming::interpolatePose(const std::vector<Pose2D>& trajectory, int64_t time, Pose2D& pose)
+{
+    if( trajectory.empty() )
+        return false;
+
+    std::size_t segment = 0;
+    poseAt(trajectory, (double)time, segment, pose);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+void ScanTiming::deskew(const PointCloud2D& cloud, const SampleTiming& timing, const std::vector<Pose2D>& trajectory, int64_t target_time, PointCloud2D& out)
+{
+    const std::size_t count = std::min(cloud.size(), timing.size());
+    out.x.resize(count);
+    out.y.resize(count);
+
+    if( trajectory.empty() )
+    {
+        std::copy(cloud.x.begin(), cloud.x.begin() + count, out.x.begin());
+        std::copy(cloud.y.begin(), cloud.y.begin() + count, out.y.begin());
+        return;
+    }
+
+    std::size_t segment = 0;
+    Pose2D target;
+    poseAt(trajectory, (double)target_time, segment, target);
+
+    const float cos_t = std::cos(target.theta);
+    const float sin_t = std::sin(target.theta);
+
+    segment = 0;
+    Pose2D pose;
+    for( std::size_t i=0; i<count; i++ )
+    {
+        poseAt(trajectory, (double)timing.reference_time + timing.time[i] * 1.0e6, segment, pose);
+
+        // point in the fixed frame
+        const float c = std::cos(pose.theta);
+        const float s = std::sin(pose.theta);
+        const float wx = c * cloud.x[i] - s * cloud.y[i] + pose.x - target.x;
+        const float wy = s * cloud.x[i] + c * cloud.y[i] + pose.y - target.y;
+
+        // back into the scanner frame at target_time
+        out.x[i] =  cos_t * wx + sin_t * wy;
+        out.y[i] = -sin_t * wx + cos_t * wy;
+    }
+}
+
+}
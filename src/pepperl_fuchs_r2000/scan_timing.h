@@ -0,0 +1,146 @@
+//
+//  scan_timing.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	per-sample time and angle of a scan and motion compensation (de-skew)
+//	of scans taken while the scanner moves
+//
+
+#ifndef SCAN_TIMING_H
+#define SCAN_TIMING_H
+
+#include <stdint.h>
+#include <vector>
+#include <map>
+
+#include "compact_scan_data.h"
+#include "cartesian_converter.h"
+
+namespace pepperl_fuchs {
+
+//! \struct SampleTable
+//! \brief Precomputed time and angle of every sample index of a scan configuration
+struct SampleTable
+{
+    //! Number of samples per scan
+    int num_points_scan;
+
+    //! Angle of sample index 0 in 1/10000°
+    int32_t start_angle;
+
+    //! Delta between two succeeding samples in 1/10000°
+    int32_t angular_increment;
+
+    //! Frequency of scan-head rotation in mHz
+    uint32_t scan_frequency;
+
+    //! Time of every sample index after sample index 0 in seconds
+    std::vector<float> time;
+
+    //! Angle of every sample index in radians
+    std::vector<float> angle;
+};
+
+//! \struct SampleTiming
+//! \brief Time and angle of the samples of one scan
+struct SampleTiming
+{
+    SampleTiming() : reference_time(0) {}
+
+    //! Host time of sample index 0 in microseconds (Poco::Clock::raw())
+    //! Scanner time in microseconds if the scan carries no host times, e.g. old recordings
+    int64_t reference_time;
+
+    //! Time of every sample after reference_time in seconds, in the order of the distance data
+    std::vector<float> time;
+
+    //! Angle of every sample in radians, in the order of the distance data
+    std::vector<float> angle;
+
+    std::size_t size() const { return time.size(); }
+};
+
+//! \struct Pose2D
+//! \brief Pose of the scanner in a fixed frame at a point in time
+struct Pose2D
+{
+    //! Host time in microseconds (Poco::Clock::raw())
+    int64_t time;
+
+    //! Position in the unit of the point cloud
+    float x;
+    float y;
+
+    //! Heading in radians
+    float theta;
+};
+
+//! \class ScanTiming
+//! \brief Computes per-sample time and angle arrays from the packet timestamps
+//! The timestamp of a packet belongs to its first sample, the following samples are
+//! 1 / (scan_frequency * num_points_scan) apart.
+//! Tables are built once per (samples per scan, start angle, angular increment, scan frequency) configuration.
+class ScanTiming
+{
+public:
+    ScanTiming();
+
+    //! Compute time and angle of every sample of a scan
+    //! @param scan Scan with the packet headers (and host times) belonging to the data
+    //! @param timing Output, one entry per distance
+    void compute(const ScanData& scan, SampleTiming& timing);
+
+    //! Compute time and angle of every sample of a compact scan
+    //! @param scan Compact scan
+    //! @param timing Output, num_points_scan entries
+    void compute(const CompactScanData& scan, SampleTiming& timing);
+
+    //! Get the table of a scan configuration, computed on first use
+    const SampleTable& getTable(int num_points_scan, int32_t start_angle, int32_t angular_increment, uint32_t scan_frequency);
+
+    //! Get the table matching a packet header
+    const SampleTable& getTable(const PacketHeader& header);
+
+    //! Remove all cached tables
+    void clearTables();
+
+    //! Interpolate the pose at a point in time
+    //! @param trajectory Poses sorted by time
+    //! @param time Host time in microseconds, clamped to the time range of the trajectory
+    //! @param pose Output
+    //! @returns False if the trajectory is empty
+    static bool interpolatePose(const std::vector<Pose2D>& trajectory, int64_t time, Pose2D& pose);
+
+    //! Move every point into the scanner frame at target_time, using the pose at the time of its sample
+    //! @param cloud Points in sample order, e.g. from CartesianConverter
+    //! @param timing Timing of the same scan
+    //! @param trajectory Poses sorted by time, should cover the scan
+    //! @param target_time Host time in microseconds the corrected scan refers to, e.g. timing.reference_time
+    //! @param out Output, may not be the same as cloud
+    static void deskew(const PointCloud2D& cloud, const SampleTiming& timing, const std::vector<Pose2D>& trajectory, int64_t target_time, PointCloud2D& out);
+
+private:
+    //! Key of a scan configuration
+    struct TableKey
+    {
+        int num_points_scan;
+        int32_t start_angle;
+        int32_t angular_increment;
+        uint32_t scan_frequency;
+
+        bool operator<(const TableKey& other) const;
+        bool operator==(const TableKey& other) const;
+    };
+
+    //! Cached tables
+    std::map<TableKey, SampleTable> tables_;
+
+    //! Table used last, scans of one scanner normally share one configuration
+    const SampleTable* last_table_;
+    TableKey last_key_;
+};
+
+}
+#endif // SCAN_TIMING_H
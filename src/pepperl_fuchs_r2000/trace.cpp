@@ -0,0 +1,266 @@
+//
+//  trace.cpp
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	trace points recording into per-thread ring buffers, dumped as Chrome trace JSON
+//	(chrome://tracing, https://ui.perfetto.dev)
+//
+
+#include "trace.h"
+
+#include <fstream>
+#include <sstream>
+
+#if R2000_TRACE_ENABLED
+	#include <algorithm>
+	#include <atomic>
+	#include <chrono>
+	#include <map>
+	#include <mutex>
+	#include <vector>
+#endif
+
+namespace pepperl_fuchs {
+namespace trace {
+
+#if R2000_TRACE_ENABLED
+
+//! A recorded event
+struct Event
+{
+    const char* name;
+    int64_t time;
+    int64_t value;
+    int thread_id;
+    char phase;
+};
+
+//! Events of one thread, written by its owner only
+//! The owner writes the slot, then publishes it by incrementing head with release order.
+//! A reader copies the slots below head and discards the ones the owner may have overwritten meanwhile.
+struct Ring
+{
+    Ring() : head(0), cleared(0), in_use(true), thread_id(0), events(RING_SIZE) {}
+
+    std::atomic<uint64_t> head;
+
+    //! Events below this index were dropped by clear()
+    std::atomic<uint64_t> cleared;
+
+    std::atomic<bool> in_use;
+    int thread_id;
+    std::vector<Event> events;
+};
+
+//! All rings ever created, a ring is reused by a new thread once its owner has exited
+//! The mutex is locked when a thread records its first event, names itself and while dumping, never per event
+static std::mutex registry_mutex;
+static std::vector<Ring*> registry;
+static std::map<int, const char*> thread_names;
+static int next_thread_id = 1;
+
+//! Start of the trace, all times are relative to it
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+//-----------------------------------------------------------------------------
+//! Releases the ring of a thread when the thread exits
+struct RingOwner
+{
+    RingOwner() : ring(0) {}
+    ~RingOwner()
+    {
+        if( ring )
+            ring->in_use.store(false, std::memory_order_release);
+    }
+
+    Ring* ring;
+};
+
+//! The owner is only touched when the ring is acquired, thread_ring is a plain pointer without an initialization guard
+static thread_local RingOwner ring_owner;
+static thread_local Ring* thread_ring = 0;
+
+//-----------------------------------------------------------------------------
+//! Acquire a ring for the calling thread
+static Ring& acquireRing()
+{
+    std::unique_lock<std::mutex> lock(registry_mutex);
+
+    // the events of an exited thread stay in its ring until they are overwritten
+    Ring* ring = 0;
+    for( std::size_t i=0; i<registry.size() && !ring; i++ )
+    {
+        bool expected = false;
+        if( registry[i]->in_use.compare_exchange_strong(expected, true) )
+            ring = registry[i];
+    }
+
+    if( !ring )
+    {
+        registry.push_back(new Ring());
+        ring = registry.back();
+    }
+
+    ring->thread_id = next_thread_id++;
+    ring_owner.ring = ring;
+    thread_ring = ring;
+    return *ring;
+}
+
+//-----------------------------------------------------------------------------
+//! Ring of the calling thread, acquired with its first event
+static inline Ring& threadRing()
+{
+    return thread_ring ? *thread_ring : acquireRing();
+}
+
+//-----------------------------------------------------------------------------
+int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+//-----------------------------------------------------------------------------
+void record(const char* name, char phase, int64_t time, int64_t value)
+{
+    Ring& ring = threadRing();
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+
+    Event& event = ring.events[head % RING_SIZE];
+    event.name = name;
+    event.time = time;
+    event.value = value;
+    event.thread_id = ring.thread_id;
+    event.phase = phase;
+
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+//-----------------------------------------------------------------------------
+void setThreadName(const char* name)
+{
+    const int thread_id = threadRing().thread_id;
+
+    std::unique_lock<std::mutex> lock(registry_mutex);
+    thread_names[thread_id] = name;
+}
+
+//-----------------------------------------------------------------------------
+//! Write a string as JSON string
+static void writeJsonString(std::ostream& out, const char* text)
+{
+    out << '"';
+    for( const char* c = text; *c; c++ )
+    {
+        if( *c == '"' || *c == '\\' )
+            out << '\\' << *c;
+        else if( (unsigned char)*c < 0x20 )
+            out << ' ';
+        else
+            out << *c;
+    }
+    out << '"';
+}
+
+//-----------------------------------------------------------------------------
+std::string getChromeTrace()
+{
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    std::unique_lock<std::mutex> lock(registry_mutex);
+
+    bool first = true;
+    for( std::map<int, const char*>::const_iterator t = thread_names.begin(); t != thread_names.end(); t++ )
+    {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->first << ",\"args\":{\"name\":";
+        writeJsonString(out, t->second);
+        out << "}}";
+        first = false;
+    }
+
+    std::vector<Event> events;
+    for( std::size_t r=0; r<registry.size(); r++ )
+    {
+        Ring& ring = *registry[r];
+
+        // copy without stopping the owner, slots it may have overwritten during the copy are dropped
+        const uint64_t head = ring.head.load(std::memory_order_acquire);
+        const uint64_t begin = std::max<uint64_t>(head > RING_SIZE ? head - RING_SIZE : 0, ring.cleared.load(std::memory_order_relaxed));
+        events.resize(head - begin);
+        for( uint64_t i=begin; i<head; i++ )
+            events[i - begin] = ring.events[i % RING_SIZE];
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t head_after = ring.head.load(std::memory_order_relaxed);
+        const uint64_t valid_begin = head_after > RING_SIZE ? head_after - RING_SIZE : 0;
+        const uint64_t skip = valid_begin > begin ? std::min<uint64_t>(valid_begin - begin, events.size()) : 0;
+
+        for( std::size_t i=skip; i<events.size(); i++ )
+        {
+            const Event& event = events[i];
+            out << (first ? "" : ",") << "\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << event.thread_id
+                << ",\"ts\":" << event.time / 1000 << "." << (event.time % 1000) / 100 << (event.time % 100) / 10 << event.time % 10;
+
+            if( event.phase == PHASE_COMPLETE )
+                out << ",\"dur\":" << event.value / 1000 << "." << (event.value % 1000) / 100 << (event.value % 100) / 10 << event.value % 10;
+            else if( event.phase == PHASE_COUNTER )
+                out << ",\"args\":{\"value\":" << event.value << "}";
+            else if( event.phase == PHASE_INSTANT )
+                out << ",\"s\":\"t\"";
+
+            out << "}";
+            first = false;
+        }
+    }
+
+    out << "\n]}\n";
+    return out.str();
+}
+
+//-----------------------------------------------------------------------------
+void clear()
+{
+    std::unique_lock<std::mutex> lock(registry_mutex);
+
+    // owners keep writing, the events before their current head are skipped when dumping
+    for( std::size_t r=0; r<registry.size(); r++ )
+        registry[r]->cleared.store(registry[r]->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+#else
+
+//-----------------------------------------------------------------------------
+std::string getChromeTrace()
+{
+    return "{\"traceEvents\":[]}\n";
+}
+
+//-----------------------------------------------------------------------------
+void clear()
+{
+}
+
+#endif
+
+//-----------------------------------------------------------------------------
+bool writeChromeTrace(const std::string& path)
+{
+#if R2000_TRACE_ENABLED
+    std::ofstream file(path.c_str());
+    if( !file )
+        return false;
+
+    file << getChromeTrace();
+    return file.good();
+#else
+    return false;
+#endif
+}
+
+}
+}
@@ -0,0 +1,117 @@
+//
+//  trace.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	trace points recording into per-thread ring buffers, dumped as Chrome trace JSON
+//	(chrome://tracing, https://ui.perfetto.dev)
+//
+//	Trace points are compiled in with -DR2000_TRACING and C++11 only,
+//	otherwise all R2000_TRACE_* macros expand to nothing.
+//
+
+#ifndef R2000_TRACE_H
+#define R2000_TRACE_H
+
+#include <stdint.h>
+#include <string>
+
+#if defined(R2000_TRACING) && __cplusplus>=201103
+	#define R2000_TRACE_ENABLED 1
+#else
+	#define R2000_TRACE_ENABLED 0
+#endif
+
+namespace pepperl_fuchs {
+namespace trace {
+
+//! Events kept per thread, older events are overwritten
+static const std::size_t RING_SIZE = 16384;
+
+//! Get the recorded events of all threads in the Chrome trace event format
+//! Events recorded while dumping may be missing, the recording threads are never blocked
+//! @returns JSON object with a traceEvents array, without events if tracing is compiled out
+std::string getChromeTrace();
+
+//! Write getChromeTrace() to a file
+//! @returns False if the file could not be written or tracing is compiled out
+bool writeChromeTrace(const std::string& path);
+
+//! Drop the events of all threads recorded so far
+void clear();
+
+#if R2000_TRACE_ENABLED
+
+//! Phase of an event, as in the Chrome trace event format
+enum Phase
+{
+    PHASE_BEGIN = 'B',
+    PHASE_END = 'E',
+    PHASE_COMPLETE = 'X',
+    PHASE_INSTANT = 'i',
+    PHASE_COUNTER = 'C'
+};
+
+//! Monotonic time in nanoseconds
+int64_t now();
+
+//! Record an event in the ring of the calling thread
+//! @param name Event name, has to be a string literal or live until the trace is dumped
+//! @param value Duration in nanoseconds for PHASE_COMPLETE, the value for PHASE_COUNTER
+void record(const char* name, char phase, int64_t time, int64_t value = 0);
+
+//! Name the calling thread in the trace
+//! @param name Thread name, has to be a string literal or live until the trace is dumped
+void setThreadName(const char* name);
+
+//! \class Scope
+//! \brief Records one complete event from construction to destruction
+class Scope
+{
+public:
+    explicit Scope(const char* name) : name_(name), start_(now()) {}
+    ~Scope() { record(name_, PHASE_COMPLETE, start_, now() - start_); }
+
+private:
+    Scope(const Scope&);
+    Scope& operator=(const Scope&);
+
+    const char* name_;
+    int64_t start_;
+};
+
+#endif
+
+}
+}
+
+#if R2000_TRACE_ENABLED
+	#define R2000_TRACE_CONCAT_(a, b) a##b
+	#define R2000_TRACE_CONCAT(a, b) R2000_TRACE_CONCAT_(a, b)
+
+	//! Trace the rest of the enclosing block
+	#define R2000_TRACE_SCOPE(name) ::pepperl_fuchs::trace::Scope R2000_TRACE_CONCAT(r2000_trace_scope_, __LINE__)(name)
+
+	//! Trace from BEGIN to END within the same thread, e.g. waiting for a lock which lives beyond the block
+	#define R2000_TRACE_BEGIN(name) ::pepperl_fuchs::trace::record(name, ::pepperl_fuchs::trace::PHASE_BEGIN, ::pepperl_fuchs::trace::now())
+	#define R2000_TRACE_END(name) ::pepperl_fuchs::trace::record(name, ::pepperl_fuchs::trace::PHASE_END, ::pepperl_fuchs::trace::now())
+
+	//! Mark a point in time
+	#define R2000_TRACE_INSTANT(name) ::pepperl_fuchs::trace::record(name, ::pepperl_fuchs::trace::PHASE_INSTANT, ::pepperl_fuchs::trace::now())
+
+	//! Record the value of a counter, e.g. a queue size
+	#define R2000_TRACE_COUNTER(name, value) ::pepperl_fuchs::trace::record(name, ::pepperl_fuchs::trace::PHASE_COUNTER, ::pepperl_fuchs::trace::now(), (int64_t)(value))
+
+	//! Name the calling thread
+	#define R2000_TRACE_THREAD_NAME(name) ::pepperl_fuchs::trace::setThreadName(name)
+#else
+	#define R2000_TRACE_SCOPE(name)
+	#define R2000_TRACE_BEGIN(name)
+	#define R2000_TRACE_END(name)
+	#define R2000_TRACE_INSTANT(name)
+	#define R2000_TRACE_COUNTER(name, value)
+	#define R2000_TRACE_THREAD_NAME(name)
+#endif
+
+#endif // R2000_TRACE_H
@@ -0,0 +1,113 @@
+//
+//  triple_buffer.h
+//
+//	https://github.com/i-n-g-o/ofxR2000
+//
+//
+//	latest value channel between one producer and one consumer thread,
+//	values are handed over by swapping buffer indices, never copied
+//
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#if __cplusplus>=201103
+	#include <atomic>
+#else
+	#include "Poco/Mutex.h"
+#endif
+
+namespace pepperl_fuchs {
+
+//! \class TripleBuffer
+//! \brief Three buffers shared by one producer and one consumer
+//! The producer fills writeBuffer() and publishes it, the consumer takes the newest published buffer with update().
+//! The third buffer holds the newest published value until the consumer takes it, so neither side waits for the other
+//! and values the consumer was too slow for are overwritten.
+//! With C++11 publishing and taking is one atomic exchange each, otherwise a mutex protects the exchange of the indices.
+//! Buffers are reused: the producer gets back a buffer with an old value and has to reset it.
+template<class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : write_(0), read_(2), shared_(1) {}
+
+    //! Buffer filled by the producer, owned by the producer until publish()
+    T& writeBuffer() { return buffers_[write_]; }
+
+    //! Publish writeBuffer() as newest value, writeBuffer() is an old buffer afterwards, producer only
+    //! @returns True if the previously published value was never taken by the consumer
+    bool publish()
+    {
+        const unsigned int previous = exchange(write_ | NEW_VALUE);
+        write_ = previous & INDEX_MASK;
+        return (previous & NEW_VALUE) != 0;
+    }
+
+    //! Take the newest published value as readBuffer(), consumer only
+    //! @returns True if a value newer than the current readBuffer() was taken
+    bool update()
+    {
+        if( !hasNewValue() )
+            return false;
+
+        read_ = exchange(read_) & INDEX_MASK;
+        return true;
+    }
+
+    //! Buffer taken by the last update(), unchanged until the next update() taking a value, consumer only
+    T& readBuffer() { return buffers_[read_]; }
+    const T& readBuffer() const { return buffers_[read_]; }
+
+private:
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+    //! shared_ holds the index of the buffer between producer and consumer and if it holds a value not taken yet
+    static const unsigned int INDEX_MASK = 3;
+    static const unsigned int NEW_VALUE = 4;
+
+#if __cplusplus>=201103
+    unsigned int exchange(unsigned int value)
+    {
+        // release the written buffer, acquire the buffer written or read by the other side
+        return shared_.exchange(value, std::memory_order_acq_rel);
+    }
+
+    bool hasNewValue() const
+    {
+        return (shared_.load(std::memory_order_relaxed) & NEW_VALUE) != 0;
+    }
+#else
+    unsigned int exchange(unsigned int value)
+    {
+        Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+        const unsigned int previous = shared_;
+        shared_ = value;
+        return previous;
+    }
+
+    bool hasNewValue()
+    {
+        Poco::ScopedLock<Poco::FastMutex> lock(mutex_);
+        return (shared_ & NEW_VALUE) != 0;
+    }
+#endif
+
+    T buffers_[3];
+
+    //! Buffer indices of the producer and the consumer, each only accessed by its owner
+    unsigned int write_;
+    unsigned int read_;
+
+#if __cplusplus>=201103
+    std::atomic<unsigned int> shared_;
+#else
+    unsigned int shared_;
+    Poco::FastMutex mutex_;
+#endif
+};
+
+}
+
+#endif // TRIPLE_BUFFER_H